@@ -0,0 +1,122 @@
+/*
+ * Negotiation cost counters (CONFIG_PD_BENCH).
+ *
+ * Measures the way from attach to explicit contract: time of get_time()
+ * from PE_SNK_Startup to each PS_RDY, and CPU work spent meanwhile - event
+ * loop passes, timer checks and state transitions of all state machines.
+ * When get_time() is driven by a simulated clock (host run against a
+ * scripted source, see support/pd_bench), results don't depend on host
+ * speed and can be compared between builds. On target, the same counters
+ * show real negotiation cost.
+ */
+
+#ifndef __PD_BENCH_H
+#define __PD_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pd_config.h"
+#include "pd_port_arena.h"
+
+/* Contracts recorded per attach: SPR, EPR, and a couple of renegotiations */
+#define PD_BENCH_MAX_CONTRACTS 4
+
+/* Contract flags */
+#define PD_BENCH_F_PPS (1 << 0)
+#define PD_BENCH_F_EPR (1 << 1)
+
+struct pd_bench_counters {
+	/* Event loop passes */
+	uint32_t loops;
+	/* pd_timer_is_expired() and expired timers processing calls */
+	uint32_t timer_checks;
+	/* set_state() calls, all state machines */
+	uint32_t transitions;
+};
+
+struct pd_bench_rec {
+	/* Time from PE_SNK_Startup to PS_RDY, us */
+	uint32_t time_us;
+	/* Work done since PE_SNK_Startup */
+	struct pd_bench_counters cnt;
+	/* Negotiated revision, enum pd_rev_type */
+	uint8_t rev;
+	/* PD_BENCH_F_* */
+	uint8_t flags;
+};
+
+#ifdef CONFIG_PD_BENCH
+
+/* Running counters, written by event loop only */
+extern struct pd_bench_counters PD_PORT_DATA(pd_bench_cnt);
+
+static inline void pd_bench_loop(int port)
+{
+	pd_bench_cnt[port].loops++;
+}
+
+static inline void pd_bench_timer_check(int port)
+{
+	pd_bench_cnt[port].timer_checks++;
+}
+
+static inline void pd_bench_transition(int port)
+{
+	pd_bench_cnt[port].transitions++;
+}
+
+/*
+ * Called by PE on PE_SNK_Startup entry. Resets counters and records.
+ */
+void pd_bench_start(int port);
+
+/*
+ * Called by PE when PS_RDY is received.
+ */
+void pd_bench_contract(int port, int rev, bool epr);
+
+/**
+ * Copy contracts recorded since the last PE_SNK_Startup. Call from event
+ * loop context, or when port is idle.
+ *
+ * @param port USB-C port number
+ * @param buf  Destination
+ * @param max  Size of `buf`, in records
+ * @return Number of records copied
+ */
+int pd_bench_read(int port, struct pd_bench_rec *buf, int max);
+
+/**
+ * Print recorded contracts, one per line.
+ *
+ * @param port  USB-C port number
+ * @param print printf-like output function
+ */
+void pd_bench_dump(int port, int (*print)(const char *format, ...));
+
+#else
+
+static inline void pd_bench_loop(int port)
+{
+}
+
+static inline void pd_bench_timer_check(int port)
+{
+}
+
+static inline void pd_bench_transition(int port)
+{
+}
+
+static inline void pd_bench_start(int port)
+{
+}
+
+static inline void pd_bench_contract(int port, int rev, bool epr)
+{
+}
+
+#endif /* CONFIG_PD_BENCH */
+
+#endif /* __PD_BENCH_H */
@@ -0,0 +1,147 @@
+/*
+ * Wire-level PD packet capture (CONFIG_PD_CAPTURE).
+ *
+ * Protocol layer records every packet passed to / received from TCPC into
+ * per-port ring, with a microsecond timestamp. Recording is a fixed size
+ * copy, cheap enough to stay enabled on production units. Ring can be
+ * exported in pcap format, see pd_capture_write_pcap().
+ *
+ * Timestamps are full 64-bit get_time(), so records stay ordered over any
+ * uptime. RX time comes from TCPC RX queue as low word only (it wraps every
+ * ~71.6 minutes), and is extended when the packet is recorded. So a packet
+ * must be recorded less than ~71.6 minutes after reception, which PRL always
+ * does. pcap keeps seconds in 32 bits, enough for ~136 years of uptime.
+ */
+
+#ifndef __PD_CAPTURE_H
+#define __PD_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pd_config.h"
+
+/*
+ * pcap link type. There is no registered one for USB PD, so a user
+ * reserved type is used. Each packet starts with 4-byte pseudo header:
+ *
+ *   byte 0: SOP* (enum tcpci_msg_type; 5 - Hard Reset, 6 - Cable Reset)
+ *   byte 1: bit 0 - direction (0 - RX, 1 - TX),
+ *           bits 1..3 - TX status (enum pd_capture_tx_status)
+ *   byte 2: USB-C port number
+ *   byte 3: reserved, 0
+ *
+ * followed by message as on the wire: 16-bit header, then data objects,
+ * all little endian. Resets have no message bytes. See
+ * support/pd_capture.lua for Wireshark dissector.
+ */
+#define PD_CAPTURE_LINKTYPE 147 /* LINKTYPE_USER0 */
+
+#define PD_CAPTURE_PSEUDO_HDR_LEN 4
+
+/* Record flags */
+#define PD_CAPTURE_F_TX (1 << 0)
+#define PD_CAPTURE_F_STATUS_SHIFT 1
+#define PD_CAPTURE_F_STATUS_MASK (7 << PD_CAPTURE_F_STATUS_SHIFT)
+
+enum pd_capture_tx_status {
+	/* RX packet, or TX result was not reported yet */
+	PD_CAPTURE_TX_PENDING,
+	PD_CAPTURE_TX_SUCCESS,
+	PD_CAPTURE_TX_DISCARDED,
+	PD_CAPTURE_TX_FAILED,
+};
+
+struct pd_capture_rec {
+	/* get_time(), us */
+	uint64_t ts;
+	uint16_t header;
+	/* enum tcpci_msg_type */
+	uint8_t sop;
+	/* PD_CAPTURE_F_* */
+	uint8_t flags;
+	/* Data objects, PD_HEADER_CNT(header) are valid */
+	uint32_t payload[7];
+};
+
+/*
+ * Sink for pd_capture_write_pcap(). Returns non-zero to abort export.
+ */
+typedef int (*pd_capture_write_fn)(void *ctx, const void *data, int len);
+
+#ifdef CONFIG_PD_CAPTURE
+
+/**
+ * Record received packet. Called by PRL for the message it is processing.
+ *
+ * @param port    USB-C port number
+ * @param ts      Reception time, low word of get_time(), not older than
+ *                ~71.6 minutes
+ * @param header  PD message header, with SOP* in upper bits
+ * @param payload Data objects
+ */
+void pd_capture_rx(int port, uint32_t ts, uint32_t header,
+		   const uint32_t *payload);
+
+/**
+ * Record packet passed to TCPC for transmission. Result is filled later by
+ * pd_capture_tx_status().
+ *
+ * @param port    USB-C port number
+ * @param type    Transmit type
+ * @param header  PD message header, unused for resets
+ * @param payload Data objects
+ */
+void pd_capture_tx(int port, int type, uint32_t header,
+		   const uint32_t *payload);
+
+/**
+ * Store TX result into the last recorded TX packet. Can be called from
+ * TCPC alert context.
+ *
+ * @param port   USB-C port number
+ * @param status enum tcpc_transmit_complete
+ */
+void pd_capture_tx_status(int port, int status);
+
+/**
+ * Copy captured packets of a port, oldest first. Can be called from any
+ * context; records overwritten while copying are dropped.
+ *
+ * @param port USB-C port number
+ * @param buf  Destination buffer
+ * @param max  Size of destination buffer, in records
+ * @return Number of records copied
+ */
+int pd_capture_read(int port, struct pd_capture_rec *buf, int max);
+
+/**
+ * Export captured packets of all ports as pcap file. Rings of all ports are
+ * merged by timestamp, oldest first. Records are copied one by one, so no
+ * big buffer is needed.
+ *
+ * @param write Output sink
+ * @param ctx   Sink context
+ * @return 0 on success, else value returned by sink
+ */
+int pd_capture_write_pcap(pd_capture_write_fn write, void *ctx);
+
+#else
+
+static inline void pd_capture_rx(int port, uint32_t ts, uint32_t header,
+				 const uint32_t *payload)
+{
+}
+
+static inline void pd_capture_tx(int port, int type, uint32_t header,
+				 const uint32_t *payload)
+{
+}
+
+static inline void pd_capture_tx_status(int port, int status)
+{
+}
+
+#endif /* CONFIG_PD_CAPTURE */
+
+#endif /* __PD_CAPTURE_H */
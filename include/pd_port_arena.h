@@ -0,0 +1,99 @@
+/*
+ * Per-port state storage (CONFIG_PD_PORT_ARENA).
+ *
+ * By default per-port state of all modules is kept in static arrays, sized
+ * by CONFIG_USB_PD_PORT_MAX_COUNT. With CONFIG_PD_PORT_ARENA the same arrays
+ * are carved at init from memory provided by application, for the number
+ * of ports actually present. So one image can serve boards with different
+ * port count, and CONFIG_USB_PD_PORT_MAX_COUNT only sets the upper limit.
+ *
+ * Modules declare such arrays with PD_PORT_DATA(), and keep indexing them
+ * by port as usual.
+ */
+
+#ifndef __PD_PORT_ARENA_H
+#define __PD_PORT_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pd_config.h"
+
+#ifdef CONFIG_PD_PORT_ARENA
+
+/* Per-port array, storage is assigned by pd_port_arena_init() */
+#define PD_PORT_DATA(name) (*name)
+
+/*
+ * Take storage for `count` ports of array `name`, from module's hook.
+ * `name` is assigned only when arena is carved, not when size is counted.
+ */
+#define PD_PORT_DATA_TAKE(name, count)                                  \
+	do {                                                            \
+		void *p_ = pd_port_arena_take(sizeof(*(name)) * (count)); \
+		if (p_)                                                 \
+			(name) = p_;                                    \
+	} while (0)
+
+/* Number of ports, set by pd_port_arena_init() */
+extern int pd_port_count;
+
+/**
+ * Get arena size needed for given number of ports. Can be called at any
+ * time, also after pd_port_arena_init().
+ *
+ * @param count Number of ports, 1..CONFIG_USB_PD_PORT_MAX_COUNT
+ * @return Size, bytes
+ */
+size_t pd_port_arena_size(int count);
+
+/**
+ * Carve per-port state from arena. Must be called once, before any other
+ * PD function, including TCPC drivers and pd_loop_*(). Arena must stay
+ * valid forever, and be aligned to max_align_t. It is zeroed here.
+ *
+ * board_get_usb_pd_port_count() must not return more than `count`.
+ *
+ * @param arena Memory for per-port state
+ * @param size  Size of `arena`, at least pd_port_arena_size(count)
+ * @param count Number of ports, 1..CONFIG_USB_PD_PORT_MAX_COUNT
+ * @return true on success, false on bad count, size or alignment
+ */
+bool pd_port_arena_init(void *arena, size_t size, int count);
+
+/*
+ * Used by PD_PORT_DATA_TAKE(). Returns NULL while arena size is counted.
+ */
+void *pd_port_arena_take(size_t size);
+
+/*
+ * True while arena is carved, false while its size is counted.
+ */
+bool pd_port_arena_carving(void);
+
+/*
+ * Module hooks, called by pd_port_arena_init() and pd_port_arena_size().
+ * Each takes storage of its per-port arrays with PD_PORT_DATA_TAKE().
+ * On size counting pass storage is not assigned, so hook must not
+ * initialize it then, see pd_port_arena_carving().
+ */
+void pe_port_arena_init(int count);
+void prl_port_arena_init(int count);
+void dpm_port_arena_init(int count);
+void pd_timer_port_arena_init(int count);
+void pd_loop_port_arena_init(int count);
+void pd_snk_port_arena_init(int count);
+void tcpm_rx_queue_port_arena_init(int count);
+void usb_sm_port_arena_init(int count);
+void pd_capture_port_arena_init(int count);
+void pd_bench_port_arena_init(int count);
+
+#else
+
+#define PD_PORT_DATA(name) (name)[CONFIG_USB_PD_PORT_MAX_COUNT]
+
+#define pd_port_count CONFIG_USB_PD_PORT_MAX_COUNT
+
+#endif /* CONFIG_PD_PORT_ARENA */
+
+#endif /* __PD_PORT_ARENA_H */
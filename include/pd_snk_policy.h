@@ -0,0 +1,281 @@
+/*
+ * Sink power policy: selection of source PDO to request.
+ *
+ * Implements pd_process_source_cap() / pd_build_request(), used by PE.
+ * Source capabilities are decoded once per Source_Capabilities message into
+ * a compact per-port table. Each request then scores all entries against
+ * the port's policy, so changing policy or max voltage needs no re-decode.
+ * Fixed, Variable, Battery, SPR PPS and EPR AVS PDOs are supported.
+ */
+
+#ifndef __PD_SNK_POLICY_H
+#define __PD_SNK_POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pd_config.h"
+
+enum pd_snk_policy_mode {
+	/* Highest power, lower voltage wins on a tie */
+	PD_SNK_POLICY_MAX_POWER,
+	/*
+	 * Voltage closest to `pref_mv`, among PDOs giving at least `op_mw`
+	 * (or the most powerful ones, if none does)
+	 */
+	PD_SNK_POLICY_PREFER_VOLTAGE,
+	/* Highest power after conversion losses, see `eff` */
+	PD_SNK_POLICY_EFFICIENCY,
+};
+
+/* Point of sink input converter efficiency curve */
+struct pd_snk_eff_point {
+	uint16_t mv;
+	/* Efficiency at `mv`, percent */
+	uint8_t pct;
+};
+
+struct pd_snk_policy {
+	enum pd_snk_policy_mode mode;
+	/* Acceptable input voltage window, mV */
+	uint16_t min_mv;
+	uint16_t max_mv;
+	/* Preferred voltage, mV. Also target for programmable PDOs */
+	uint16_t pref_mv;
+	/* Current limit of sink input, mA. 0 - no limit */
+	uint16_t max_ma;
+	/*
+	 * Power limit, mW, 0 - no limit. Applies in all modes, can be
+	 * lowered at runtime as thermal cap.
+	 */
+	uint32_t max_mw;
+	/* Power needed for normal operation, mW. Less sets Cap Mismatch */
+	uint32_t op_mw;
+	/* Also consider PPS and AVS PDOs */
+	bool allow_apdo;
+	/* Extra RDO flags, RDO_COMM_CAP / RDO_NO_SUSPEND */
+	uint32_t rdo_flags;
+	/* Efficiency curve, sorted by voltage, for PD_SNK_POLICY_EFFICIENCY */
+	const struct pd_snk_eff_point *eff;
+	uint8_t eff_cnt;
+};
+
+/* Operating point chosen by the last pd_build_request() */
+struct pd_snk_selection {
+	/* Requested PDO, as received from source */
+	uint32_t pdo;
+	/* Object position, 1-based, 0 before first request */
+	uint8_t pos;
+	bool mismatch;
+	/* Requested voltage (minimal one for Variable / Battery) and current */
+	uint16_t mv;
+	uint16_t ma;
+};
+
+/**
+ * Set sink policy of a port. Default is PD_SNK_POLICY_MAX_POWER with no
+ * limits. Takes effect on next request; to renegotiate an existing
+ * contract, also call pd_dpm_request(port, DPM_REQUEST_NEW_POWER_LEVEL).
+ * Policy is read by event loop, so call it from the same context, or
+ * before port is started.
+ *
+ * @param port   USB-C port number
+ * @param policy Policy, copied. `eff` table must stay valid.
+ */
+void pd_snk_set_policy(int port, const struct pd_snk_policy *policy);
+
+/**
+ * Get current sink policy of a port.
+ *
+ * @param port USB-C port number
+ * @return Policy
+ */
+const struct pd_snk_policy *pd_snk_get_policy(int port);
+
+/**
+ * Get operating point selected by the last request.
+ *
+ * @param port USB-C port number
+ * @return Selection
+ */
+const struct pd_snk_selection *pd_snk_get_selection(int port);
+
+/*
+ * Called by PE when Request got PS_RDY (accepted) or Reject / Wait.
+ */
+void pd_snk_request_done(int port, bool accepted);
+
+/*
+ * PPS / AVS closed-loop control (CONFIG_PD_SNK_PPS).
+ *
+ * While started, requests go to the programmable PDO covering target
+ * voltage, instead of the one chosen by policy. Target can be changed as
+ * often as needed: changes smaller than a step are ignored, and the rest
+ * are coalesced into one Request per `min_interval_ms`. The same Request
+ * also serves as the mandatory re-request (tPPSRequest), so when the
+ * target moves often no extra keep-alive traffic is sent. AVS needs no
+ * re-requests at all, it is covered by EPR_KeepAlive.
+ */
+
+struct pd_snk_pps_config {
+	/* Dead band, smaller target changes don't cause a Request */
+	uint16_t step_mv;
+	uint16_t step_ma;
+	/* Minimal time between Requests, ms */
+	uint16_t min_interval_ms;
+};
+
+/* Content of the last PPS_Status message, see PD r3.1 6.5.10 */
+struct pd_snk_pps_status {
+	/* Source output voltage, mV, 0xFFFF if not supported */
+	uint16_t out_mv;
+	/* Source output current, mA, 0xFFFF if not supported */
+	uint16_t out_ma;
+	/* Real Time Flags: PTF (bits 1-2), OMF (bit 3, current limit mode) */
+	uint8_t flags;
+	/* Incremented on each received PPS_Status */
+	uint8_t seq;
+};
+
+/* Request to PS_RDY latency statistics, us */
+struct pd_snk_pps_stats {
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint64_t sum_us;
+	/* Requests answered with Reject / Wait */
+	uint32_t rejected;
+};
+
+#ifdef CONFIG_PD_SNK_PPS
+
+/**
+ * Start closed-loop control. Can be called from any context, but not
+ * concurrently with itself. Takes effect on the next loop pass.
+ *
+ * @param port USB-C port number
+ * @param cfg  Step and interval, copied
+ * @param mv   Initial target voltage, mV
+ * @param ma   Initial target current, mA
+ */
+void pd_snk_pps_start(int port, const struct pd_snk_pps_config *cfg,
+		      uint16_t mv, uint16_t ma);
+
+/**
+ * Stop closed-loop control, and renegotiate power by policy. Can be called
+ * from any context, takes effect on the next loop pass.
+ *
+ * @param port USB-C port number
+ */
+void pd_snk_pps_stop(int port);
+
+/**
+ * Set new target. Can be called from any context.
+ *
+ * @param port USB-C port number
+ * @param mv   Target voltage, mV
+ * @param ma   Target current, mA
+ */
+void pd_snk_pps_set_target(int port, uint16_t mv, uint16_t ma);
+
+/**
+ * Ask source for PPS_Status. Result appears in pd_snk_pps_get_status(),
+ * with `seq` incremented.
+ *
+ * @param port USB-C port number
+ */
+void pd_snk_pps_request_status(int port);
+
+/**
+ * Get the last received PPS_Status.
+ *
+ * @param port USB-C port number
+ * @return PPS status
+ */
+const struct pd_snk_pps_status *pd_snk_pps_get_status(int port);
+
+/**
+ * Get Request to PS_RDY latency statistics, since controller start.
+ *
+ * @param port USB-C port number
+ * @return Statistics
+ */
+const struct pd_snk_pps_stats *pd_snk_pps_get_stats(int port);
+
+/*
+ * Called by event loop on each pass, issues Requests when needed.
+ */
+void pd_snk_pps_run(int port);
+
+/*
+ * Called by PE with PPS_Status payload (4 bytes).
+ */
+void pd_snk_pps_status_received(int port, const uint8_t *buf);
+
+#else
+
+static inline void pd_snk_pps_run(int port)
+{
+}
+
+static inline void pd_snk_pps_status_received(int port, const uint8_t *buf)
+{
+}
+
+#endif /* CONFIG_PD_SNK_PPS */
+
+/*
+ * Known-charger cache (CONFIG_PD_SNK_CACHE).
+ *
+ * Remembers the last few Source_Capabilities sets, by hash of PDOs and
+ * sink policy, with the operating point accepted by that source and the
+ * result of EPR entry. On re-attach to a known charger, Request is built
+ * without running selection, and EPR entry is not tried again if the
+ * source refused it as not EPR capable. Transient refusals (cable, VCONN,
+ * "unable at this time") are not cached. Cache is shared by all ports.
+ */
+
+#ifdef CONFIG_PD_SNK_CACHE
+
+/**
+ * Load cache, saved by pd_snk_cache_save() hook. Call before ports are
+ * started.
+ *
+ * @param data Saved content
+ * @param len  Size of saved content
+ * @return true on success, false if content is from incompatible build
+ */
+bool pd_snk_cache_restore(const void *data, int len);
+
+/**
+ * Forget all known chargers.
+ */
+void pd_snk_cache_clear(void);
+
+/*
+ * Called by PE in Ready state. Returns true if current source refused EPR
+ * entry before.
+ */
+bool pd_snk_cache_skip_epr(int port);
+
+/*
+ * Called by PE with EPR entry result, `reason` is EPR_Mode data of
+ * ENTER_FAILED.
+ */
+void pd_snk_cache_epr_done(int port, bool entered, uint8_t reason);
+
+#else
+
+static inline bool pd_snk_cache_skip_epr(int port)
+{
+	return false;
+}
+
+static inline void pd_snk_cache_epr_done(int port, bool entered,
+					 uint8_t reason)
+{
+}
+
+#endif /* CONFIG_PD_SNK_CACHE */
+
+#endif /* __PD_SNK_POLICY_H */
@@ -267,6 +267,13 @@ static inline int tcpm_transmit(int port, enum tcpci_msg_type type,
 	return tcpc_config[port].drv->transmit(port, type, header, data);
 }
 
+static inline uint32_t *tcpm_get_tx_buf(int port)
+{
+	return tcpc_config[port].drv->get_tx_buf ?
+		       tcpc_config[port].drv->get_tx_buf(port) :
+		       NULL;
+}
+
 static inline bool tcpm_get_snk_ctrl(int port)
 {
 	return tcpc_config[port].drv->get_snk_ctrl ?
@@ -426,6 +433,30 @@ static inline int tcpm_tcpc_has_frs_control(int port)
  */
 int tcpm_dequeue_message(int port, uint32_t *payload, int *header);
 
+/**
+ * Gets the next waiting RX message without copying it out of the RX queue.
+ *
+ * The message stays owned by the queue until tcpm_release_message() is
+ * called, so the payload may be referenced in place. Calling this again
+ * before release returns the same message. A peeked message is not reported
+ * by tcpm_has_pending_message() anymore.
+ *
+ * @param port Type-C port number
+ * @param payload Set to the payload of PD message in the RX queue slot
+ * @param header The header of PD message
+ *
+ * @return EC_SUCCESS or error
+ */
+int tcpm_peek_message(int port, const uint32_t **payload, int *header);
+
+/**
+ * Returns the RX queue slot of the message got by tcpm_peek_message() back
+ * to the queue. Does nothing if no message is peeked.
+ *
+ * @param port Type-C port number
+ */
+void tcpm_release_message(int port);
+
 /**
  * Returns true if the tcpm has RX messages waiting to be consumed.
  */
@@ -438,6 +469,22 @@ int tcpm_has_pending_message(int port);
  */
 void tcpm_clear_pending_messages(int port);
 
+/**
+ * Returns RX timestamp of the message got by tcpm_peek_message().
+ *
+ * @param port Type-C port number
+ *
+ * @return Low 32 bits of get_time() when message was read from TCPC
+ */
+uint32_t tcpm_get_message_rx_ts(int port);
+
+/**
+ * Returns number of RX messages dropped because the RX queue was full.
+ *
+ * @param port Type-C port number
+ */
+uint32_t tcpm_get_rx_overflows(int port);
+
 /**
  * Enable/Disable TCPC Fast Role Swap detection
  *
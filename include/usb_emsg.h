@@ -0,0 +1,59 @@
+/* Copyright 2019 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* USB Extended message buffer */
+
+#ifndef __CROS_EC_USB_EMSG_H
+#define __CROS_EC_USB_EMSG_H
+
+#include "pd_port_arena.h"
+#include "usb_pd.h"
+
+/*
+ * Extended message buffer size. Spec allows up to 260 bytes, but sink only
+ * needs to reassemble a few short messages, so the size is configurable.
+ */
+#ifdef CONFIG_USB_PD_EXTENDED_BUFFER_SIZE
+#define EXTENDED_BUFFER_SIZE CONFIG_USB_PD_EXTENDED_BUFFER_SIZE
+#else
+#define EXTENDED_BUFFER_SIZE 260
+#endif
+
+/* Extended message buffer */
+struct extended_msg {
+	uint32_t header;
+	uint32_t len;
+	uint8_t buf[EXTENDED_BUFFER_SIZE];
+};
+
+/*
+ * Message to transmit. buf points to the TCPC driver TX buffer, if the driver
+ * provides one (see tcpm_get_tx_buf()), so PE builds payload in place. Up to
+ * 7 data objects fit.
+ */
+struct tx_msg {
+	uint32_t header;
+	uint32_t len;
+	uint8_t *buf;
+};
+
+/*
+ * Received message. Payload is not copied out of the TCPM RX queue: buf
+ * points to the queue slot, held by PRL until the PE is done with the
+ * message (see prl_rx_release()). Extended messages are the exception, those
+ * are reassembled (without extended header) in the PRL per-port buffer of
+ * EXTENDED_BUFFER_SIZE bytes.
+ */
+struct rx_msg {
+	uint32_t header;
+	uint32_t len;
+	const uint8_t *buf;
+};
+
+/* Defined in usb_prl_sm.c */
+extern struct tx_msg PD_PORT_DATA(tx_emsg);
+extern struct rx_msg PD_PORT_DATA(rx_emsg);
+
+#endif /* __CROS_EC_USB_EMSG_H */
@@ -106,6 +106,7 @@ enum pdo_peak_overcurrent {
 #define PDO_FIXED_FRS_CURR_1A5_AT_5V (2 << 23)
 #define PDO_FIXED_FRS_CURR_3A0_AT_5V (3 << 23)
 #define PDO_FIXED_EPR_MODE_CAPABLE BIT(23)
+#define PDO_FIXED_UNCHUNK_EXT BIT(24) /* Unchunked Extended Messages */
 #define PDO_FIXED_PEAK_CURR(peak) ((peak & 3) << 20) /* Peak current */
 #define PDO_FIXED_VOLT(mv) (((mv) / 50) << 10) /* Voltage in 50mV units */
 #define PDO_FIXED_CURR(ma) (((ma) / 10) << 0) /* Max current in 10mA units */
@@ -167,6 +168,7 @@ enum pdo_augmented_pps {
 #define RDO_CAP_MISMATCH BIT(26)
 #define RDO_COMM_CAP BIT(25)
 #define RDO_NO_SUSPEND BIT(24)
+#define RDO_UNCHUNK_EXT BIT(23) /* Unchunked Extended Messages */
 #define RDO_EPR_MODE_CAPABLE BIT(22)
 #define RDO_FIXED_VAR_OP_CURR(ma) ((((ma) / 10) & 0x3FF) << 10)
 #define RDO_FIXED_VAR_MAX_CURR(ma) ((((ma) / 10) & 0x3FF) << 0)
@@ -182,6 +184,17 @@ enum pdo_augmented_pps {
 	(RDO_OBJ_POS(n) | (flags) | RDO_BATT_OP_POWER(op_mw) | \
 	 RDO_BATT_MAX_POWER(max_mw))
 
+/* Programmable RDO, for SPR PPS and EPR AVS APDOs */
+#define RDO_PPS_VOLT(mv) ((((mv) / 20) & 0xFFF) << 9) /* 20mV units */
+#define RDO_AVS_VOLT(mv) ((((mv) / 25) & 0xFFF) << 9) /* 25mV units */
+#define RDO_PROG_CURR(ma) ((((ma) / 50) & 0x7F) << 0) /* 50mA units */
+
+#define RDO_PPS(n, mv, ma, flags) \
+	(RDO_OBJ_POS(n) | (flags) | RDO_PPS_VOLT(mv) | RDO_PROG_CURR(ma))
+
+#define RDO_AVS(n, mv, ma, flags) \
+	(RDO_OBJ_POS(n) | (flags) | RDO_AVS_VOLT(mv) | RDO_PROG_CURR(ma))
+
 /* BDO : BIST Data Object
  * 31:28 BIST Mode
  *       In PD 3.0, all but Carrier Mode 2 (as Carrier Mode) and Test Data are
@@ -1146,6 +1159,9 @@ enum pd_dpm_request {
 	DPM_REQUEST_GET_REVISION = BIT(24),
 	DPM_REQUEST_EPR_MODE_ENTRY = BIT(25),
 	DPM_REQUEST_EPR_MODE_EXIT = BIT(26),
+	DPM_REQUEST_GET_SRC_CAP_EXT = BIT(27),
+	DPM_REQUEST_GET_STATUS = BIT(28),
+	DPM_REQUEST_GET_PPS_STATUS = BIT(29),
 };
 
 /**
@@ -1367,6 +1383,9 @@ struct pd_sdb {
 	uint8_t power_state_change;
 };
 
+/* Source Capabilities Extended Data Block size, PD Rev 3.1 6.5.1 */
+#define PD_SCEDB_SIZE 25
+
 enum pd_sdb_power_state {
 	PD_SDB_POWER_STATE_NOT_SUPPORTED = 0,
 	PD_SDB_POWER_STATE_S0 = 1,
@@ -1656,6 +1675,42 @@ void pd_prevent_low_power_mode(int port, int prevent);
  */
 void pd_process_source_cap(int port, int cnt, uint32_t *src_caps);
 
+/**
+ * Build Request Data Object for the last processed source capabilities.
+ *
+ * @param vpd_vdo  VPD VDO, if charging through VPD
+ * @param rdo      Request Data Object
+ * @param ma       Requested current, mA
+ * @param mv       Requested voltage, mV
+ * @param port     USB-C port number
+ */
+void pd_build_request(int32_t vpd_vdo, uint32_t *rdo, uint32_t *ma,
+		      uint32_t *mv, int port);
+
+/**
+ * Find PDO index that offers the most power, not exceeding max voltage.
+ * Programmable PDOs are skipped.
+ *
+ * @param src_cap_cnt  Number of Power Data Objects
+ * @param src_caps     Source capabilities
+ * @param max_mv       Maximum voltage, mV
+ * @param selected_pdo Selected PDO
+ * @return Index of selected PDO, 0 (vSafe5V) if nothing better
+ */
+int pd_find_pdo_index(uint32_t src_cap_cnt, const uint32_t *const src_caps,
+		      int max_mv, uint32_t *selected_pdo);
+
+/**
+ * Extract power information from a Power Data Object.
+ *
+ * @param pdo    Power Data Object
+ * @param ma     Current, mA (at minimal voltage for power limited PDOs)
+ * @param max_mv Maximum voltage, mV
+ * @param min_mv Minimum voltage, mV
+ */
+void pd_extract_pdo_power(uint32_t pdo, uint32_t *ma, uint32_t *max_mv,
+			  uint32_t *min_mv);
+
 /**
  * Reduce the sink power consumption to a minimum value.
  *
@@ -3193,6 +3248,27 @@ bool pd_get_partner_usb_comm_capable(int port);
  */
 struct rmdo pd_get_partner_rmdo(int port);
 
+/**
+ * Gets the last Source_Capabilities_Extended data block received from the
+ * port partner, requested with DPM_REQUEST_GET_SRC_CAP_EXT.
+ *
+ * @param port  USB-C port number
+ * @param scedb Buffer of PD_SCEDB_SIZE bytes
+ * @return Number of bytes copied, 0 if none was received
+ */
+int pd_get_src_cap_ext(int port, uint8_t *scedb);
+
+/**
+ * Gets the last Status data block received from the port partner, requested
+ * with DPM_REQUEST_GET_STATUS. Fields not sent by the partner (PD 3.0
+ * sources send 6 bytes) are zero.
+ *
+ * @param port USB-C port number
+ * @param sdb  Status data block
+ * @return Number of bytes received, 0 if none
+ */
+int pd_get_partner_status(int port, struct pd_sdb *sdb);
+
 /**
  * Return true if PD is in disconnect state
  *
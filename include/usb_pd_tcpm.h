@@ -327,6 +327,17 @@ struct tcpm_drv {
 	int (*transmit)(int port, enum tcpci_msg_type type, uint16_t header,
 			const uint32_t *data);
 
+	/**
+	 * Optional. Returns the payload area of the driver TX buffer. Message
+	 * built there is passed to transmit() as data without extra copying.
+	 * Must be 32-bit aligned and hold at least 7 data objects.
+	 *
+	 * @param port Type-C port number
+	 *
+	 * @return Pointer to the payload area
+	 */
+	uint32_t *(*get_tx_buf)(int port);
+
 	/**
 	 * TCPC is asserting alert
 	 *
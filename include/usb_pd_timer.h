@@ -11,228 +11,292 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "pd_config.h"
+
 /*
- * List of all timers that will be managed by usb_pd_timer
+ * Timers can be dropped from build when the feature using them is disabled.
+ * Dropped timers take no storage and referencing one is a compile error.
  */
-enum pd_task_timer {
-	/*
-	 * Timer to check if a USB PD power button press exceeds the long press
-	 * time limit.
-	 */
-	DPM_TIMER_PD_BUTTON_LONG_PRESS,
-
-	/*
-	 * Timer to check if a USB PD power button press exceeds the short press
-	 * time limit.
-	 */
-	DPM_TIMER_PD_BUTTON_SHORT_PRESS,
-
-	/*
-	 * In BIST_TX mode, this timer is used by a UUT to ensure that a
-	 * Continuous BIST Mode (i.e. BIST Carrier Mode) is exited in a timely
-	 * fashion.
-	 *
-	 * In BIST_RX mode, this timer is used to give the port partner time
-	 * to respond.
-	 */
-	PE_TIMER_BIST_CONT_MODE,
-
-	/*
-	 * PD 3.0, version 2.0, section 6.6.18.1: The ChunkingNotSupportedTimer
-	 * is used by a Source or Sink which does not support multi-chunk
-	 * Chunking but has received a Message Chunk. The
-	 * ChunkingNotSupportedTimer Shall be started when the last bit of the
-	 * EOP of a Message Chunk of a multi-chunk Message is received. The
-	 * Policy Engine Shall Not send its Not_Supported Message before the
-	 * ChunkingNotSupportedTimer expires.
-	 */
-	PE_TIMER_CHUNKING_NOT_SUPPORTED,
-
-	/*
-	 * PD 3.0, rev. 3.1, v. 1.2, section 6.6.10.3: The DataResetFailTimer
-	 * Shall be used by the DFP’s Policy Engine to ensure the Data Reset
-	 * process completes within tDataResetFail of the last bit of the
-	 * GoodCRC acknowledging the Accept Message in response to the
-	 * Data_Reset Message.
-	 */
-	PE_TIMER_DATA_RESET_FAIL,
-
-	/*
-	 * This timer is used during an Explicit Contract when discovering
-	 * whether a Port Partner is PD Capable using SOP'.
-	 */
-	PE_TIMER_DISCOVER_IDENTITY,
-
-	/*
-	 * The NoResponseTimer is used by the Policy Engine in a Source
-	 * to determine that its Port Partner is not responding after a
-	 * Hard Reset.
-	 */
-	PE_TIMER_NO_RESPONSE,
-
-	/*
-	 * This timer tracks the time after receiving a Wait message in
-	 * response to a PR_Swap message.
-	 */
-	PE_TIMER_PR_SWAP_WAIT,
-
-	/*
-	 * This timer is used in a Source to ensure that the Sink has had
-	 * sufficient time to process Hard Reset Signaling before turning
-	 * off its power supply to VBUS.
-	 */
-	PE_TIMER_PS_HARD_RESET,
-
-	/*
-	 * This timer combines the PSSourceOffTimer and PSSourceOnTimer timers.
-	 * For PSSourceOffTimer, when this DRP device is currently acting as a
-	 * Sink, this timer times out on a PS_RDY Message during a Power Role
-	 * Swap sequence.
-	 *
-	 * For PSSourceOnTimer, when this DRP device is currently acting as a
-	 * Source that has just stopped sourcing power and is waiting to start
-	 * sinking power to timeout on a PS_RDY Message during a Power Role
-	 * Swap.
-	 */
-	PE_TIMER_PS_SOURCE,
-
-	/*
-	 * This timer is started when a request for a new Capability has been
-	 * accepted and will timeout after PD_T_PS_TRANSITION if a PS_RDY
-	 * Message has not been received.
-	 */
-	PE_TIMER_PS_TRANSITION,
-
-	/*
-	 * This timer is used to ensure that a Message requesting a response
-	 * (e.g. Get_Source_Cap Message) is responded to within a bounded time
-	 * of PD_T_SENDER_RESPONSE.
-	 */
-	PE_TIMER_SENDER_RESPONSE,
-
-	/*
-	 *  6.6.21 EPR Timers of PD R3.1 V1.6
-	 *  This timer is used to ensure the EPR Mode entry process completes
-	 *  within PD_T_ENTER_EPR.
-	 */
-	PE_TIMER_SINK_EPR_ENTER,
-	PE_TIMER_SINK_EPR_KEEP_ALIVE,
-
-	/*
-	 * This timer is used to ensure that the time before the next Sink
-	 * Request Message, after a Wait Message has been received from the
-	 * Source in response to a Sink Request Message.
-	 */
-	PE_TIMER_SINK_REQUEST,
-
-	/*
-	 * Prior to a successful negotiation, a Source Shall use the
-	 * SourceCapabilityTimer to periodically send out a
-	 * Source_Capabilities Message.
-	 */
-	PE_TIMER_SOURCE_CAP,
-
-	/*
-	 * Used to wait for tSrcTransition between sending an Accept for a
-	 * Request or receiving a GoToMin and transitioning the power supply.
-	 * See PD 3.0, table 7-11 and table 7-22 This is not a named timer in
-	 * the spec.
-	 */
-	PE_TIMER_SRC_TRANSITION,
-
-	/*
-	 * This timer is used by the new Source, after a Power Role Swap or
-	 * Fast Role Swap, to ensure that it does not send Source_Capabilities
-	 * Message before the new Sink is ready to receive the
-	 * Source_Capabilities Message.
-	 */
-	PE_TIMER_SWAP_SOURCE_START,
-
-	/* Temporary available timeout timer */
-	PE_TIMER_TIMEOUT,
-
-	/*
-	 * The amount of timer that the DFP shall wait for the UFP to discharge
-	 * VCONN (and send PS_RDY) during Data Reset. See PD 3.0, rev. 3.1, v.
-	 * 1.2, section 6.6.10.1 VCONNDischargeTimer.
-	 */
-	PE_TIMER_VCONN_DISCHARGE,
-
-	/*
-	 * This timer is used during a VCONN Swap.
-	 */
-	PE_TIMER_VCONN_ON,
-
-	/*
-	 * The amount of time that VCONN shall remain off during the cable reset
-	 * portion of a Data Reset. See PD 3.0, rev. 3.1, v. 1.2, section 7.1.15
-	 * VCONN Power Cycle.
-	 */
-	PE_TIMER_VCONN_REAPPLIED,
-
-	/*
-	 * This timer is used by the Initiator’s Policy Engine to ensure that
-	 * a Structured VDM Command request needing a response (e.g. Discover
-	 * Identity Command request) is responded to within a bounded time of
-	 * tVDMSenderResponse.
-	 */
-	PE_TIMER_VDM_RESPONSE,
-
-	/*
-	 * For PD2.0, this timer is used to wait 400ms and add some
-	 * jitter of up to 100ms before sending a message.
-	 * NOTE: This timer is not part of the TypeC/PD spec.
-	 */
-	PE_TIMER_WAIT_AND_ADD_JITTER,
-
-	/* Chunk Sender Response timer */
-	PR_TIMER_CHUNK_SENDER_RESPONSE,
-
-	/* Chunk Sender Request timer */
-	PR_TIMER_CHUNK_SENDER_REQUEST,
-
-	/* Hard Reset Complete timer */
-	PR_TIMER_HARD_RESET_COMPLETE,
-
-	/* Sink TX timer */
-	PR_TIMER_SINK_TX,
-
-	/* timeout to limit waiting on TCPC response (not in spec) */
-	PR_TIMER_TCPC_TX_TIMEOUT,
-
-	/* Time a port shall wait before it can determine it is attached */
-	TC_TIMER_CC_DEBOUNCE,
-
-	/* Time to debounce exit low power mode */
-	TC_TIMER_LOW_POWER_EXIT_TIME,
-
-	/* Time to enter low power mode */
-	TC_TIMER_LOW_POWER_TIME,
-
-	/* Role toggle timer */
-	TC_TIMER_NEXT_ROLE_SWAP,
-
-	/*
-	 * Time a Sink port shall wait before it can determine it is detached
-	 * due to the potential for USB PD signaling on CC as described in
-	 * the state definitions.
-	 */
-	TC_TIMER_PD_DEBOUNCE,
+#ifdef CONFIG_AP_POWER_CONTROL
+#define PD_TIMER_USE_BUTTON 1
+#else
+#define PD_TIMER_USE_BUTTON 0
+#endif
+
+#ifdef CONFIG_USB_PD_DATA_RESET_MSG
+#define PD_TIMER_USE_DATA_RESET 1
+#else
+#define PD_TIMER_USE_DATA_RESET 0
+#endif
+
+#ifdef CONFIG_USBC_VCONN
+#define PD_TIMER_USE_VCONN 1
+#else
+#define PD_TIMER_USE_VCONN 0
+#endif
+
+#ifdef CONFIG_USB_PD_DUAL_ROLE
+#define PD_TIMER_USE_DRP 1
+#else
+#define PD_TIMER_USE_DRP 0
+#endif
+
+#ifdef CONFIG_USB_PD_ALT_MODE_DFP
+#define PD_TIMER_USE_VDM 1
+#else
+#define PD_TIMER_USE_VDM 0
+#endif
+
+/* Role swaps and BIST are compiled out of sink-only PE */
+#ifdef CONFIG_PD_SINK_ONLY
+#define PD_TIMER_USE_SWAP 0
+#define PD_TIMER_USE_BIST 0
+#else
+#define PD_TIMER_USE_SWAP 1
+#define PD_TIMER_USE_BIST 1
+#endif
+
+#ifdef CONFIG_PD_SNK_PPS
+#define PD_TIMER_USE_PPS 1
+#else
+#define PD_TIMER_USE_PPS 0
+#endif
+
+#ifdef CONFIG_USB_PD_EXTENDED_MESSAGES
+#define PD_TIMER_USE_CHUNKING 1
+#else
+#define PD_TIMER_USE_CHUNKING 0
+#endif
+
+#ifdef CONFIG_USB_PD_TCPC_LOW_POWER
+#define PD_TIMER_USE_LOW_POWER 1
+#else
+#define PD_TIMER_USE_LOW_POWER 0
+#endif
+
+/* Expand to arguments only if "en" is 1 */
+#define PD_TIMER_IF(en, ...) PD_TIMER_IF_(en, __VA_ARGS__)
+#define PD_TIMER_IF_(en, ...) PD_TIMER_IF_##en(__VA_ARGS__)
+#define PD_TIMER_IF_0(...)
+#define PD_TIMER_IF_1(...) __VA_ARGS__
 
-	/* Generic timer */
-	TC_TIMER_TIMEOUT,
-
-	/*
-	 * Time a port shall wait before it can determine it is
-	 * re-attached during the try-wait process.
-	 */
-	TC_TIMER_TRY_WAIT_DEBOUNCE,
+/*
+ * List of all timers that will be managed by usb_pd_timer, one list per
+ * group. Each entry is X(group, name, enabled), and defines timer
+ * <group>_TIMER_<name>.
+ */
+#define PD_DPM_TIMER_LIST(X) \
+	/* \
+	 * Timer to check if a USB PD power button press exceeds the long press \
+	 * time limit. \
+	 */ \
+	X(DPM, PD_BUTTON_LONG_PRESS, PD_TIMER_USE_BUTTON) \
+	/* \
+	 * Timer to check if a USB PD power button press exceeds the short press \
+	 * time limit. \
+	 */ \
+	X(DPM, PD_BUTTON_SHORT_PRESS, PD_TIMER_USE_BUTTON) \
+	/* \
+	 * PPS controller: minimal time between Requests, to coalesce target \
+	 * changes. \
+	 */ \
+	X(DPM, PPS_INTERVAL, PD_TIMER_USE_PPS) \
+	/* \
+	 * PPS controller: re-request SPR PPS before source's tPPSTimeout \
+	 * expires. \
+	 */ \
+	X(DPM, PPS_KEEPALIVE, PD_TIMER_USE_PPS)
+
+#define PD_PE_TIMER_LIST(X) \
+	/* \
+	 * In BIST_TX mode, this timer is used by a UUT to ensure that a \
+	 * Continuous BIST Mode (i.e. BIST Carrier Mode) is exited in a timely \
+	 * fashion. \
+	 * \
+	 * In BIST_RX mode, this timer is used to give the port partner time \
+	 * to respond. \
+	 */ \
+	X(PE, BIST_CONT_MODE, PD_TIMER_USE_BIST) \
+	/* \
+	 * PD 3.0, version 2.0, section 6.6.18.1: The ChunkingNotSupportedTimer \
+	 * is used by a Source or Sink which does not support multi-chunk \
+	 * Chunking but has received a Message Chunk. The \
+	 * ChunkingNotSupportedTimer Shall be started when the last bit of the \
+	 * EOP of a Message Chunk of a multi-chunk Message is received. The \
+	 * Policy Engine Shall Not send its Not_Supported Message before the \
+	 * ChunkingNotSupportedTimer expires. \
+	 */ \
+	X(PE, CHUNKING_NOT_SUPPORTED, 1) \
+	/* \
+	 * PD 3.0, rev. 3.1, v. 1.2, section 6.6.10.3: The DataResetFailTimer \
+	 * Shall be used by the DFP’s Policy Engine to ensure the Data Reset \
+	 * process completes within tDataResetFail of the last bit of the \
+	 * GoodCRC acknowledging the Accept Message in response to the \
+	 * Data_Reset Message. \
+	 */ \
+	X(PE, DATA_RESET_FAIL, PD_TIMER_USE_DATA_RESET) \
+	/* \
+	 * This timer is used during an Explicit Contract when discovering \
+	 * whether a Port Partner is PD Capable using SOP'. \
+	 */ \
+	X(PE, DISCOVER_IDENTITY, 1) \
+	/* \
+	 * The NoResponseTimer is used by the Policy Engine in a Source \
+	 * to determine that its Port Partner is not responding after a \
+	 * Hard Reset. \
+	 */ \
+	X(PE, NO_RESPONSE, PD_TIMER_USE_DRP) \
+	/* \
+	 * This timer tracks the time after receiving a Wait message in \
+	 * response to a PR_Swap message. \
+	 */ \
+	X(PE, PR_SWAP_WAIT, PD_TIMER_USE_SWAP) \
+	/* \
+	 * This timer is used in a Source to ensure that the Sink has had \
+	 * sufficient time to process Hard Reset Signaling before turning \
+	 * off its power supply to VBUS. \
+	 */ \
+	X(PE, PS_HARD_RESET, PD_TIMER_USE_DRP) \
+	/* \
+	 * This timer combines the PSSourceOffTimer and PSSourceOnTimer timers. \
+	 * For PSSourceOffTimer, when this DRP device is currently acting as a \
+	 * Sink, this timer times out on a PS_RDY Message during a Power Role \
+	 * Swap sequence. \
+	 * \
+	 * For PSSourceOnTimer, when this DRP device is currently acting as a \
+	 * Source that has just stopped sourcing power and is waiting to start \
+	 * sinking power to timeout on a PS_RDY Message during a Power Role \
+	 * Swap. \
+	 */ \
+	X(PE, PS_SOURCE, PD_TIMER_USE_SWAP) \
+	/* \
+	 * This timer is started when a request for a new Capability has been \
+	 * accepted and will timeout after PD_T_PS_TRANSITION if a PS_RDY \
+	 * Message has not been received. \
+	 */ \
+	X(PE, PS_TRANSITION, 1) \
+	/* \
+	 * This timer is used to ensure that a Message requesting a response \
+	 * (e.g. Get_Source_Cap Message) is responded to within a bounded time \
+	 * of PD_T_SENDER_RESPONSE. \
+	 */ \
+	X(PE, SENDER_RESPONSE, 1) \
+	/* \
+	 *  6.6.21 EPR Timers of PD R3.1 V1.6 \
+	 *  This timer is used to ensure the EPR Mode entry process completes \
+	 *  within PD_T_ENTER_EPR. \
+	 */ \
+	X(PE, SINK_EPR_ENTER, 1) \
+	X(PE, SINK_EPR_KEEP_ALIVE, 1) \
+	/* \
+	 * This timer is used to ensure that the time before the next Sink \
+	 * Request Message, after a Wait Message has been received from the \
+	 * Source in response to a Sink Request Message. \
+	 */ \
+	X(PE, SINK_REQUEST, 1) \
+	/* \
+	 * Prior to a successful negotiation, a Source Shall use the \
+	 * SourceCapabilityTimer to periodically send out a \
+	 * Source_Capabilities Message. \
+	 */ \
+	X(PE, SOURCE_CAP, PD_TIMER_USE_DRP) \
+	/* \
+	 * Used to wait for tSrcTransition between sending an Accept for a \
+	 * Request or receiving a GoToMin and transitioning the power supply. \
+	 * See PD 3.0, table 7-11 and table 7-22 This is not a named timer in \
+	 * the spec. \
+	 */ \
+	X(PE, SRC_TRANSITION, PD_TIMER_USE_SWAP) \
+	/* \
+	 * This timer is used by the new Source, after a Power Role Swap or \
+	 * Fast Role Swap, to ensure that it does not send Source_Capabilities \
+	 * Message before the new Sink is ready to receive the \
+	 * Source_Capabilities Message. \
+	 */ \
+	X(PE, SWAP_SOURCE_START, PD_TIMER_USE_DRP) \
+	/* Temporary available timeout timer */ \
+	X(PE, TIMEOUT, 1) \
+	/* \
+	 * The amount of timer that the DFP shall wait for the UFP to discharge \
+	 * VCONN (and send PS_RDY) during Data Reset. See PD 3.0, rev. 3.1, v. \
+	 * 1.2, section 6.6.10.1 VCONNDischargeTimer. \
+	 */ \
+	X(PE, VCONN_DISCHARGE, PD_TIMER_USE_DATA_RESET) \
+	/* \
+	 * This timer is used during a VCONN Swap. \
+	 */ \
+	X(PE, VCONN_ON, PD_TIMER_USE_VCONN) \
+	/* \
+	 * The amount of time that VCONN shall remain off during the cable reset \
+	 * portion of a Data Reset. See PD 3.0, rev. 3.1, v. 1.2, section 7.1.15 \
+	 * VCONN Power Cycle. \
+	 */ \
+	X(PE, VCONN_REAPPLIED, PD_TIMER_USE_DATA_RESET) \
+	/* \
+	 * This timer is used by the Initiator’s Policy Engine to ensure that \
+	 * a Structured VDM Command request needing a response (e.g. Discover \
+	 * Identity Command request) is responded to within a bounded time of \
+	 * tVDMSenderResponse. \
+	 */ \
+	X(PE, VDM_RESPONSE, PD_TIMER_USE_VDM) \
+	/* \
+	 * For PD2.0, this timer is used to wait 400ms and add some \
+	 * jitter of up to 100ms before sending a message. \
+	 * NOTE: This timer is not part of the TypeC/PD spec. \
+	 */ \
+	X(PE, WAIT_AND_ADD_JITTER, 1)
+
+#define PD_PR_TIMER_LIST(X) \
+	/* Chunk Sender Response timer */ \
+	X(PR, CHUNK_SENDER_RESPONSE, PD_TIMER_USE_CHUNKING) \
+	/* Chunk Sender Request timer */ \
+	X(PR, CHUNK_SENDER_REQUEST, PD_TIMER_USE_CHUNKING) \
+	/* Hard Reset Complete timer */ \
+	X(PR, HARD_RESET_COMPLETE, 1) \
+	/* Sink TX timer */ \
+	X(PR, SINK_TX, 1) \
+	/* timeout to limit waiting on TCPC response (not in spec) */ \
+	X(PR, TCPC_TX_TIMEOUT, 1)
+
+#define PD_TC_TIMER_LIST(X) \
+	/* Time a port shall wait before it can determine it is attached */ \
+	X(TC, CC_DEBOUNCE, 1) \
+	/* Time to debounce exit low power mode */ \
+	X(TC, LOW_POWER_EXIT_TIME, PD_TIMER_USE_LOW_POWER) \
+	/* Time to enter low power mode */ \
+	X(TC, LOW_POWER_TIME, PD_TIMER_USE_LOW_POWER) \
+	/* Role toggle timer */ \
+	X(TC, NEXT_ROLE_SWAP, PD_TIMER_USE_DRP) \
+	/* \
+	 * Time a Sink port shall wait before it can determine it is detached \
+	 * due to the potential for USB PD signaling on CC as described in \
+	 * the state definitions. \
+	 */ \
+	X(TC, PD_DEBOUNCE, 1) \
+	/* Generic timer */ \
+	X(TC, TIMEOUT, 1) \
+	/* \
+	 * Time a port shall wait before it can determine it is \
+	 * re-attached during the try-wait process. \
+	 */ \
+	X(TC, TRY_WAIT_DEBOUNCE, PD_TIMER_USE_DRP) \
+	/* \
+	 * Time to ignore Vbus absence due to external IC debounce detection \
+	 * logic immediately after a power role swap. \
+	 */ \
+	X(TC, VBUS_DEBOUNCE, PD_TIMER_USE_DRP)
+
+#define PD_TIMER_LIST(X) \
+	PD_DPM_TIMER_LIST(X) \
+	PD_PE_TIMER_LIST(X) \
+	PD_PR_TIMER_LIST(X) \
+	PD_TC_TIMER_LIST(X)
+
+#define PD_TIMER_ENUM_ENTRY(grp, name, en) \
+	PD_TIMER_IF(en, grp##_TIMER_##name,)
 
-	/*
-	 * Time to ignore Vbus absence due to external IC debounce detection
-	 * logic immediately after a power role swap.
-	 */
-	TC_TIMER_VBUS_DEBOUNCE,
+enum pd_task_timer {
+	PD_TIMER_LIST(PD_TIMER_ENUM_ENTRY)
 
 	PD_TIMER_COUNT
 };
@@ -243,17 +307,6 @@ enum pd_timer_range {
 	PR_TIMER_RANGE,
 	TC_TIMER_RANGE,
 };
-#define DPM_TIMER_START DPM_TIMER_PD_BUTTON_LONG_PRESS
-#define DPM_TIMER_END DPM_TIMER_PD_BUTTON_SHORT_PRESS
-
-#define PE_TIMER_START PE_TIMER_BIST_CONT_MODE
-#define PE_TIMER_END PE_TIMER_WAIT_AND_ADD_JITTER
-
-#define PR_TIMER_START PR_TIMER_CHUNK_SENDER_RESPONSE
-#define PR_TIMER_END PR_TIMER_TCPC_TX_TIMEOUT
-
-#define TC_TIMER_START TC_TIMER_CC_DEBOUNCE
-#define TC_TIMER_END TC_TIMER_VBUS_DEBOUNCE
 
 /*
  * pd_timer_init
@@ -321,5 +374,161 @@ bool pd_timer_is_expired(int port, enum pd_task_timer timer);
  */
 void pd_timer_manage_expired(int port);
 
+/*
+ * pd_timer_next_expiration
+ * Determine the amount of time until the next active timer expires. Used
+ * by the event loop to program the next wakeup.
+ *
+ * @param port USB-C port number
+ * @return Microseconds until the nearest active timer expires, 0 if an
+ *         active timer has already expired, or -1 if no timers are active.
+ *         Farther deadlines are capped at 0x7FFFFFFF, caller should just
+ *         check again after that time.
+ */
+int pd_timer_next_expiration(int port);
+
+/*
+ * pd_timer_snapshot_begin
+ * Freeze "now" for all timer operations of the port, until
+ * pd_timer_snapshot_end() is called. The event loop takes one snapshot per
+ * pass, so PE/PRL timer polling does not call get_time() every time.
+ * No-op unless CONFIG_PD_TIMER_TIME_SNAPSHOT is enabled.
+ *
+ * Timing semantics while snapshot is active:
+ *  - pd_timer_enable() counts from the start of the pass. A timer armed
+ *    late in the pass may expire up to one pass duration early.
+ *  - pd_timer_is_expired() may report expiration up to one pass duration
+ *    late. A timer that expires during the pass is seen on the next one.
+ *
+ * A loop pass takes tens of microseconds, while the tightest windows used
+ * by sink are in milliseconds (tHardResetComplete 4-5ms, tSinkTx 16-20ms,
+ * tSenderResponse 24-30ms). Note, PD_T_SENDER_RESPONSE for Rev3.0 is set
+ * to the window minimum, so it can fire a pass early. That is harmless,
+ * since the partner must answer within tReceiverResponse (15ms).
+ *
+ * @param port USB-C port number
+ */
+void pd_timer_snapshot_begin(int port);
+
+/*
+ * pd_timer_snapshot_end
+ * Return to reading real time on every timer operation.
+ *
+ * @param port USB-C port number
+ */
+void pd_timer_snapshot_end(int port);
+
+/*
+ * Timer statistics, available with CONFIG_PD_TIMER_STATS
+ */
+#define PD_TIMER_LATENESS_BUCKETS 16
+
+struct pd_timer_stats {
+	/* Number of pd_timer_enable() calls */
+	uint32_t enabled;
+	/* Number of expirations noticed */
+	uint32_t expired;
+	/* Number of active timers disabled before expiration */
+	uint32_t cancelled;
+	/*
+	 * log2 histogram of lateness (time between deadline and the moment
+	 * expiration was noticed). Bucket 0 is "on time", bucket N > 0 counts
+	 * [2^(N-1), 2^N) us. The last bucket also collects everything above.
+	 */
+	uint32_t lateness[PD_TIMER_LATENESS_BUCKETS];
+};
+
+/*
+ * pd_timer_stats_get
+ * Get statistics of a timer
+ *
+ * @param port USB-C port number
+ * @param timer Requested pd_task_timer
+ * @return Pointer to timer statistics
+ */
+const struct pd_timer_stats *pd_timer_stats_get(int port,
+						enum pd_task_timer timer);
+
+/*
+ * pd_timer_stats_max_active
+ * Get the maximum number of concurrently active timers
+ *
+ * @param port USB-C port number
+ * @return Maximum number of active timers since init or reset
+ */
+int pd_timer_stats_max_active(int port);
+
+/*
+ * pd_timer_stats_reset
+ * Clear all statistics of a port
+ *
+ * @param port USB-C port number
+ */
+void pd_timer_stats_reset(int port);
+
+/*
+ * pd_timer_stats_dump
+ * Print statistics of all timers that were used at least once
+ *
+ * @param port USB-C port number
+ * @param print printf-like output function
+ */
+void pd_timer_stats_dump(int port, int (*print)(const char *format, ...));
+
+/*
+ * Deadline-miss detector, available with CONFIG_PD_TIMER_DEADLINE_CHECK.
+ * A timer-driven action is counted as missed when it runs later than
+ * CONFIG_PD_TIMER_DEADLINE_PERCENT of the spec tolerance for that timer.
+ * Lateness is taken when pd_timer_is_expired() first reports expiration,
+ * so timers nobody polls are not counted.
+ */
+struct pd_timer_deadline {
+	/* Expirations checked against the budget */
+	uint32_t checked;
+	/* Expirations noticed later than the budget */
+	uint32_t missed;
+	/* Worst lateness seen, us */
+	uint32_t worst_late_us;
+	/* When the last missed action was due and when it actually ran, us */
+	uint64_t last_due;
+	uint64_t last_ran;
+};
+
+/*
+ * pd_timer_deadline_get
+ * Get deadline-miss counters of a timer
+ *
+ * @param port USB-C port number
+ * @param timer Requested pd_task_timer
+ * @return Pointer to deadline counters
+ */
+const struct pd_timer_deadline *pd_timer_deadline_get(int port,
+						      enum pd_task_timer timer);
+
+/*
+ * pd_timer_deadline_misses
+ * Get the total number of missed deadlines
+ *
+ * @param port USB-C port number
+ * @return Sum of missed deadlines of all timers
+ */
+uint32_t pd_timer_deadline_misses(int port);
+
+/*
+ * pd_timer_deadline_reset
+ * Clear deadline-miss counters of a port
+ *
+ * @param port USB-C port number
+ */
+void pd_timer_deadline_reset(int port);
+
+/*
+ * pd_timer_deadline_dump
+ * Print deadline-miss counters of all checked timers
+ *
+ * @param port USB-C port number
+ * @param print printf-like output function
+ */
+void pd_timer_deadline_dump(int port, int (*print)(const char *format, ...));
 
 #endif /* __CROS_EC_USB_PD_TIMER_H */
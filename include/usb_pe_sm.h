@@ -216,7 +216,8 @@ void pe_clear_port_data(int port);
 bool pe_snk_in_epr_mode(int port);
 
 /**
- * Make a sink exit EPR mode explicitly.
+ * Make a sink exit EPR mode explicitly, and not re-enter it automatically.
+ * Same as DPM_REQUEST_EPR_MODE_EXIT, safe to call from any context.
  *
  * @param port USB-C port number
  */
@@ -98,6 +98,15 @@ enum pd_rev_type prl_get_rev(int port, enum tcpci_msg_type type);
  */
 void prl_reset_msg_ids(int port, enum tcpci_msg_type type);
 
+/**
+ * Gives the received message slot back to the TCPM RX queue. Called by the
+ * Policy Engine once it is done with rx_emsg; the payload must not be
+ * accessed after that.
+ *
+ * @param port USB-C port number
+ */
+void prl_rx_release(int port);
+
 /**
  * Sends a PD control message
  *
@@ -150,4 +159,25 @@ void prl_execute_hard_reset(int port);
  */
 void prl_set_data_role_check(int port, bool enable);
 
+/**
+ * Selects unchunked extended messages for SOP, when both port partners
+ * support them (see CONFIG_USB_PD_EXTENDED_UNCHUNKED). Chunked messages are
+ * used by default and after Protocol Layer reset. Takes effect when the
+ * chunking state machines are idle.
+ *
+ * @param port USB-C port number
+ * @param enable True to use unchunked extended messages
+ */
+void prl_set_unchunked_ext(int port, bool enable);
+
+/**
+ * Number of received extended messages, which did not fit reassembly buffer
+ * (CONFIG_USB_PD_EXTENDED_BUFFER_SIZE), and were passed to PE with empty
+ * payload. Not reset on detach.
+ *
+ * @param port USB-C port number
+ * @return Message count
+ */
+uint32_t prl_get_ext_rx_too_long(int port);
+
 #endif /* __CROS_EC_USB_PRL_H */
@@ -9,6 +9,7 @@
 #define __CROS_EC_USB_SM_H
 
 #include "compiler.h" /* for typeof() on Zephyr */
+#include "pd_config.h"
 
 /* Function pointer that implements a portion of a usb state */
 typedef void (*state_execution)(const int port);
@@ -27,14 +28,21 @@ typedef void (*state_execution)(const int port);
  *
  *	Note: When transitioning between two child states with a shared parent,
  *	that parent's exit and entry functions do not execute.
+ * depth - Number of ancestors. Must be set to parent's depth + 1 for states
+ *	with parent, and left zero for top level states. Used to find shared
+ *	parent without nested loops. Limited by USB_SM_MAX_DEPTH.
  */
 struct usb_state {
 	const state_execution entry;
 	const state_execution run;
 	const state_execution exit;
 	const struct usb_state *parent;
+	const uint8_t depth;
 };
 
+/* Max nesting of states, i.e. max depth + 1 */
+#define USB_SM_MAX_DEPTH 4
+
 typedef const struct usb_state *usb_state_ptr;
 
 /* Defines the current context of the usb statemachine. */
@@ -90,6 +98,77 @@ void set_state(int port, struct sm_ctx *ctx, usb_state_ptr new_state);
  */
 void run_state(int port, struct sm_ctx *ctx);
 
+/**
+ * Check `depth` of all states in table, with assert(). Should be called at
+ * init for tables with parent states.
+ *
+ * @param table State table
+ * @param count Number of states in table
+ */
+void usb_sm_check_table(usb_state_ptr table, int count);
+
+/*
+ * State transition trace (CONFIG_USB_SM_TRACE). Every set_state() call of
+ * a registered state machine appends a compact binary record to per-port
+ * ring, instead of printing text. Read records with usb_sm_trace_read()
+ * and decode state indexes on host with support/sm_trace_decode.py.
+ */
+enum usb_sm_id {
+	USB_SM_DPM,
+	USB_SM_PE,
+	USB_SM_PRL_TX,
+	USB_SM_PRL_HR,
+	USB_SM_RCH,
+	USB_SM_TCH,
+	USB_SM_COUNT
+};
+
+/* State index used for NULL state (all states exited) */
+#define USB_SM_TRACE_NO_STATE 0xFF
+
+struct usb_sm_trace_rec {
+	/* Low word of get_time(), us */
+	uint32_t ts;
+	uint8_t port;
+	/* enum usb_sm_id */
+	uint8_t sm;
+	/* Indexes in state machine's state table */
+	uint8_t from;
+	uint8_t to;
+};
+
+#ifdef CONFIG_USB_SM_TRACE
+/**
+ * Register state machine context and its state table, so transitions of
+ * that state machine are traced. The ID is kept in the context, so it must
+ * be called again after the context is cleared.
+ *
+ * @param ctx   State machine context
+ * @param id    State machine ID
+ * @param table Base of state table
+ * @param count Number of states in table
+ */
+void usb_sm_trace_register(struct sm_ctx *ctx, enum usb_sm_id id,
+			   usb_state_ptr table, int count);
+#else
+static inline void usb_sm_trace_register(struct sm_ctx *ctx,
+					 enum usb_sm_id id,
+					 usb_state_ptr table, int count)
+{
+}
+#endif /* CONFIG_USB_SM_TRACE */
+
+/**
+ * Copy traced transitions of a port, oldest first. Can be called from
+ * any context; records overwritten while copying are dropped.
+ *
+ * @param port USB-C port number
+ * @param buf  Destination buffer
+ * @param max  Size of destination buffer, in records
+ * @return Number of records copied
+ */
+int usb_sm_trace_read(int port, struct usb_sm_trace_rec *buf, int max);
+
 #ifdef TEST_BUILD
 /*
  * Struct for test builds that allow unit tests to easily iterate through
@@ -29,6 +29,25 @@ static struct fusb302_chip_state {
 	uint8_t mdac_rd;
 } state[CONFIG_USB_PD_PORT_MAX_COUNT];
 
+/*
+ * This is the buffer that will be burst-written into the fusb302.
+ * Layout keeps the payload 32-bit aligned at FUSB302_TX_PAYLOAD_POS, so
+ * the protocol layer can build messages in place (see get_tx_buf).
+ * maximum size necessary =
+ * 1: FIFO register address
+ * 4: SOP* tokens
+ * 1: Token that signifies "next X bytes are not tokens"
+ * 30: 2 for header and up to 7*4 = 28 for rest of message
+ * 1: "Insert CRC" Token
+ * 1: EOP Token
+ * 1: "Turn transmitter off" token
+ * 1: "Star Transmission" Command
+ * -
+ * 40: 40 bytes worst-case
+ */
+#define FUSB302_TX_PAYLOAD_POS 8
+static uint32_t tx_fifo[CONFIG_USB_PD_PORT_MAX_COUNT][40 / 4];
+
 static K_MUTEX_DEFINE(measure_lock);
 
 /*
@@ -232,8 +251,9 @@ static int fusb302_send_message(int port, uint16_t header, const uint32_t *data,
 	/* header is done, subtract from length to make this for-loop simpler */
 	len -= 2;
 
-	/* write data objects, if present */
-	memcpy(&buf[buf_pos], data, len);
+	/* write data objects, if present and not built in place */
+	if (data != &tx_fifo[port][FUSB302_TX_PAYLOAD_POS / 4])
+		memcpy(&buf[buf_pos], data, len);
 	buf_pos += len;
 
 	/* put in the CRC */
@@ -541,14 +561,11 @@ static int fusb302_rx_fifo_is_empty(int port)
 static int fusb302_tcpm_get_message_raw(int port, uint32_t *payload, int *head)
 {
 	/*
-	 * This is the buffer that will get the burst-read data
-	 * from the fusb302.
-	 *
-	 * It's re-used in a couple different spots, the worst of which
-	 * is the PD packet (not header) and CRC.
-	 * maximum size necessary = 28 + 4 = 32
+	 * Scratch buffer for the register address, SOP token + header and
+	 * CRC. The PD packet itself is burst-read directly into the caller's
+	 * payload (RX slot), so no intermediate copy is needed.
 	 */
-	uint8_t buf[32];
+	uint8_t buf[4];
 	int rv, len;
 
 	/* Read until we have a non-GoodCRC packet or an empty FIFO */
@@ -579,47 +596,41 @@ static int fusb302_tcpm_get_message_raw(int port, uint32_t *payload, int *head)
 		len = get_num_bytes(*head) - 2;
 
 		/*
-		 * PART 3 OF BURST READ: Read everything else.
+		 * PART 3 OF BURST READ: Read the packet into payload.
+		 * No START, no STOP. GoodCRC has no data objects, so
+		 * the payload is never touched for those.
+		 */
+		if (len > 0)
+			rv |= tcpc_xfer_unlocked(port, 0, 0, (uint8_t *)payload,
+						 len, 0);
+
+		/*
+		 * PART 4 OF BURST READ: Read out and drop the CRC.
 		 * No START, but do issue a STOP at the end.
-		 * add 4 to len to read CRC out
 		 */
-		rv |= tcpc_xfer_unlocked(port, 0, 0, buf, len + 4,
-					 I2C_XFER_STOP);
+		rv |= tcpc_xfer_unlocked(port, 0, 0, buf, 4, I2C_XFER_STOP);
 
 		tcpc_lock(port, 0);
 	} while (!rv && PACKET_IS_GOOD_CRC(*head) &&
 		 !fusb302_rx_fifo_is_empty(port));
 
-	if (!rv) {
-		/* Discard GoodCRC packets */
-		if (PACKET_IS_GOOD_CRC(*head))
-			rv = EC_ERROR_UNKNOWN;
-		else
-			memcpy(payload, buf, len);
-	}
+	/* Discard GoodCRC packets */
+	if (!rv && PACKET_IS_GOOD_CRC(*head))
+		rv = EC_ERROR_UNKNOWN;
 
 
 	return rv;
 }
 
+static uint32_t *fusb302_tcpm_get_tx_buf(int port)
+{
+	return &tx_fifo[port][FUSB302_TX_PAYLOAD_POS / 4];
+}
+
 static int fusb302_tcpm_transmit(int port, enum tcpci_msg_type type,
 				 uint16_t header, const uint32_t *data)
 {
-	/*
-	 * this is the buffer that will be burst-written into the fusb302
-	 * maximum size necessary =
-	 * 1: FIFO register address
-	 * 4: SOP* tokens
-	 * 1: Token that signifies "next X bytes are not tokens"
-	 * 30: 2 for header and up to 7*4 = 28 for rest of message
-	 * 1: "Insert CRC" Token
-	 * 1: EOP Token
-	 * 1: "Turn transmitter off" token
-	 * 1: "Star Transmission" Command
-	 * -
-	 * 40: 40 bytes worst-case
-	 */
-	uint8_t buf[40];
+	uint8_t *buf = (uint8_t *)tx_fifo[port];
 	int buf_pos = 0;
 
 	int reg;
@@ -782,5 +793,6 @@ const struct tcpm_drv fusb302_tcpm_drv = {
 	.set_rx_enable = &fusb302_tcpm_set_rx_enable,
 	.get_message_raw = &fusb302_tcpm_get_message_raw,
 	.transmit = &fusb302_tcpm_transmit,
+	.get_tx_buf = &fusb302_tcpm_get_tx_buf,
 	.tcpc_alert = &fusb302_tcpc_alert,
 };
@@ -1,4 +1,13 @@
+#ifndef __PD_CONFIG_H
+#define __PD_CONFIG_H
+
 #define CONFIG_USB_PD_PORT_MAX_COUNT 1
 
 #include "./portage/pd_portage_defines.h"
+/* Build specific changes on top of defaults, e.g. host tests */
+#ifdef PD_CONFIG_OVERRIDE
+#include PD_CONFIG_OVERRIDE
+#endif
 #include "./portage/external.h"
+
+#endif /* __PD_CONFIG_H */
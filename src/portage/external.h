@@ -7,6 +7,12 @@
 #define test_mockable_static static
 #define __const_data
 //#define __const_data __attribute__((__section__(".rodata")))
+/*
+ * Large, rarely used per-port data of PE / PRL (caps, VDM, ext. buffers).
+ * Has no effect with CONFIG_PD_PORT_ARENA, data is in the arena then.
+ */
+#define __pd_cold_data
+//#define __pd_cold_data __attribute__((__section__(".pd_cold")))
 
 #define ATOMIC_BOOLS_DEFINE(VAR, SIZE) atomic_bool VAR[SIZE]
 
@@ -21,4 +27,28 @@ typedef union {
 
 extern timestamp_t get_time(void);
 
+/*
+ * Free running 32-bit counter, incremented every CONFIG_PD_TIMER_TICK_US.
+ * Used by PD timers instead of `get_time()` with CONFIG_PD_TIMER_TICKS.
+ * Wraparound is allowed.
+ */
+extern uint32_t get_ticks(void);
+
+/*
+ * One-shot wakeup timer, used by tickless event loop only
+ * (CONFIG_PD_LOOP_TICKLESS). Platform should call
+ * `pd_loop_handle_timer_interrupt()` once, after `delay_us` passed.
+ * Every call replaces the previous request. Negative `delay_us` means
+ * there are no pending timers and wakeup can be cancelled.
+ */
+extern void pd_loop_timer_arm(int32_t delay_us);
+
+/*
+ * Known-charger cache changed (CONFIG_PD_SNK_CACHE_PERSIST). Platform
+ * should store `len` bytes to non-volatile memory, and pass them to
+ * `pd_snk_cache_restore()` on next boot. Called from event loop, so slow
+ * flash writes should be deferred.
+ */
+extern void pd_snk_cache_save(const void *data, int len);
+
 #endif /* __PD_PORT_EXTERNAL_H */
\ No newline at end of file
@@ -689,14 +689,11 @@ static int fusb302_rx_fifo_is_empty(int port)
 static int fusb302_tcpm_get_message_raw(int port, uint32_t *payload, int *head)
 {
 	/*
-	 * This is the buffer that will get the burst-read data
-	 * from the fusb302.
-	 *
-	 * It's re-used in a couple different spots, the worst of which
-	 * is the PD packet (not header) and CRC.
-	 * maximum size necessary = 28 + 4 = 32
+	 * Scratch buffer for the register address, SOP token + header and
+	 * CRC. The PD packet itself is burst-read directly into the caller's
+	 * payload (RX slot), so no intermediate copy is needed.
 	 */
-	uint8_t buf[32];
+	uint8_t buf[4];
 	int rv, len;
 
 	/* Read until we have a non-GoodCRC packet or an empty FIFO */
@@ -727,24 +724,27 @@ static int fusb302_tcpm_get_message_raw(int port, uint32_t *payload, int *head)
 		len = get_num_bytes(*head) - 2;
 
 		/*
-		 * PART 3 OF BURST READ: Read everything else.
+		 * PART 3 OF BURST READ: Read the packet into payload.
+		 * No START, no STOP. GoodCRC has no data objects, so
+		 * the payload is never touched for those.
+		 */
+		if (len > 0)
+			rv |= tcpc_xfer_unlocked(port, 0, 0, (uint8_t *)payload,
+						 len, 0);
+
+		/*
+		 * PART 4 OF BURST READ: Read out and drop the CRC.
 		 * No START, but do issue a STOP at the end.
-		 * add 4 to len to read CRC out
 		 */
-		rv |= tcpc_xfer_unlocked(port, 0, 0, buf, len + 4,
-					 I2C_XFER_STOP);
+		rv |= tcpc_xfer_unlocked(port, 0, 0, buf, 4, I2C_XFER_STOP);
 
 		tcpc_lock(port, 0);
 	} while (!rv && PACKET_IS_GOOD_CRC(*head) &&
 		 !fusb302_rx_fifo_is_empty(port));
 
-	if (!rv) {
-		/* Discard GoodCRC packets */
-		if (PACKET_IS_GOOD_CRC(*head))
-			rv = EC_ERROR_UNKNOWN;
-		else
-			memcpy(payload, buf, len);
-	}
+	/* Discard GoodCRC packets */
+	if (!rv && PACKET_IS_GOOD_CRC(*head))
+		rv = EC_ERROR_UNKNOWN;
 
 
 	return rv;
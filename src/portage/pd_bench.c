@@ -0,0 +1,88 @@
+/*
+ * Negotiation cost counters, see include/pd_bench.h.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "src/pd_config.h"
+#include "pd_bench.h"
+#include "pd_port_arena.h"
+#include "pd_snk_policy.h"
+#include "usb_pd.h"
+#include "util.h"
+
+#ifdef CONFIG_PD_BENCH
+
+#define MAX_PD_PORTS CONFIG_USB_PD_PORT_MAX_COUNT
+
+struct pd_bench_counters PD_PORT_DATA(pd_bench_cnt);
+
+static struct {
+	/* Low word of get_time() at PE_SNK_Startup */
+	uint32_t start;
+	uint8_t cnt;
+	struct pd_bench_rec rec[PD_BENCH_MAX_CONTRACTS];
+} PD_PORT_DATA(bench);
+
+#ifdef CONFIG_PD_PORT_ARENA
+void pd_bench_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(pd_bench_cnt, count);
+	PD_PORT_DATA_TAKE(bench, count);
+}
+#endif
+
+void pd_bench_start(int port)
+{
+	/* Startup transition itself is already counted, keep it */
+	pd_bench_cnt[port] = (struct pd_bench_counters){ .transitions = 1 };
+	bench[port].start = get_time().le.lo;
+	bench[port].cnt = 0;
+}
+
+void pd_bench_contract(int port, int rev, bool epr)
+{
+	const uint32_t pdo = pd_snk_get_selection(port)->pdo;
+	struct pd_bench_rec *rec;
+
+	if (bench[port].cnt >= PD_BENCH_MAX_CONTRACTS)
+		return;
+
+	rec = &bench[port].rec[bench[port].cnt++];
+	rec->time_us = get_time().le.lo - bench[port].start;
+	rec->cnt = pd_bench_cnt[port];
+	rec->rev = rev;
+	rec->flags = 0;
+	if ((pdo & PDO_TYPE_MASK) == PDO_TYPE_AUGMENTED)
+		rec->flags |= PD_BENCH_F_PPS;
+	if (epr)
+		rec->flags |= PD_BENCH_F_EPR;
+}
+
+int pd_bench_read(int port, struct pd_bench_rec *buf, int max)
+{
+	const int cnt = MIN(bench[port].cnt, max);
+
+	memcpy(buf, bench[port].rec, cnt * sizeof(*buf));
+
+	return cnt;
+}
+
+void pd_bench_dump(int port, int (*print)(const char *format, ...))
+{
+	for (int i = 0; i < bench[port].cnt; i++) {
+		const struct pd_bench_rec *rec = &bench[port].rec[i];
+
+		print("C%d: contract %d: %luus rev%d%s%s loops %lu timer %lu "
+		      "sm %lu\n",
+		      port, i, (unsigned long)rec->time_us, rec->rev + 1,
+		      rec->flags & PD_BENCH_F_PPS ? " PPS" : "",
+		      rec->flags & PD_BENCH_F_EPR ? " EPR" : "",
+		      (unsigned long)rec->cnt.loops,
+		      (unsigned long)rec->cnt.timer_checks,
+		      (unsigned long)rec->cnt.transitions);
+	}
+}
+
+#endif /* CONFIG_PD_BENCH */
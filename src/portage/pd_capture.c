@@ -0,0 +1,270 @@
+/*
+ * Wire-level PD packet capture, see include/pd_capture.h.
+ *
+ * Records are written by the port's event loop only (PRL), so each ring has
+ * a single writer. The only exception is TX status, a single byte updated
+ * in place from TCPC alert context.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "src/pd_config.h"
+#include "pd_capture.h"
+#include "pd_port_arena.h"
+#include "usb_pd.h"
+#include "usb_pd_tcpm.h"
+#include "util.h"
+
+#ifdef CONFIG_PD_CAPTURE
+
+#define MAX_PD_PORTS CONFIG_USB_PD_PORT_MAX_COUNT
+
+#ifndef CONFIG_PD_CAPTURE_DEPTH
+#define CONFIG_PD_CAPTURE_DEPTH 16
+#endif
+
+#define CAPTURE_DEPTH CONFIG_PD_CAPTURE_DEPTH
+
+static struct pd_capture_rec PD_PORT_DATA(ring)[CAPTURE_DEPTH];
+/* Counts all records ever written, reader uses it to detect overwrites */
+static atomic_uint PD_PORT_DATA(head);
+/* Sequence number + 1 of the last TX record, 0 if none */
+static atomic_uint PD_PORT_DATA(last_tx);
+
+#ifdef CONFIG_PD_PORT_ARENA
+void pd_capture_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(ring, count);
+	PD_PORT_DATA_TAKE(head, count);
+	PD_PORT_DATA_TAKE(last_tx, count);
+}
+#endif
+
+/*
+ * Extend low word of get_time() to full time. `lo` must be in the past, less
+ * than 2^32 us ago.
+ */
+static uint64_t extend_ts(uint32_t lo)
+{
+	const timestamp_t now = get_time();
+
+	return now.val - (uint32_t)(now.le.lo - lo);
+}
+
+static void capture(int port, uint64_t ts, uint8_t sop, uint8_t flags,
+		    uint32_t header, const uint32_t *payload)
+{
+	const unsigned int seq =
+		atomic_load_explicit(&head[port], memory_order_relaxed);
+	struct pd_capture_rec *rec = &ring[port][seq % CAPTURE_DEPTH];
+	int cnt = sop < NUM_SOP_STAR_TYPES ? PD_HEADER_CNT(header) : 0;
+
+	rec->ts = ts;
+	rec->header = sop < NUM_SOP_STAR_TYPES ? header & 0xFFFF : 0;
+	rec->sop = sop;
+	rec->flags = flags;
+	memcpy(rec->payload, payload, MIN(cnt, 7) * sizeof(uint32_t));
+
+	if (flags & PD_CAPTURE_F_TX)
+		atomic_store_explicit(&last_tx[port], seq + 1,
+				      memory_order_relaxed);
+
+	atomic_store_explicit(&head[port], seq + 1, memory_order_release);
+}
+
+void pd_capture_rx(int port, uint32_t ts, uint32_t header,
+		   const uint32_t *payload)
+{
+	capture(port, extend_ts(ts), PD_HEADER_GET_SOP(header), 0, header,
+		payload);
+}
+
+void pd_capture_tx(int port, int type, uint32_t header,
+		   const uint32_t *payload)
+{
+	capture(port, get_time().val, type, PD_CAPTURE_F_TX, header, payload);
+}
+
+void pd_capture_tx_status(int port, int status)
+{
+	const unsigned int tx =
+		atomic_load_explicit(&last_tx[port], memory_order_relaxed);
+	const unsigned int seq =
+		atomic_load_explicit(&head[port], memory_order_acquire);
+	struct pd_capture_rec *rec;
+	uint8_t st;
+
+	/* No TX recorded, or its slot was reused already */
+	if (tx == 0 || seq - (tx - 1) >= CAPTURE_DEPTH)
+		return;
+
+	switch (status) {
+	case TCPC_TX_COMPLETE_SUCCESS:
+		st = PD_CAPTURE_TX_SUCCESS;
+		break;
+	case TCPC_TX_COMPLETE_DISCARDED:
+		st = PD_CAPTURE_TX_DISCARDED;
+		break;
+	case TCPC_TX_COMPLETE_FAILED:
+		st = PD_CAPTURE_TX_FAILED;
+		break;
+	default:
+		return;
+	}
+
+	rec = &ring[port][(tx - 1) % CAPTURE_DEPTH];
+	rec->flags = (rec->flags & ~PD_CAPTURE_F_STATUS_MASK) |
+		     (st << PD_CAPTURE_F_STATUS_SHIFT);
+}
+
+/*
+ * Copy record `seq`. Returns false if writer has reused the slot, so the
+ * copy may be torn.
+ */
+static bool read_rec(int port, unsigned int seq, struct pd_capture_rec *rec)
+{
+	*rec = ring[port][seq % CAPTURE_DEPTH];
+
+	/* Plain copy must not be reordered after the head reload */
+	atomic_thread_fence(memory_order_acquire);
+
+	return atomic_load_explicit(&head[port], memory_order_relaxed) - seq <
+	       CAPTURE_DEPTH;
+}
+
+/* Copy next readable record before `end`, advancing `seq` */
+static bool read_next(int port, unsigned int *seq, unsigned int end,
+		      struct pd_capture_rec *rec)
+{
+	while (*seq != end) {
+		if (read_rec(port, (*seq)++, rec))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Sequence number of the oldest readable record. Slot of record
+ * `end - DEPTH` is the next one to be written, so it is skipped.
+ */
+static unsigned int first_seq(unsigned int end)
+{
+	return end - MIN(end, CAPTURE_DEPTH - 1);
+}
+
+int pd_capture_read(int port, struct pd_capture_rec *buf, int max)
+{
+	const unsigned int end =
+		atomic_load_explicit(&head[port], memory_order_acquire);
+	unsigned int seq = first_seq(end);
+	int count = 0;
+
+	if (end - seq > (unsigned int)max)
+		seq = end - max;
+
+	for (; seq != end; seq++) {
+		if (read_rec(port, seq, &buf[count]))
+			count++;
+	}
+
+	return count;
+}
+
+/* pcap record header + pseudo header + PD message */
+#define PCAP_REC_MAX (16 + PD_CAPTURE_PSEUDO_HDR_LEN + 2 + 7 * 4)
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	put_le16(p, v);
+	put_le16(p + 2, v >> 16);
+}
+
+static int write_pcap_rec(pd_capture_write_fn write, void *ctx, int port,
+			  const struct pd_capture_rec *rec)
+{
+	uint8_t pkt[PCAP_REC_MAX];
+	uint8_t *p = pkt + 16;
+	int len;
+
+	*p++ = rec->sop;
+	*p++ = rec->flags;
+	*p++ = port;
+	*p++ = 0;
+
+	if (rec->sop < NUM_SOP_STAR_TYPES) {
+		const int cnt = MIN(PD_HEADER_CNT(rec->header), 7);
+
+		put_le16(p, rec->header);
+		p += 2;
+		for (int i = 0; i < cnt; i++, p += 4)
+			put_le32(p, rec->payload[i]);
+	}
+
+	len = p - (pkt + 16);
+	put_le32(pkt, rec->ts / 1000000);
+	put_le32(pkt + 4, rec->ts % 1000000);
+	put_le32(pkt + 8, len);
+	put_le32(pkt + 12, len);
+
+	return write(ctx, pkt, 16 + len);
+}
+
+int pd_capture_write_pcap(pd_capture_write_fn write, void *ctx)
+{
+	/* pcap file header, see pcap-savefile(5) */
+	uint8_t hdr[24];
+	/* Read position of each port, and its next record to merge */
+	unsigned int seq[MAX_PD_PORTS], end[MAX_PD_PORTS];
+	struct pd_capture_rec next[MAX_PD_PORTS];
+	bool have[MAX_PD_PORTS];
+	int rv;
+
+	put_le32(hdr, 0xA1B2C3D4); /* magic, microsecond timestamps */
+	put_le16(hdr + 4, 2); /* version */
+	put_le16(hdr + 6, 4);
+	put_le32(hdr + 8, 0); /* thiszone */
+	put_le32(hdr + 12, 0); /* sigfigs */
+	put_le32(hdr + 16, PCAP_REC_MAX - 16); /* snaplen */
+	put_le32(hdr + 20, PD_CAPTURE_LINKTYPE);
+
+	rv = write(ctx, hdr, sizeof(hdr));
+	if (rv)
+		return rv;
+
+	for (int port = 0; port < pd_port_count; port++) {
+		end[port] = atomic_load_explicit(&head[port],
+						 memory_order_acquire);
+		seq[port] = first_seq(end[port]);
+		have[port] = read_next(port, &seq[port], end[port], &next[port]);
+	}
+
+	/* Merge rings by timestamp, tools expect non-decreasing time */
+	for (;;) {
+		int port = -1;
+
+		for (int i = 0; i < pd_port_count; i++) {
+			if (have[i] && (port < 0 || next[i].ts < next[port].ts))
+				port = i;
+		}
+		if (port < 0)
+			break;
+
+		rv = write_pcap_rec(write, ctx, port, &next[port]);
+		if (rv)
+			return rv;
+
+		have[port] = read_next(port, &seq[port], end[port], &next[port]);
+	}
+
+	return 0;
+}
+
+#endif /* CONFIG_PD_CAPTURE */
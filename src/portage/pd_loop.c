@@ -4,9 +4,43 @@
 
 #include "src/pd_config.h"
 #include "src/portage/pd_loop.h"
+#include "pd_bench.h"
+#include "pd_port_arena.h"
+#include "pd_snk_policy.h"
+#include "usb_pd_timer.h"
 
 #define MAX_PD_PORTS CONFIG_USB_PD_PORT_MAX_COUNT
 
+#ifdef CONFIG_PD_PORT_ARENA
+// Same as below, initialized by pd_loop_port_arena_init()
+static atomic_flag PD_PORT_DATA(is_running);
+static atomic_flag PD_PORT_DATA(deferred_call);
+static atomic_uint_fast32_t PD_PORT_DATA(events);
+#ifdef CONFIG_PD_LOOP_TICKLESS
+static uint64_t PD_PORT_DATA(wakeup_at);
+#endif
+
+void pd_loop_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(is_running, count);
+	PD_PORT_DATA_TAKE(deferred_call, count);
+	PD_PORT_DATA_TAKE(events, count);
+#ifdef CONFIG_PD_LOOP_TICKLESS
+	PD_PORT_DATA_TAKE(wakeup_at, count);
+#endif
+
+	/* Size counting pass */
+	if (!pd_port_arena_carving()) return;
+
+	for (int i = 0; i < count; i++) {
+		atomic_flag_clear(&is_running[i]);
+		atomic_flag_clear(&deferred_call[i]);
+#ifdef CONFIG_PD_LOOP_TICKLESS
+		wakeup_at[i] = UINT64_MAX;
+#endif
+	}
+}
+#else
 // Declare arrays of atomic flags for each port
 static atomic_flag is_running[MAX_PD_PORTS] = {[0 ... MAX_PD_PORTS - 1] = ATOMIC_FLAG_INIT};
 static atomic_flag deferred_call[MAX_PD_PORTS] = {[0 ... MAX_PD_PORTS - 1] = ATOMIC_FLAG_INIT};
@@ -14,18 +48,78 @@ static atomic_flag deferred_call[MAX_PD_PORTS] = {[0 ... MAX_PD_PORTS - 1] = ATO
 // Events storage
 static atomic_uint_fast32_t events[MAX_PD_PORTS] = {[0 ... MAX_PD_PORTS - 1] = 0};
 
+#ifdef CONFIG_PD_LOOP_TICKLESS
+// Absolute time of nearest timer deadline, UINT64_MAX if nothing pending
+static uint64_t wakeup_at[MAX_PD_PORTS] = {[0 ... MAX_PD_PORTS - 1] = UINT64_MAX};
+#endif
+#endif /* CONFIG_PD_PORT_ARENA */
+
+#ifdef CONFIG_PD_LOOP_TICKLESS
+/*
+ * Bumped after each wakeup_at[] update. Loops of different ports may run in
+ * different contexts and preempt each other, while 64-bit deadlines are not
+ * read atomically on 32-bit cores. So the scan is repeated until no other
+ * port has updated its deadline meanwhile. The last port to update also arms
+ * the timer last, so the final request always comes from a complete scan.
+ */
+static atomic_uint wakeup_gen;
+
+/*
+ * Program one-shot platform timer to nearest deadline of all ports. Timer
+ * interrupt is shared, so each port's deadline is remembered and the
+ * minimum is taken.
+ *
+ * Returns true if this port has already expired timers and should run
+ * again immediately.
+ */
+static bool schedule_wakeup(int port)
+{
+	uint64_t now = get_time().val;
+	const int next = pd_timer_next_expiration(port);
+	unsigned int gen;
+
+	if (next == 0) return true;
+
+	wakeup_at[port] = next < 0 ? UINT64_MAX : now + next;
+	atomic_fetch_add(&wakeup_gen, 1);
+
+	do {
+		uint64_t nearest = UINT64_MAX;
+
+		gen = atomic_load(&wakeup_gen);
+		/* Could be preempted for a while, delay is from actual time */
+		now = get_time().val;
+
+		for (int i = 0; i < pd_port_count; i++) {
+			if (wakeup_at[i] < nearest) nearest = wakeup_at[i];
+		}
+
+		if (nearest == UINT64_MAX) pd_loop_timer_arm(-1);
+		else pd_loop_timer_arm(nearest > now ? (int32_t)(nearest - now) : 0);
+	} while (gen != atomic_load(&wakeup_gen));
+
+	return false;
+}
+#endif
+
 static void loop(int port)
 {
 	/* pick available events */
 	const uint32_t evt = atomic_exchange(&events[port], 0);
 
+	pd_bench_loop(port);
+
+	/* Single time reading for the whole pass, if enabled */
+	pd_timer_snapshot_begin(port);
+
 	if (evt & TASK_EVENT_TIMER) pd_timer_manage_expired(port);
 
+	pd_snk_pps_run(port);
 	dpm_run(port, evt, tc_get_pd_enabled(port));
 	pe_run(port, evt, tc_get_pd_enabled(port));
 	prl_run(port, evt, tc_get_pd_enabled(port));
 
-	return true;
+	pd_timer_snapshot_end(port);
 }
 
 /*
@@ -38,6 +132,11 @@ static void loop(int port)
  *
  * NOTE: there is chance to call this every 0.1ms, to support good timeouts
  * resolution.
+ *
+ * With CONFIG_PD_LOOP_TICKLESS periodic calls are not needed. After each
+ * pass the nearest timer deadline is passed to `pd_loop_timer_arm()`, and
+ * platform fires `pd_loop_handle_timer_interrupt()` only when something
+ * is really due. Drivers must still use immediate signaling.
  */
 static void pd_loop(int port) {
 	/* Wrapper to flatten nested invocations. Real logic is in `loop()` */
@@ -51,14 +150,20 @@ static void pd_loop(int port) {
 
         loop(port);
 
+#ifdef CONFIG_PD_LOOP_TICKLESS
+        if (schedule_wakeup(port)) {
+            // Some timers expired while running, process those now.
+            atomic_fetch_or(&events[port], TASK_EVENT_TIMER);
+            atomic_flag_test_and_set(&deferred_call[port]);
+        }
+#endif
+
         atomic_flag_clear(&is_running[port]);
 
-        if (atomic_flag_test_and_set(&deferred_call[port])) {
-            atomic_flag_clear(&deferred_call[port]);
-            should_run = true;
-        } else {
-            should_run = false;
-        }
+        // No test-and-clear for atomic_flag, so clear it back in both cases.
+        // Leaving it set would force extra pass on the next call.
+        should_run = atomic_flag_test_and_set(&deferred_call[port]);
+        atomic_flag_clear(&deferred_call[port]);
 
     } while (should_run);
 }
@@ -75,7 +180,7 @@ void pd_loop_set_event(int port, uint32_t event) {
  * Timer interrupt handler. Propagate timer event to all ports.
  */
 void pd_loop_handle_timer_interrupt() {
-	for (int port = 0; port < MAX_PD_PORTS; port++) {
+	for (int port = 0; port < pd_port_count; port++) {
 		pd_loop_set_event(port, TASK_EVENT_TIMER);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+/*
+ * Per-port state storage, see include/pd_port_arena.h.
+ *
+ * Size counting and carving walk the same module hooks, so the layout is
+ * always the same. Each array is aligned to max_align_t.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "src/pd_config.h"
+#include "pd_port_arena.h"
+
+#ifdef CONFIG_PD_PORT_ARENA
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+int pd_port_count;
+
+/* Arena being carved, NULL while size is counted */
+static uint8_t *arena_base;
+static size_t arena_used;
+
+void *pd_port_arena_take(size_t size)
+{
+	void *p = NULL;
+
+	arena_used = (arena_used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if (arena_base)
+		p = arena_base + arena_used;
+	arena_used += size;
+
+	return p;
+}
+
+bool pd_port_arena_carving(void)
+{
+	return arena_base != NULL;
+}
+
+static size_t carve(uint8_t *base, int count)
+{
+	arena_base = base;
+	arena_used = 0;
+
+	pd_loop_port_arena_init(count);
+	pd_timer_port_arena_init(count);
+	tcpm_rx_queue_port_arena_init(count);
+	prl_port_arena_init(count);
+	pe_port_arena_init(count);
+	dpm_port_arena_init(count);
+	pd_snk_port_arena_init(count);
+#ifdef CONFIG_USB_SM_TRACE
+	usb_sm_port_arena_init(count);
+#endif
+#ifdef CONFIG_PD_CAPTURE
+	pd_capture_port_arena_init(count);
+#endif
+#ifdef CONFIG_PD_BENCH
+	pd_bench_port_arena_init(count);
+#endif
+
+	arena_base = NULL;
+
+	return arena_used;
+}
+
+size_t pd_port_arena_size(int count)
+{
+	return carve(NULL, count);
+}
+
+bool pd_port_arena_init(void *arena, size_t size, int count)
+{
+	size_t need;
+
+	if (count < 1 || count > CONFIG_USB_PD_PORT_MAX_COUNT)
+		return false;
+
+	if ((uintptr_t)arena & (ARENA_ALIGN - 1))
+		return false;
+
+	need = pd_port_arena_size(count);
+	if (size < need)
+		return false;
+
+	memset(arena, 0, need);
+	carve(arena, count);
+	pd_port_count = count;
+
+	return true;
+}
+
+#endif /* CONFIG_PD_PORT_ARENA */
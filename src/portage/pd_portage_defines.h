@@ -12,9 +12,15 @@
 #define CONFIG_USB_POWER_DELIVERY
 #define CONFIG_USB_PD_TCPMV2
 
-// This should be still ok for ERP, because required messages
-// are transferred in single chunk. But should be checked for sure.
-#undef CONFIG_USB_PD_EXTENDED_MESSAGES
+// Extended messages, with chunking. Reassembled messages are limited to
+// CONFIG_USB_PD_EXTENDED_BUFFER_SIZE bytes per port, longer ones are passed
+// to PE with empty payload (and rejected as Not_Supported).
+#define CONFIG_USB_PD_EXTENDED_MESSAGES
+// Should fit EPR_Source_Capabilities (up to 11 PDOs, 44 bytes)
+#define CONFIG_USB_PD_EXTENDED_BUFFER_SIZE 52
+// Negotiate unchunked extended messages, if source supports those. Only
+// messages fitting single packet are accepted (TCPC RX slot is 28 bytes).
+#undef CONFIG_USB_PD_EXTENDED_UNCHUNKED
 // Not needed for Sink mode
 #undef CONFIG_USB_PD_FRS
 #undef CONFIG_USBC_VCONN
@@ -54,5 +60,78 @@
 #undef CONFIG_COMMON_RUNTIME
 #undef CONFIG_USB_PD_HOST_CMD
 
+// Binary state transition trace in `usb_sm.c`, see `usb_sm_trace_read()`
+#undef CONFIG_USB_SM_TRACE
+//#define CONFIG_USB_SM_TRACE_DEPTH 64
+
 // `usb_pd_timer` debug code
 #undef CONFIG_CMD_PD_TIMER
+// Collect timer statistics, see `pd_timer_stats_dump()`
+#undef CONFIG_PD_TIMER_STATS
+// Count timer-driven actions that run later than a percentage of the spec
+// tolerance, see `pd_timer_deadline_dump()`
+#undef CONFIG_PD_TIMER_DEADLINE_CHECK
+//#define CONFIG_PD_TIMER_DEADLINE_PERCENT 50
+
+// Wire-level PD packet capture, exportable as pcap.
+// See `pd_capture_write_pcap()`.
+#undef CONFIG_PD_CAPTURE
+//#define CONFIG_PD_CAPTURE_DEPTH 16
+
+// Attach to contract cost: time, event loop passes, timer checks and state
+// transitions per negotiation. See `pd_bench_dump()`.
+#undef CONFIG_PD_BENCH
+
+// Per-port state is carved from application provided arena, for the number
+// of ports present. CONFIG_USB_PD_PORT_MAX_COUNT becomes upper limit only.
+// See `pd_port_arena_init()`.
+#undef CONFIG_PD_PORT_ARENA
+
+// Depth of received messages queue between TCPC driver and event loop,
+// power of 2. See `tcpm_get_rx_overflows()` to check it is enough.
+//#define CONFIG_TCPM_RX_QUEUE_DEPTH 4
+// Put producer and consumer indexes of that queue to separate cache lines,
+// of given size in bytes. Only for cores with data cache. Not compatible
+// with CONFIG_PD_PORT_ARENA when bigger than max_align_t alignment.
+//#define CONFIG_TCPM_RX_QUEUE_CACHE_LINE 32
+
+// Event loop scheduling. When enabled, loop programs one-shot wakeup via
+// `pd_loop_timer_arm()` hook instead of relying on periodic 1-5ms ticks.
+#undef CONFIG_PD_LOOP_TICKLESS
+// Read time once per loop pass and reuse it for all timer checks.
+// See `pd_timer_snapshot_begin()` for precision details.
+#undef CONFIG_PD_TIMER_TIME_SNAPSHOT
+// Store timer deadlines as 32-bit ticks of `get_ticks()` instead of 64-bit
+// microseconds. Tick period must be set too, when enabled. Timers are never
+// early, but may expire up to 2 ticks late.
+#undef CONFIG_PD_TIMER_TICKS
+//#define CONFIG_PD_TIMER_TICK_US 1000
+
+// Plain (non-atomic) read-modify-write for PRL and PE state machine flags.
+// Those are touched from the event loop only, TCPC alerts pass results via
+// dedicated fields. Saves interrupt masking on cores without LDREX/STREX.
+// DPM flags, DPM requests and PD events stay atomic, they are set from
+// application context too.
+#undef CONFIG_USB_PD_SINGLE_CONTEXT_FLAGS
+
+// Sink-only Policy Engine. Drops role swap, FRS, BIST, Enter_USB and
+// discovery states with their timers and VDM storage. Partner requests for
+// those are answered with Not_Supported. See `support/size_report.py` to
+// compare footprint.
+#undef CONFIG_PD_SINK_ONLY
+
+// Maximum voltage to request as sink, see `pd_set_max_voltage()`. Source
+// PDO is selected by `pd_snk_set_policy()` rules, see include/pd_snk_policy.h.
+#define PD_MAX_VOLTAGE_MV 48000
+
+// PPS / AVS closed-loop control for direct charging, see
+// `pd_snk_pps_start()`.
+#undef CONFIG_PD_SNK_PPS
+
+// Cache of known chargers. On re-attach, Request is built from the cached
+// selection, and EPR entry is not retried with a source that refused it.
+// See `pd_snk_cache_restore()`.
+#undef CONFIG_PD_SNK_CACHE
+//#define CONFIG_PD_SNK_CACHE_SIZE 4
+// Pass cache to `pd_snk_cache_save()` hook after each change
+#undef CONFIG_PD_SNK_CACHE_PERSIST
@@ -0,0 +1,957 @@
+/*
+ * Sink power policy, see include/pd_snk_policy.h.
+ *
+ * Source_Capabilities are decoded once into per-port arrays (one array per
+ * field, so scoring loop touches only what it needs). Scoring is a single
+ * pass over at most PDO_MAX_OBJECTS entries, integer math only, so request
+ * is built well within tSenderResponse even on small cores.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "src/pd_config.h"
+#include "src/portage/pd_loop.h"
+#include "pd_port_arena.h"
+#include "pd_snk_policy.h"
+#include "usb_pd.h"
+#include "usb_pd_timer.h"
+#include "usb_pe_sm.h"
+#include "util.h"
+
+#define MAX_PD_PORTS CONFIG_USB_PD_PORT_MAX_COUNT
+
+/* AVS current follows PDP, but can't exceed 5A of EPR cable */
+#define AVS_MAX_MA 5000
+
+enum cap_type {
+	/* Unknown type, or zero padding of EPR capabilities */
+	CAP_NONE,
+	CAP_FIXED,
+	CAP_VARIABLE,
+	CAP_BATTERY,
+	CAP_PPS,
+	CAP_AVS,
+};
+
+/*
+ * Decoded source capabilities. `lim` is max current in mA, or max power in
+ * 250mW units for CAP_BATTERY and CAP_AVS.
+ */
+static struct src_caps_tab {
+	uint8_t cnt;
+	uint8_t type[PDO_MAX_OBJECTS];
+	uint16_t min_mv[PDO_MAX_OBJECTS];
+	uint16_t max_mv[PDO_MAX_OBJECTS];
+	uint16_t lim[PDO_MAX_OBJECTS];
+	uint32_t pdo[PDO_MAX_OBJECTS];
+} PD_PORT_DATA(caps);
+
+/* Operating point of one PDO under current policy */
+struct candidate {
+	uint8_t idx;
+	uint16_t mv;
+	uint16_t ma;
+	uint32_t mw;
+	/* Power after conversion losses, PD_SNK_POLICY_EFFICIENCY only */
+	uint32_t eff_mw;
+};
+
+static struct pd_snk_policy PD_PORT_DATA(policy);
+static struct pd_snk_selection PD_PORT_DATA(selection);
+static bool PD_PORT_DATA(policy_set);
+
+static unsigned int max_request_mv = PD_MAX_VOLTAGE_MV;
+
+#ifdef CONFIG_PD_SNK_PPS
+/* Re-request period. tPPSRequest is 10s max, source times out at 12s+ */
+#define PPS_KEEPALIVE_US (8 * SECOND)
+
+/* Start / stop from application, applied by pd_snk_pps_run() */
+enum pps_req {
+	PPS_REQ_NONE,
+	PPS_REQ_START,
+	PPS_REQ_STOP,
+};
+
+static struct pps_ctl {
+	struct pd_snk_pps_config cfg;
+	/* Pending start / stop, the last one wins. `req_cfg` goes with start */
+	atomic_uint req;
+	struct pd_snk_pps_config req_cfg;
+	bool active;
+	/* Contract must be renegotiated, even without target change */
+	bool renegotiate;
+	/* Request in flight, built at `sent_at` (low word of get_time()) */
+	bool pending;
+	uint32_t sent_at;
+	/* Target set by application, mV << 16 | mA */
+	atomic_uint target;
+	/* Last requested operating point */
+	uint16_t req_mv;
+	uint16_t req_ma;
+	struct pd_snk_pps_status status;
+	struct pd_snk_pps_stats stats;
+} PD_PORT_DATA(pps);
+#endif
+
+static const struct pd_snk_policy default_policy = {
+	.mode = PD_SNK_POLICY_MAX_POWER,
+	.min_mv = PD_V_SAFE5V_NOM,
+	.max_mv = PD_MAX_VOLTAGE_MV,
+};
+
+static void decode_pdo(uint32_t pdo, uint8_t *type, uint16_t *min_mv,
+		       uint16_t *max_mv, uint16_t *lim)
+{
+	*type = CAP_NONE;
+	*min_mv = *max_mv = *lim = 0;
+
+	if (!pdo)
+		return;
+
+	switch (pdo & PDO_TYPE_MASK) {
+	case PDO_TYPE_FIXED:
+		*type = CAP_FIXED;
+		*min_mv = *max_mv = PDO_FIXED_GET_VOLT(pdo);
+		*lim = PDO_FIXED_GET_CURR(pdo);
+		break;
+	case PDO_TYPE_VARIABLE:
+		*type = CAP_VARIABLE;
+		*max_mv = ((pdo >> 20) & 0x3FF) * 50;
+		*min_mv = ((pdo >> 10) & 0x3FF) * 50;
+		*lim = (pdo & 0x3FF) * 10;
+		break;
+	case PDO_TYPE_BATTERY:
+		*type = CAP_BATTERY;
+		*max_mv = ((pdo >> 20) & 0x3FF) * 50;
+		*min_mv = ((pdo >> 10) & 0x3FF) * 50;
+		*lim = pdo & 0x3FF;
+		break;
+	case PDO_TYPE_AUGMENTED:
+		if (PDO_AUG_GET_PPS(pdo) == PDO_AUG_PPS_SPR) {
+			*type = CAP_PPS;
+			*max_mv = ((pdo >> 17) & 0xFF) * 100;
+			*min_mv = ((pdo >> 8) & 0xFF) * 100;
+			*lim = (pdo & 0x7F) * 50;
+		} else if (PDO_AUG_GET_PPS(pdo) == PDO_AUG_PPS_EPR) {
+			*type = CAP_AVS;
+			*max_mv = ((pdo >> 17) & 0x1FF) * 100;
+			*min_mv = ((pdo >> 8) & 0xFF) * 100;
+			/* PDP is in 1W units */
+			*lim = (pdo & 0xFF) * 4;
+		}
+		break;
+	}
+
+	/* Malformed, would also divide by zero in cap_max_ma() */
+	if (!*min_mv || *max_mv < *min_mv) {
+		*type = CAP_NONE;
+		*min_mv = *max_mv = *lim = 0;
+	}
+}
+
+void pd_process_source_cap(int port, int cnt, uint32_t *src_caps)
+{
+	struct src_caps_tab *tab = &caps[port];
+
+	tab->cnt = MIN(cnt, PDO_MAX_OBJECTS);
+
+	for (int i = 0; i < tab->cnt; i++) {
+		tab->pdo[i] = src_caps[i];
+		decode_pdo(src_caps[i], &tab->type[i], &tab->min_mv[i],
+			   &tab->max_mv[i], &tab->lim[i]);
+	}
+}
+
+/* Max current of decoded PDO at `mv` */
+static uint32_t cap_max_ma(uint8_t type, uint16_t lim, uint32_t mv)
+{
+	switch (type) {
+	case CAP_BATTERY:
+		return lim * 250000 / mv;
+	case CAP_AVS:
+		return MIN(lim * 250000 / mv, AVS_MAX_MA);
+	default:
+		return lim;
+	}
+}
+
+/* Efficiency at `mv`, percent, linear between curve points */
+static uint32_t eff_pct(const struct pd_snk_policy *p, uint32_t mv)
+{
+	const struct pd_snk_eff_point *e = p->eff;
+	int i;
+
+	if (!p->eff_cnt)
+		return 100;
+
+	if (mv <= e[0].mv)
+		return e[0].pct;
+
+	for (i = 1; i < p->eff_cnt; i++) {
+		if (mv <= e[i].mv)
+			return e[i - 1].pct +
+			       ((int32_t)e[i].pct - e[i - 1].pct) *
+				       (int32_t)(mv - e[i - 1].mv) /
+				       (e[i].mv - e[i - 1].mv);
+	}
+
+	return e[p->eff_cnt - 1].pct;
+}
+
+/*
+ * Fill operating point of PDO `i`. Returns false if PDO can't be used
+ * within voltage window [min_mv, max_mv].
+ */
+static bool evaluate(const struct src_caps_tab *tab,
+		     const struct pd_snk_policy *p, int i, uint32_t min_mv,
+		     uint32_t max_mv, struct candidate *c)
+{
+	const uint32_t lo = MAX(tab->min_mv[i], min_mv);
+	const uint32_t hi = MIN(tab->max_mv[i], max_mv);
+	uint32_t mv, ma, mw;
+
+	switch (tab->type[i]) {
+	case CAP_FIXED:
+	case CAP_VARIABLE:
+	case CAP_BATTERY:
+		/* Source can be anywhere in PDO range, it must fit window */
+		if (tab->min_mv[i] < min_mv || tab->max_mv[i] > max_mv)
+			return false;
+		mv = tab->min_mv[i];
+		break;
+	case CAP_PPS:
+	case CAP_AVS:
+		if (!p->allow_apdo || lo > hi)
+			return false;
+		mv = CLAMP(p->pref_mv ? p->pref_mv : hi, lo, hi);
+		/* Round down to programmable step */
+		mv -= mv % (tab->type[i] == CAP_PPS ? 20 : 100);
+		if (mv < lo)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	ma = cap_max_ma(tab->type[i], tab->lim[i], mv);
+	if (p->max_ma)
+		ma = MIN(ma, p->max_ma);
+	if (p->max_mw)
+		ma = MIN(ma, p->max_mw * 1000 / mv);
+	/* Programmable current is in 50mA units */
+	if (tab->type[i] == CAP_PPS || tab->type[i] == CAP_AVS)
+		ma -= ma % 50;
+
+	mw = mv * ma / 1000;
+
+	c->idx = i;
+	c->mv = mv;
+	c->ma = ma;
+	c->mw = mw;
+	c->eff_mw = p->mode == PD_SNK_POLICY_EFFICIENCY ?
+			    mw * eff_pct(p, mv) / 100 :
+			    mw;
+
+	return true;
+}
+
+static uint32_t volt_dist(const struct pd_snk_policy *p,
+			  const struct candidate *c)
+{
+	return c->mv > p->pref_mv ? c->mv - p->pref_mv : p->pref_mv - c->mv;
+}
+
+/* True if `a` is better than `b`. Earlier PDO wins on full tie. */
+static bool is_better(const struct pd_snk_policy *p,
+		      const struct candidate *a, const struct candidate *b)
+{
+	if (p->mode == PD_SNK_POLICY_PREFER_VOLTAGE) {
+		const bool a_ok = a->mw >= p->op_mw;
+		const bool b_ok = b->mw >= p->op_mw;
+
+		if (a_ok != b_ok)
+			return a_ok;
+		if (a_ok && volt_dist(p, a) != volt_dist(p, b))
+			return volt_dist(p, a) < volt_dist(p, b);
+	}
+
+	if (a->eff_mw != b->eff_mw)
+		return a->eff_mw > b->eff_mw;
+
+	return a->mv < b->mv;
+}
+
+#ifdef CONFIG_PD_SNK_PPS
+/*
+ * Find programmable PDO covering PPS target voltage, with the highest
+ * current. Returns false if there is none.
+ */
+static bool pps_candidate(int port, const struct pd_snk_policy *p,
+			  uint32_t t, uint32_t max_mv, struct candidate *best)
+{
+	const struct src_caps_tab *tab = &caps[port];
+	/* Only target voltage and current matter, not the policy mode */
+	const struct pd_snk_policy pol = {
+		.pref_mv = t >> 16,
+		.max_ma = p->max_ma ? MIN(p->max_ma, t & 0xFFFF) : t & 0xFFFF,
+		.max_mw = p->max_mw,
+		.allow_apdo = true,
+	};
+	struct candidate c;
+	bool found = false;
+
+	for (int i = 0; i < tab->cnt; i++) {
+		if (tab->type[i] != CAP_PPS && tab->type[i] != CAP_AVS)
+			continue;
+		if (pol.pref_mv < tab->min_mv[i] ||
+		    pol.pref_mv > tab->max_mv[i])
+			continue;
+		if (!evaluate(tab, &pol, i, 0, max_mv, &c))
+			continue;
+		if (!found || c.ma > best->ma) {
+			*best = c;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+/*
+ * Operating point for active PPS controller. If target is out of all
+ * programmable PDOs, policy selection is used, and the target is kept in
+ * req_mv / req_ma, so it is retried only when it moves by a step.
+ */
+static bool pps_select(int port, const struct pd_snk_policy *p,
+		       uint32_t max_mv, struct candidate *best)
+{
+	struct pps_ctl *ctl = &pps[port];
+	const uint32_t t =
+		atomic_load_explicit(&ctl->target, memory_order_relaxed);
+	const bool found = pps_candidate(port, p, t, max_mv, best);
+
+	ctl->renegotiate = false;
+	ctl->pending = true;
+	ctl->sent_at = get_time().le.lo;
+	ctl->req_mv = found ? best->mv : t >> 16;
+	ctl->req_ma = found ? best->ma : t & 0xFFFF;
+
+	pd_timer_enable(port, DPM_TIMER_PPS_INTERVAL,
+			ctl->cfg.min_interval_ms * MSEC);
+	/* AVS is used in EPR mode only, where EPR_KeepAlive does the job */
+	if (found && caps[port].type[best->idx] == CAP_PPS)
+		pd_timer_enable(port, DPM_TIMER_PPS_KEEPALIVE,
+				PPS_KEEPALIVE_US);
+	else
+		pd_timer_disable(port, DPM_TIMER_PPS_KEEPALIVE);
+
+	return found;
+}
+#endif
+
+#ifdef CONFIG_PD_SNK_CACHE
+
+#ifndef CONFIG_PD_SNK_CACHE_SIZE
+#define CONFIG_PD_SNK_CACHE_SIZE 4
+#endif
+
+#define CACHE_SIZE CONFIG_PD_SNK_CACHE_SIZE
+/*
+ * Saved content of other layout, size or version is not restored. Version
+ * 2: only permanent EPR refusals are stored.
+ */
+#define CACHE_VERSION 2
+#define CACHE_MAGIC (0x50440000 | (CACHE_VERSION << 8) | CACHE_SIZE)
+
+/* FNV-1a */
+#define HASH_INIT 2166136261u
+
+enum cache_epr {
+	CACHE_EPR_UNKNOWN,
+	CACHE_EPR_ENTERED,
+	CACHE_EPR_REFUSED,
+};
+
+struct cache_entry {
+	/* Hash of source caps and policy, see cache_make_key() */
+	uint32_t key;
+	/* Selected PDO, to catch hash collisions */
+	uint32_t pdo;
+	uint16_t mv;
+	uint16_t ma;
+	uint8_t idx;
+	bool mismatch;
+	/* enum cache_epr */
+	uint8_t epr;
+};
+
+/* Entries are kept most recently used first */
+static struct {
+	uint32_t magic;
+	uint32_t cnt;
+	struct cache_entry e[CACHE_SIZE];
+} cache = { .magic = CACHE_MAGIC };
+
+enum cache_req_state {
+	/* Request is not by policy (PPS), not cacheable */
+	CACHE_REQ_NONE,
+	CACHE_REQ_HIT,
+	CACHE_REQ_MISS,
+};
+
+/* Request in flight, and the contract made by it */
+static struct cache_req {
+	uint32_t key;
+	uint8_t state;
+	/* Key of the current contract, 0 if none or not cacheable */
+	uint32_t contract_key;
+} PD_PORT_DATA(creq);
+
+static uint32_t hash(uint32_t h, const void *data, int len)
+{
+	const uint8_t *b = data;
+
+	while (len--) {
+		h ^= *b++;
+		h *= 16777619;
+	}
+
+	return h;
+}
+
+/*
+ * Cached selection is valid only for the same source caps and the same
+ * policy, so both are hashed. 0 means no key.
+ */
+static uint32_t cache_make_key(int port, const struct pd_snk_policy *p)
+{
+	const struct src_caps_tab *tab = &caps[port];
+	const uint32_t v[] = {
+		p->mode, p->min_mv, p->max_mv, p->pref_mv, p->max_ma,
+		p->max_mw, p->op_mw, p->allow_apdo, p->rdo_flags,
+		max_request_mv,
+	};
+	uint32_t h = HASH_INIT;
+
+	h = hash(h, tab->pdo, tab->cnt * sizeof(tab->pdo[0]));
+	h = hash(h, v, sizeof(v));
+	for (int i = 0; i < p->eff_cnt; i++) {
+		h = hash(h, &p->eff[i].mv, sizeof(p->eff[i].mv));
+		h = hash(h, &p->eff[i].pct, sizeof(p->eff[i].pct));
+	}
+
+	return h ? h : 1;
+}
+
+static struct cache_entry *cache_find(uint32_t key)
+{
+	for (uint32_t i = 0; i < cache.cnt; i++) {
+		if (cache.e[i].key == key)
+			return &cache.e[i];
+	}
+
+	return NULL;
+}
+
+/* Move entry to front, returns its new location */
+static struct cache_entry *cache_touch(struct cache_entry *e)
+{
+	const struct cache_entry tmp = *e;
+
+	memmove(&cache.e[1], &cache.e[0], (e - cache.e) * sizeof(*e));
+	cache.e[0] = tmp;
+
+	return &cache.e[0];
+}
+
+static void cache_drop(struct cache_entry *e)
+{
+	const uint32_t i = e - cache.e;
+
+	cache.cnt--;
+	memmove(e, e + 1, (cache.cnt - i) * sizeof(*e));
+}
+
+static void cache_save(void)
+{
+#ifdef CONFIG_PD_SNK_CACHE_PERSIST
+	pd_snk_cache_save(&cache, sizeof(cache));
+#endif
+}
+
+static void cache_skip(int port)
+{
+	creq[port].state = CACHE_REQ_NONE;
+}
+
+/*
+ * Take operating point from cache. On hit, `found` is set as policy
+ * selection did when entry was stored.
+ */
+static bool cache_select(int port, const struct pd_snk_policy *p,
+			 struct candidate *best, bool *found)
+{
+	const struct src_caps_tab *tab = &caps[port];
+	struct cache_req *r = &creq[port];
+	struct cache_entry *e;
+
+	r->key = cache_make_key(port, p);
+	r->state = CACHE_REQ_MISS;
+
+	e = cache_find(r->key);
+	if (!e || e->idx >= tab->cnt || tab->pdo[e->idx] != e->pdo)
+		return false;
+
+	*best = (struct candidate){
+		.idx = e->idx,
+		.mv = e->mv,
+		.ma = e->ma,
+		.mw = (uint32_t)e->mv * e->ma / 1000,
+	};
+	*found = !e->mismatch;
+	r->state = CACHE_REQ_HIT;
+
+	return true;
+}
+
+static void cache_request_done(int port, bool accepted)
+{
+	struct cache_req *r = &creq[port];
+	const struct pd_snk_selection *sel = &selection[port];
+	struct cache_entry *e;
+
+	if (!accepted) {
+		/* Source changed its mind, select from scratch next time */
+		if (r->state == CACHE_REQ_HIT) {
+			e = cache_find(r->key);
+			if (e) {
+				cache_drop(e);
+				cache_save();
+			}
+		}
+		r->state = CACHE_REQ_NONE;
+		return;
+	}
+
+	r->contract_key = r->state == CACHE_REQ_NONE ? 0 : r->key;
+
+	if (r->state == CACHE_REQ_HIT) {
+		/* Order only, not worth a flash write */
+		e = cache_find(r->key);
+		if (e)
+			cache_touch(e);
+	} else if (r->state == CACHE_REQ_MISS) {
+		if (cache.cnt < CACHE_SIZE)
+			cache.cnt++;
+		memmove(&cache.e[1], &cache.e[0],
+			(cache.cnt - 1) * sizeof(cache.e[0]));
+		cache.e[0] = (struct cache_entry){
+			.key = r->key,
+			.pdo = sel->pdo,
+			.mv = sel->mv,
+			.ma = sel->ma,
+			.idx = sel->pos - 1,
+			.mismatch = sel->mismatch,
+		};
+		cache_save();
+	}
+
+	r->state = CACHE_REQ_NONE;
+}
+#endif /* CONFIG_PD_SNK_CACHE */
+
+static uint32_t build_rdo(const struct src_caps_tab *tab,
+			  const struct candidate *c, uint32_t flags)
+{
+	const int pos = c->idx + 1;
+
+	switch (tab->type[c->idx]) {
+	case CAP_BATTERY:
+		return RDO_BATT(pos, c->mw, c->mw, flags);
+	case CAP_PPS:
+		return RDO_PPS(pos, c->mv, c->ma, flags);
+	case CAP_AVS:
+		return RDO_AVS(pos, c->mv, c->ma, flags);
+	default:
+		return RDO_FIXED(pos, c->ma, c->ma, flags);
+	}
+}
+
+/* Best PDO by policy. Returns false if none fits the voltage window. */
+static bool policy_select(const struct src_caps_tab *tab,
+			  const struct pd_snk_policy *p, uint32_t max_mv,
+			  struct candidate *best)
+{
+	struct candidate c;
+	bool found = false;
+
+	for (int i = 0; i < tab->cnt; i++) {
+		if (!evaluate(tab, p, i, p->min_mv, max_mv, &c))
+			continue;
+		if (!found || is_better(p, &c, best)) {
+			*best = c;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+void pd_build_request(int32_t vpd_vdo, uint32_t *rdo, uint32_t *ma,
+		      uint32_t *mv, int port)
+{
+	const struct src_caps_tab *tab = &caps[port];
+	const struct pd_snk_policy *p = pd_snk_get_policy(port);
+	const uint32_t max_mv = MIN(p->max_mv, max_request_mv);
+	struct pd_snk_selection *sel = &selection[port];
+	struct candidate best;
+	bool found = false;
+	bool hit = false;
+	uint32_t flags = p->rdo_flags;
+
+	/* VPD charge-through is not supported by sink, vpd_vdo is ignored */
+
+#ifdef CONFIG_PD_SNK_PPS
+	if (pps[port].active)
+		found = pps_select(port, p, max_mv, &best);
+#endif
+
+#ifdef CONFIG_PD_SNK_CACHE
+	if (found)
+		cache_skip(port);
+	else
+		hit = cache_select(port, p, &best, &found);
+#endif
+
+	if (!found && !hit)
+		found = policy_select(tab, p, max_mv, &best);
+
+	/* Nothing fits policy, take vSafe5V */
+	if (!found && !hit) {
+		const struct pd_snk_policy any = {
+			.max_ma = p->max_ma,
+			.max_mw = p->max_mw,
+		};
+
+		if (!tab->cnt || !evaluate(tab, &any, 0, 0, UINT16_MAX, &best))
+			best = (struct candidate){ .mv = PD_V_SAFE5V_NOM };
+	}
+
+	sel->mismatch = !found || best.mw < p->op_mw;
+	if (sel->mismatch)
+		flags |= RDO_CAP_MISMATCH;
+#ifdef CONFIG_USB_PD_EPR
+	flags |= RDO_EPR_MODE_CAPABLE;
+#endif
+
+	*rdo = build_rdo(tab, &best, flags);
+	*ma = best.ma;
+	*mv = best.mv;
+
+	sel->pdo = tab->pdo[best.idx];
+	sel->pos = best.idx + 1;
+	sel->mv = best.mv;
+	sel->ma = best.ma;
+}
+
+#ifdef CONFIG_PD_PORT_ARENA
+void pd_snk_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(caps, count);
+	PD_PORT_DATA_TAKE(policy, count);
+	PD_PORT_DATA_TAKE(selection, count);
+	PD_PORT_DATA_TAKE(policy_set, count);
+#ifdef CONFIG_PD_SNK_PPS
+	PD_PORT_DATA_TAKE(pps, count);
+#endif
+#ifdef CONFIG_PD_SNK_CACHE
+	PD_PORT_DATA_TAKE(creq, count);
+#endif
+}
+#endif
+
+void pd_snk_set_policy(int port, const struct pd_snk_policy *p)
+{
+	policy[port] = *p;
+	policy_set[port] = true;
+}
+
+const struct pd_snk_policy *pd_snk_get_policy(int port)
+{
+	return policy_set[port] ? &policy[port] : &default_policy;
+}
+
+const struct pd_snk_selection *pd_snk_get_selection(int port)
+{
+	return &selection[port];
+}
+
+void pd_set_max_voltage(unsigned int mv)
+{
+	max_request_mv = mv;
+}
+
+unsigned int pd_get_max_voltage(void)
+{
+	return max_request_mv;
+}
+
+void pd_extract_pdo_power(uint32_t pdo, uint32_t *ma, uint32_t *max_mv,
+			  uint32_t *min_mv)
+{
+	uint8_t type;
+	uint16_t lo, hi, lim;
+
+	decode_pdo(pdo, &type, &lo, &hi, &lim);
+
+	*min_mv = lo;
+	*max_mv = hi;
+	*ma = cap_max_ma(type, lim, lo);
+}
+
+int pd_find_pdo_index(uint32_t src_cap_cnt, const uint32_t *const src_caps,
+		      int max_mv, uint32_t *selected_pdo)
+{
+	const struct pd_snk_policy any = { 0 };
+	struct src_caps_tab tab;
+	struct candidate best, c;
+	int ret = 0;
+
+	tab.cnt = MIN(src_cap_cnt, PDO_MAX_OBJECTS);
+	for (int i = 0; i < tab.cnt; i++)
+		decode_pdo(src_caps[i], &tab.type[i], &tab.min_mv[i],
+			   &tab.max_mv[i], &tab.lim[i]);
+
+	best.mw = 0;
+	for (int i = 0; i < tab.cnt; i++) {
+		if (!evaluate(&tab, &any, i, 0, max_mv, &c))
+			continue;
+		if (c.mw > best.mw) {
+			best = c;
+			ret = i;
+		}
+	}
+
+	*selected_pdo = src_caps[ret];
+	return ret;
+}
+
+#ifdef CONFIG_PD_SNK_PPS
+void pd_snk_pps_start(int port, const struct pd_snk_pps_config *cfg,
+		      uint16_t mv, uint16_t ma)
+{
+	struct pps_ctl *ctl = &pps[port];
+
+	ctl->req_cfg = *cfg;
+	atomic_store(&ctl->target, (uint32_t)mv << 16 | ma);
+	atomic_store(&ctl->req, PPS_REQ_START);
+
+	pd_loop_wake(port);
+}
+
+void pd_snk_pps_stop(int port)
+{
+	atomic_store(&pps[port].req, PPS_REQ_STOP);
+
+	pd_loop_wake(port);
+}
+
+void pd_snk_pps_set_target(int port, uint16_t mv, uint16_t ma)
+{
+	atomic_store(&pps[port].target, (uint32_t)mv << 16 | ma);
+	pd_loop_wake(port);
+}
+
+void pd_snk_pps_request_status(int port)
+{
+	pd_dpm_request(port, DPM_REQUEST_GET_PPS_STATUS);
+	pd_loop_wake(port);
+}
+
+const struct pd_snk_pps_status *pd_snk_pps_get_status(int port)
+{
+	return &pps[port].status;
+}
+
+const struct pd_snk_pps_stats *pd_snk_pps_get_stats(int port)
+{
+	return &pps[port].stats;
+}
+
+static bool pps_moved(uint16_t req, uint16_t target, uint16_t step)
+{
+	const uint16_t diff = req > target ? req - target : target - req;
+
+	return diff && diff >= step;
+}
+
+void pd_snk_pps_run(int port)
+{
+	struct pps_ctl *ctl = &pps[port];
+	const struct pd_snk_selection *sel = &selection[port];
+	uint32_t t;
+	bool need;
+
+	switch (atomic_exchange(&ctl->req, PPS_REQ_NONE)) {
+	case PPS_REQ_START:
+		ctl->cfg = ctl->req_cfg;
+		ctl->stats = (struct pd_snk_pps_stats){ .min_us = UINT32_MAX };
+		ctl->pending = false;
+		ctl->renegotiate = true;
+		ctl->active = true;
+		break;
+	case PPS_REQ_STOP:
+		if (!ctl->active)
+			break;
+		ctl->active = false;
+		pd_timer_disable(port, DPM_TIMER_PPS_INTERVAL);
+		pd_timer_disable(port, DPM_TIMER_PPS_KEEPALIVE);
+		/* Back to the PDO chosen by policy */
+		if (pe_is_explicit_contract(port))
+			pd_dpm_request(port, DPM_REQUEST_NEW_POWER_LEVEL);
+		break;
+	}
+
+	if (!ctl->active)
+		return;
+
+	/* Hard / Soft Reset, detach. New contract will use target anyway */
+	if (!pe_is_explicit_contract(port)) {
+		ctl->pending = false;
+		return;
+	}
+
+	if (ctl->pending)
+		return;
+
+	t = atomic_load_explicit(&ctl->target, memory_order_relaxed);
+
+	/*
+	 * Not on programmable PDO, req_mv / req_ma hold the target which had
+	 * no match. Retry when it moves out of dead band, not on each pass.
+	 */
+	need = ctl->renegotiate ||
+	       pps_moved(ctl->req_mv, t >> 16, ctl->cfg.step_mv) ||
+	       pps_moved(ctl->req_ma, t & 0xFFFF, ctl->cfg.step_ma);
+
+	if ((sel->pdo & PDO_TYPE_MASK) == PDO_TYPE_AUGMENTED)
+		need = need ||
+		       pd_timer_is_expired(port, DPM_TIMER_PPS_KEEPALIVE);
+
+	if (!need)
+		return;
+
+	/* Coalesce target changes, one Request per interval */
+	if (!pd_timer_is_disabled(port, DPM_TIMER_PPS_INTERVAL) &&
+	    !pd_timer_is_expired(port, DPM_TIMER_PPS_INTERVAL))
+		return;
+
+	/* Request is built (and timers restarted) by pd_build_request() */
+	ctl->renegotiate = false;
+	pd_dpm_request(port, DPM_REQUEST_NEW_POWER_LEVEL);
+}
+
+static void pps_request_done(int port, bool accepted)
+{
+	struct pps_ctl *ctl = &pps[port];
+	struct pd_snk_pps_stats *st = &ctl->stats;
+	uint32_t lat;
+
+	if (!ctl->active || !ctl->pending)
+		return;
+
+	ctl->pending = false;
+
+	if (!accepted) {
+		/* Retry after interval */
+		st->rejected++;
+		ctl->renegotiate = true;
+		return;
+	}
+
+	lat = get_time().le.lo - ctl->sent_at;
+	st->count++;
+	st->sum_us += lat;
+	st->min_us = MIN(st->min_us, lat);
+	st->max_us = MAX(st->max_us, lat);
+}
+
+void pd_snk_pps_status_received(int port, const uint8_t *buf)
+{
+	struct pd_snk_pps_status *st = &pps[port].status;
+	const uint16_t out_v = buf[0] | buf[1] << 8;
+
+	st->out_mv = out_v == 0xFFFF ? 0xFFFF : out_v * 20;
+	st->out_ma = buf[2] == 0xFF ? 0xFFFF : buf[2] * 50;
+	st->flags = buf[3];
+	st->seq++;
+}
+#endif /* CONFIG_PD_SNK_PPS */
+
+void pd_snk_request_done(int port, bool accepted)
+{
+#ifdef CONFIG_PD_SNK_PPS
+	pps_request_done(port, accepted);
+#endif
+#ifdef CONFIG_PD_SNK_CACHE
+	cache_request_done(port, accepted);
+#endif
+}
+
+#ifdef CONFIG_PD_SNK_CACHE
+bool pd_snk_cache_restore(const void *data, int len)
+{
+	const uint32_t *magic = data;
+
+	if (len != sizeof(cache) || *magic != CACHE_MAGIC)
+		return false;
+
+	memcpy(&cache, data, sizeof(cache));
+	cache.cnt = MIN(cache.cnt, CACHE_SIZE);
+
+	return true;
+}
+
+void pd_snk_cache_clear(void)
+{
+	cache.cnt = 0;
+	memset(creq, 0, sizeof(*creq) * pd_port_count);
+	cache_save();
+}
+
+bool pd_snk_cache_skip_epr(int port)
+{
+	const struct cache_entry *e = cache_find(creq[port].contract_key);
+
+	return e && e->epr == CACHE_EPR_REFUSED;
+}
+
+void pd_snk_cache_epr_done(int port, bool entered, uint8_t reason)
+{
+	struct cache_entry *e = cache_find(creq[port].contract_key);
+	uint8_t epr;
+
+	if (!e)
+		return;
+
+	if (entered)
+		epr = CACHE_EPR_ENTERED;
+	else if (reason == PD_EPRMDO_ENTER_FAILED_DATA_PDO)
+		/* Source is not EPR capable, that won't change */
+		epr = CACHE_EPR_REFUSED;
+	else
+		/*
+		 * Cable, VCONN, power budget shared with other ports, or
+		 * unknown cause - can be different next time
+		 */
+		return;
+
+	if (e->epr != epr) {
+		e->epr = epr;
+		cache_save();
+	}
+}
+#endif /* CONFIG_PD_SNK_CACHE */
@@ -0,0 +1,202 @@
+/*
+ * Received PD messages queue, between TCPC driver (ISR / alert handler) and
+ * event loop. Replaces the cached messages queue of EC's tcpci.c.
+ *
+ * Single producer (`tcpm_enqueue_message()`), single consumer (protocol
+ * layer), lock-free. Each index is written by one side only, so no
+ * interrupt masking is needed.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "src/pd_config.h"
+#include "src/portage/pd_loop.h"
+#include "pd_port_arena.h"
+#include "tcpm.h"
+
+#define MAX_PD_PORTS CONFIG_USB_PD_PORT_MAX_COUNT
+
+#ifndef CONFIG_TCPM_RX_QUEUE_DEPTH
+#define CONFIG_TCPM_RX_QUEUE_DEPTH 4
+#endif
+
+#define RX_QUEUE_DEPTH CONFIG_TCPM_RX_QUEUE_DEPTH
+#define RX_QUEUE_MASK (RX_QUEUE_DEPTH - 1)
+
+_Static_assert(RX_QUEUE_DEPTH >= 2 &&
+		       (RX_QUEUE_DEPTH & RX_QUEUE_MASK) == 0,
+	       "CONFIG_TCPM_RX_QUEUE_DEPTH must be a power of 2");
+
+/*
+ * Without data cache (most MCUs) padding only wastes RAM, so indexes are
+ * packed by default.
+ */
+#ifdef CONFIG_TCPM_RX_QUEUE_CACHE_LINE
+#define RX_QUEUE_ALIGN _Alignas(CONFIG_TCPM_RX_QUEUE_CACHE_LINE)
+#else
+#define RX_QUEUE_ALIGN
+#endif
+
+struct rx_slot {
+	/* Up to 7 data objects, 32-bit aligned for in-place access */
+	uint32_t payload[7];
+	int header;
+	/* Low 32 bits of get_time() when message was pulled from TCPC */
+	uint32_t ts;
+};
+
+static struct rx_queue {
+	struct rx_slot slot[RX_QUEUE_DEPTH];
+	/*
+	 * Producer side. head is free running, wraps over uint. overflows
+	 * counts messages dropped because queue was full.
+	 */
+	RX_QUEUE_ALIGN atomic_uint head;
+	atomic_uint overflows;
+	/*
+	 * Consumer side. tail is free running, wraps over uint. peeked is
+	 * set while the tail slot is peeked and not released yet.
+	 */
+	RX_QUEUE_ALIGN atomic_uint tail;
+	bool peeked;
+} PD_PORT_DATA(rxq);
+
+#ifdef CONFIG_PD_PORT_ARENA
+_Static_assert(_Alignof(struct rx_queue) <= _Alignof(max_align_t),
+	       "CONFIG_TCPM_RX_QUEUE_CACHE_LINE is over arena alignment");
+
+void tcpm_rx_queue_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(rxq, count);
+}
+#endif
+
+int tcpm_enqueue_message(int port)
+{
+	struct rx_queue *const q = &rxq[port];
+	const unsigned int head =
+		atomic_load_explicit(&q->head, memory_order_relaxed);
+	const unsigned int tail =
+		atomic_load_explicit(&q->tail, memory_order_acquire);
+	/* Stamp before slow bus transfer, closer to real reception time */
+	const uint32_t ts = get_time().le.lo;
+	struct rx_slot *s = &q->slot[head & RX_QUEUE_MASK];
+	struct rx_slot dropped;
+	int rv;
+
+	/*
+	 * Message still has to be pulled out of TCPC, or it will keep
+	 * alerting. Read it to scratch and drop.
+	 */
+	if (head - tail >= RX_QUEUE_DEPTH)
+		s = &dropped;
+
+	rv = tcpc_config[port].drv->get_message_raw(port, s->payload,
+						    &s->header);
+	if (rv)
+		return rv;
+
+	if (s == &dropped) {
+		atomic_fetch_add_explicit(&q->overflows, 1,
+					  memory_order_relaxed);
+		return EC_ERROR_OVERFLOW;
+	}
+
+	s->ts = ts;
+
+	/* Publish slot content before the index */
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+
+	/* Wake up loop so it can process incoming RX messages */
+	pd_loop_wake(port);
+
+	return EC_SUCCESS;
+}
+
+int tcpm_has_pending_message(int port)
+{
+	struct rx_queue *const q = &rxq[port];
+	const unsigned int head =
+		atomic_load_explicit(&q->head, memory_order_acquire);
+	const unsigned int tail =
+		atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+	return head - tail > (q->peeked ? 1u : 0u);
+}
+
+int tcpm_peek_message(int port, const uint32_t **payload, int *header)
+{
+	struct rx_queue *const q = &rxq[port];
+	const unsigned int head =
+		atomic_load_explicit(&q->head, memory_order_acquire);
+	const unsigned int tail =
+		atomic_load_explicit(&q->tail, memory_order_relaxed);
+	const struct rx_slot *s = &q->slot[tail & RX_QUEUE_MASK];
+
+	if (head == tail)
+		return EC_ERROR_BUSY;
+
+	*payload = s->payload;
+	*header = s->header;
+	q->peeked = true;
+
+	return EC_SUCCESS;
+}
+
+void tcpm_release_message(int port)
+{
+	struct rx_queue *const q = &rxq[port];
+	const unsigned int tail =
+		atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+	if (!q->peeked)
+		return;
+
+	q->peeked = false;
+
+	/* Slot content is not accessed after this point */
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
+
+int tcpm_dequeue_message(int port, uint32_t *payload, int *header)
+{
+	const uint32_t *p;
+	int rv;
+
+	rv = tcpm_peek_message(port, &p, header);
+	if (rv)
+		return rv;
+
+	memcpy(payload, p, sizeof(rxq[port].slot[0].payload));
+	tcpm_release_message(port);
+
+	return EC_SUCCESS;
+}
+
+void tcpm_clear_pending_messages(int port)
+{
+	struct rx_queue *const q = &rxq[port];
+
+	q->peeked = false;
+	atomic_store_explicit(&q->tail,
+			      atomic_load_explicit(&q->head,
+						   memory_order_acquire),
+			      memory_order_release);
+}
+
+uint32_t tcpm_get_message_rx_ts(int port)
+{
+	struct rx_queue *const q = &rxq[port];
+	const unsigned int tail =
+		atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+	return q->slot[tail & RX_QUEUE_MASK].ts;
+}
+
+uint32_t tcpm_get_rx_overflows(int port)
+{
+	return atomic_load_explicit(&rxq[port].overflows,
+				    memory_order_relaxed);
+}
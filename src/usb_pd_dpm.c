@@ -2,6 +2,7 @@
  * Use of this source code is governed by a BSD-style license that can be
  * found in the LICENSE file.
  */
+#include "pd_port_arena.h"
 #include "queue.h"
 #include "usb_pd.h"
 #include "usb_pd_dpm_sm.h"
@@ -42,7 +43,7 @@ static struct {
 	 * DPM_FLAG_VCONN_SWAP is set.
 	 */
 	enum pd_vconn_role desired_vconn_role;
-} dpm[CONFIG_USB_PD_PORT_MAX_COUNT];
+} PD_PORT_DATA(dpm);
 
 __overridable const struct svdm_response svdm_rsp = {
 	.identity = NULL,
@@ -53,6 +54,10 @@ __overridable const struct svdm_response svdm_rsp = {
 /* Tracker for which task is waiting on sysjump prep to finish */
 static volatile task_id_t sysjump_task_waiting = TASK_ID_INVALID;
 
+/*
+ * Set from application context too (pd_request_vdm(), pd_request_enter_mode(),
+ * ...), so always atomic.
+ */
 #define DPM_SET_FLAG(port, flag) atomic_or(&dpm[(port)].flags, (flag))
 #define DPM_CLR_FLAG(port, flag) atomic_clear_bits(&dpm[(port)].flags, (flag))
 #define DPM_CHK_FLAG(port, flag) (dpm[(port)].flags & (flag))
@@ -93,7 +98,15 @@ __maybe_unused static __const_data const char *const dpm_state_names[] = {
 	[DPM_DATA_RESET] = "DPM Data Reset",
 };
 
-static enum sm_local_state local_state[CONFIG_USB_PD_PORT_MAX_COUNT];
+static enum sm_local_state PD_PORT_DATA(local_state);
+
+#ifdef CONFIG_PD_PORT_ARENA
+void dpm_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(dpm, count);
+	PD_PORT_DATA_TAKE(local_state, count);
+}
+#endif
 
 void dpm_set_debug_level(enum debug_level debug_level)
 {
@@ -304,6 +317,8 @@ enum ec_status pd_request_enter_mode(int port, enum typec_mode mode)
 
 void dpm_init(int port)
 {
+	usb_sm_trace_register(&dpm[port].ctx, USB_SM_DPM, dpm_states,
+			      ARRAY_SIZE(dpm_state_names));
 	dpm[port].flags = 0;
 	dpm[port].pd_button_state = DPM_PD_BUTTON_IDLE;
 	ap_vdm_init(port);
@@ -3,11 +3,10 @@
  * found in the LICENSE file.
  */
 #include "usb_pd_timer.h"
+#include "pd_bench.h"
 #include "pd_config.h"
-#include <stdatomic.h>
-
-/* Workaround, since coccinelle can't patch ATOMIC_DEFINE lines directly */
-#define ATOMIC_DEFINE(VAR,SIZE) ATOMIC_BOOLS_DEFINE(VAR, SIZE)
+#include "pd_port_arena.h"
+#include <string.h>
 
 #define MAX_PD_PORTS CONFIG_USB_PD_PORT_MAX_COUNT
 #define MAX_PD_TIMERS PD_TIMER_COUNT
@@ -17,68 +16,342 @@
 #define NO_TIMEOUT (-1)
 #define EXPIRE_NOW (0)
 
-#define PD_SET_ACTIVE(p,bit) atomic_store(&timer_active[(p) * PD_TIMER_COUNT + (bit)], true)
+/*
+ * Active and disabled timer sets are stored as one bitmask per port. Timers
+ * are only touched from the port's event loop, which is protected from
+ * re-entrance, so plain 64-bit words are used instead of atomics.
+ */
+#define PD_TIMER_BIT(bit) (1ULL << (bit))
+
+#define PD_SET_ACTIVE(p,bit) (timer_active[p] |= PD_TIMER_BIT(bit))
+
+#define PD_CLR_ACTIVE(p,bit) (timer_active[p] &= ~PD_TIMER_BIT(bit))
 
-#define PD_CLR_ACTIVE(p,bit) atomic_store(&timer_active[(p) * PD_TIMER_COUNT + (bit)], false)
+#define PD_CHK_ACTIVE(p,bit) (!!(timer_active[p] & PD_TIMER_BIT(bit)))
 
-#define PD_CHK_ACTIVE(p,bit) atomic_load(&timer_active[(p) * PD_TIMER_COUNT + (bit)])
+#define PD_SET_DISABLED(p,bit) (timer_disabled[p] |= PD_TIMER_BIT(bit))
+
+#define PD_CLR_DISABLED(p,bit) (timer_disabled[p] &= ~PD_TIMER_BIT(bit))
+
+#define PD_CHK_DISABLED(p,bit) (!!(timer_disabled[p] & PD_TIMER_BIT(bit)))
+
+_Static_assert(PD_TIMER_COUNT <= 64, "PD timers must fit 64-bit mask");
+
+/*
+ * Timebase for deadlines. By default those are absolute 64-bit microseconds
+ * from get_time(). With CONFIG_PD_TIMER_TICKS deadlines are 32-bit ticks of
+ * CONFIG_PD_TIMER_TICK_US from get_ticks(), compared in wraparound-safe way.
+ * That works while all pending deadlines are within 2^31 ticks from "now",
+ * which always holds since timeouts are limited to uint32_t microseconds.
+ */
+#ifdef CONFIG_PD_TIMER_TICKS
+#ifndef CONFIG_PD_TIMER_TICK_US
+#error "CONFIG_PD_TIMER_TICK_US must be set with CONFIG_PD_TIMER_TICKS"
+#endif
+typedef uint32_t pd_time_t;
 
-#define PD_SET_DISABLED(p,bit) atomic_store(&timer_disabled[(p) * PD_TIMER_COUNT + (bit)], true)
+/*
+ * Never expire before the requested time: round up, and add one tick since
+ * "now" may be read just before the tick counter advances. Timers may fire
+ * up to 2 ticks late. Zero timeout still expires right away.
+ */
+#define PD_TIME_FROM_US(us)                                               \
+	((us) ? ((uint64_t)(us) + CONFIG_PD_TIMER_TICK_US - 1) /          \
+			CONFIG_PD_TIMER_TICK_US + 1 :                     \
+		0)
+#define PD_TIME_TO_US(t) ((uint64_t)(t) * CONFIG_PD_TIMER_TICK_US)
+#define PD_TIME_READ() get_ticks()
+/* True if time "a" is before time "b" */
+#define PD_TIME_BEFORE(a, b) ((int32_t)((a) - (b)) < 0)
+#else
+typedef uint64_t pd_time_t;
+
+#define PD_TIME_FROM_US(us) (us)
+#define PD_TIME_TO_US(t) (t)
+#define PD_TIME_READ() get_time().val
+#define PD_TIME_BEFORE(a, b) ((a) < (b))
+#endif
+
+test_mockable_static uint64_t PD_PORT_DATA(timer_active);
+test_mockable_static uint64_t PD_PORT_DATA(timer_disabled);
+static pd_time_t PD_PORT_DATA(timer_expires)[PD_TIMER_COUNT];
+
+#ifdef CONFIG_PD_TIMER_TIME_SNAPSHOT
+/* Time taken at the start of current loop pass, see pd_timer_snapshot_begin */
+static pd_time_t PD_PORT_DATA(time_snapshot);
+static bool PD_PORT_DATA(time_snapshot_valid);
+#endif
 
-#define PD_CLR_DISABLED(p,bit) atomic_store(&timer_disabled[(p) * PD_TIMER_COUNT + (bit)], false)
+/*
+ * Active timers of each port are also kept in a binary min-heap, ordered by
+ * expiration time. The nearest deadline is always on top, so the next
+ * expiration is known without scanning all timers.
+ *
+ * timer_heap_pos[] keeps heap index + 1 of each timer, 0 when the timer is
+ * not in the heap. This way zero-initialized storage is valid even before
+ * pd_timer_init() is called.
+ */
+static uint8_t PD_PORT_DATA(timer_heap)[PD_TIMER_COUNT];
+static uint8_t PD_PORT_DATA(timer_heap_pos)[PD_TIMER_COUNT];
+static uint8_t PD_PORT_DATA(timer_heap_size);
 
-#define PD_CHK_DISABLED(p,bit) atomic_load(&timer_disabled[(p) * PD_TIMER_COUNT + (bit)])
+#ifdef CONFIG_PD_TIMER_STATS
+/*
+ * CONFIG_PD_TIMER_STATS debug variables
+ */
+static struct pd_timer_stats PD_PORT_DATA(timer_stats)[PD_TIMER_COUNT];
+static uint8_t PD_PORT_DATA(timer_active_max);
+#endif
 
-test_mockable_static ATOMIC_DEFINE(timer_active, PD_TIMER_COUNT *MAX_PD_PORTS);
-test_mockable_static ATOMIC_DEFINE(timer_disabled,
-				   PD_TIMER_COUNT *MAX_PD_PORTS);
-static uint64_t timer_expires[MAX_PD_PORTS][PD_TIMER_COUNT];
+#ifdef CONFIG_PD_TIMER_DEADLINE_CHECK
+#ifndef CONFIG_PD_TIMER_DEADLINE_PERCENT
+#define CONFIG_PD_TIMER_DEADLINE_PERCENT 50
+#endif
 
 /*
- * CONFIG_CMD_PD_TIMER debug variables
+ * Allowed spread of each timer, per USB PD spec windows (max - min), in us.
+ * Timers without entry are not checked. Timers with only a minimum in
+ * spec use 10% of nominal value. tReceive is not listed, since retries
+ * are done by TCPC hardware, not by the timers.
  */
-static int count[MAX_PD_PORTS];
-static int max_count[MAX_PD_PORTS];
+static const uint32_t pd_timer_tolerance_us[PD_TIMER_COUNT] = {
+	PD_TIMER_IF(PD_TIMER_USE_BIST,
+		    [PE_TIMER_BIST_CONT_MODE] = 30000,) /* 30-60ms */
+	[PE_TIMER_CHUNKING_NOT_SUPPORTED] = 10000, /* 40-50ms */
+	[PE_TIMER_DISCOVER_IDENTITY] = 10000, /* 40-50ms */
+	PD_TIMER_IF(PD_TIMER_USE_SWAP,
+		    /* 390-480ms on, 750-920ms off */
+		    [PE_TIMER_PS_SOURCE] = 90000,)
+	[PE_TIMER_PS_TRANSITION] = 100000, /* 450-550ms */
+	[PE_TIMER_SENDER_RESPONSE] = 6000, /* 24-30ms, 26-32ms for Rev3.0 */
+	[PE_TIMER_SINK_EPR_ENTER] = 100000, /* 450-550ms */
+	[PE_TIMER_SINK_EPR_KEEP_ALIVE] = 250000, /* 250-500ms */
+	[PE_TIMER_SINK_REQUEST] = 10000, /* min 100ms */
+	[PR_TIMER_HARD_RESET_COMPLETE] = 1000, /* 4-5ms */
+	[PR_TIMER_SINK_TX] = 4000, /* 16-20ms */
+	PD_TIMER_IF(PD_TIMER_USE_CHUNKING,
+		    [PR_TIMER_CHUNK_SENDER_REQUEST] = 6000, /* 24-30ms */
+		    [PR_TIMER_CHUNK_SENDER_RESPONSE] = 6000,)
+	[TC_TIMER_CC_DEBOUNCE] = 100000, /* 100-200ms */
+	[TC_TIMER_PD_DEBOUNCE] = 10000, /* 10-20ms */
+};
+
+static struct pd_timer_deadline PD_PORT_DATA(timer_deadline)[PD_TIMER_COUNT];
+/*
+ * Expired by pd_timer_manage_expired(), but not seen by any check yet.
+ * Lateness is measured when the state machine notices expiration, timers
+ * which are never polled are not checked at all.
+ */
+static uint64_t PD_PORT_DATA(timer_unchecked);
+#endif
+
+#define PD_TIMER_NAME_ENTRY(grp, name, en) \
+	PD_TIMER_IF(en, [grp##_TIMER_##name] = #grp "-" #name,)
 
 __maybe_unused static __const_data const char *const pd_timer_names[] = {
-	[DPM_TIMER_PD_BUTTON_LONG_PRESS] = "DPM-PD_BUTTON_LONG_PRESS",
-	[DPM_TIMER_PD_BUTTON_SHORT_PRESS] = "DPM-PD_BUTTON_SHORT_PRESS",
-	[PE_TIMER_BIST_CONT_MODE] = "PE-BIST_CONT_MODE",
-	[PE_TIMER_CHUNKING_NOT_SUPPORTED] = "PE-CHUNKING_NOT_SUPPORTED",
-	[PE_TIMER_DISCOVER_IDENTITY] = "PE-DISCOVER_IDENTITY",
-	[PE_TIMER_NO_RESPONSE] = "PE-NO_RESPONSE",
-	[PE_TIMER_PR_SWAP_WAIT] = "PE-PR_SWAP_WAIT",
-	[PE_TIMER_PS_HARD_RESET] = "PE-PS_HARD_RESET",
-	[PE_TIMER_PS_SOURCE] = "PE-PS_SOURCE",
-	[PE_TIMER_PS_TRANSITION] = "PE-PS_TRANSITION",
-	[PE_TIMER_SENDER_RESPONSE] = "PE-SENDER_RESPONSE",
-	[PE_TIMER_SINK_REQUEST] = "PE-SINK_REQUEST",
-	[PE_TIMER_SOURCE_CAP] = "PE-SOURCE_CAP",
-	[PE_TIMER_SRC_TRANSITION] = "PE-SRC_TRANSITION",
-	[PE_TIMER_SWAP_SOURCE_START] = "PE-SWAP_SOURCE_START",
-	[PE_TIMER_TIMEOUT] = "PE-TIMEOUT",
-	[PE_TIMER_VCONN_ON] = "PE-VCONN_ON",
-	[PE_TIMER_VDM_RESPONSE] = "PE-VDM_RESPONSE",
-	[PE_TIMER_WAIT_AND_ADD_JITTER] = "PE-WAIT_AND_ADD_JITTER",
-	[PE_TIMER_VCONN_DISCHARGE] = "PE-VCONN_DISCHARGE",
-	[PE_TIMER_VCONN_REAPPLIED] = "PE-VCONN_REAPPLIED",
-	[PE_TIMER_DATA_RESET_FAIL] = "PE-DATA_RESET_FAIL",
-
-	[PR_TIMER_CHUNK_SENDER_REQUEST] = "PR-CHUNK_SENDER_REQUEST",
-	[PR_TIMER_CHUNK_SENDER_RESPONSE] = "PR-CHUNK_SENDER_RESPONSE",
-	[PR_TIMER_HARD_RESET_COMPLETE] = "PR-HARD_RESET_COMPLETE",
-	[PR_TIMER_SINK_TX] = "PR-SINK_TX",
-	[PR_TIMER_TCPC_TX_TIMEOUT] = "PR-TCPC_TX_TIMEOUT",
-	[TC_TIMER_CC_DEBOUNCE] = "TC-CC_DEBOUNCE",
-	[TC_TIMER_LOW_POWER_EXIT_TIME] = "TC-LOW_POWER_EXIT_TIME",
-	[TC_TIMER_LOW_POWER_TIME] = "TC-LOW_POWER_TIME",
-	[TC_TIMER_NEXT_ROLE_SWAP] = "TC-NEXT_ROLE_SWAP",
-	[TC_TIMER_PD_DEBOUNCE] = "TC-PD_DEBOUNCE",
-	[TC_TIMER_TIMEOUT] = "TC-TIMEOUT",
-	[TC_TIMER_TRY_WAIT_DEBOUNCE] = "TC-TRY_WAIT_DEBOUNCE",
-	[TC_TIMER_VBUS_DEBOUNCE] = "TC-VBUS_DEBOUNCE",
+	PD_TIMER_LIST(PD_TIMER_NAME_ENTRY)
+};
+
+/* Timers of each group, only those present in build */
+#define PD_TIMER_MASK_ENTRY(grp, name, en) \
+	PD_TIMER_IF(en, | PD_TIMER_BIT(grp##_TIMER_##name))
+
+static const uint64_t pd_timer_range_mask[] = {
+	[DPM_TIMER_RANGE] = 0 PD_DPM_TIMER_LIST(PD_TIMER_MASK_ENTRY),
+	[PE_TIMER_RANGE] = 0 PD_PE_TIMER_LIST(PD_TIMER_MASK_ENTRY),
+	[PR_TIMER_RANGE] = 0 PD_PR_TIMER_LIST(PD_TIMER_MASK_ENTRY),
+	[TC_TIMER_RANGE] = 0 PD_TC_TIMER_LIST(PD_TIMER_MASK_ENTRY),
 };
 
+/* Current time, as seen by timer checks */
+static pd_time_t pd_timer_now(int port)
+{
+#ifdef CONFIG_PD_TIMER_TIME_SNAPSHOT
+	if (time_snapshot_valid[port])
+		return time_snapshot[port];
+#endif
+	return PD_TIME_READ();
+}
+
+/*****************************************************************************
+ * PD_TIMER heap functions
+ */
+
+static pd_time_t heap_expires(int port, int idx)
+{
+	return timer_expires[port][timer_heap[port][idx]];
+}
+
+static void heap_set(int port, int idx, uint8_t timer)
+{
+	timer_heap[port][idx] = timer;
+	timer_heap_pos[port][timer] = idx + 1;
+}
+
+static void heap_sift_up(int port, int idx)
+{
+	uint8_t timer = timer_heap[port][idx];
+	pd_time_t expires = timer_expires[port][timer];
+
+	while (idx > 0) {
+		int parent = (idx - 1) / 2;
+
+		if (!PD_TIME_BEFORE(expires, heap_expires(port, parent)))
+			break;
+		heap_set(port, idx, timer_heap[port][parent]);
+		idx = parent;
+	}
+	heap_set(port, idx, timer);
+}
+
+static void heap_sift_down(int port, int idx)
+{
+	int size = timer_heap_size[port];
+	uint8_t timer = timer_heap[port][idx];
+	pd_time_t expires = timer_expires[port][timer];
+
+	for (;;) {
+		int child = idx * 2 + 1;
+
+		if (child >= size)
+			break;
+		if (child + 1 < size &&
+		    PD_TIME_BEFORE(heap_expires(port, child + 1),
+				   heap_expires(port, child)))
+			child++;
+		if (!PD_TIME_BEFORE(heap_expires(port, child), expires))
+			break;
+		heap_set(port, idx, timer_heap[port][child]);
+		idx = child;
+	}
+	heap_set(port, idx, timer);
+}
+
+/* Insert timer, or restore heap order after its expiration has changed */
+static void heap_update(int port, enum pd_task_timer timer)
+{
+	int idx = timer_heap_pos[port][timer] - 1;
+
+	if (idx < 0) {
+		idx = timer_heap_size[port]++;
+		heap_set(port, idx, timer);
+	}
+	heap_sift_up(port, idx);
+	heap_sift_down(port, timer_heap_pos[port][timer] - 1);
+}
+
+static void heap_remove(int port, enum pd_task_timer timer)
+{
+	int idx = timer_heap_pos[port][timer] - 1;
+	int last;
+
+	if (idx < 0)
+		return;
+
+	timer_heap_pos[port][timer] = 0;
+	last = --timer_heap_size[port];
+	if (idx == last)
+		return;
+
+	heap_set(port, idx, timer_heap[port][last]);
+	heap_sift_up(port, idx);
+	heap_sift_down(port, timer_heap_pos[port][timer_heap[port][idx]] - 1);
+}
+
+/*****************************************************************************
+ * PD_TIMER statistics functions. No-op unless CONFIG_PD_TIMER_STATS is set.
+ */
+
+static void stats_enabled(int port, enum pd_task_timer timer)
+{
+#ifdef CONFIG_PD_TIMER_STATS
+	uint8_t active = __builtin_popcountll(timer_active[port]);
+
+	timer_stats[port][timer].enabled++;
+	if (active > timer_active_max[port])
+		timer_active_max[port] = active;
+#endif
+}
+
+static void stats_cancelled(int port, enum pd_task_timer timer)
+{
+#ifdef CONFIG_PD_TIMER_STATS
+	timer_stats[port][timer].cancelled++;
+#endif
+}
+
+/* Called with the time the expiration was noticed */
+static void stats_expired(int port, enum pd_task_timer timer, pd_time_t now)
+{
+#ifdef CONFIG_PD_TIMER_STATS
+	uint64_t late = PD_TIME_TO_US((pd_time_t)(now - timer_expires[port][timer]));
+	int bucket = late ? 64 - __builtin_clzll(late) : 0;
+
+	if (bucket >= PD_TIMER_LATENESS_BUCKETS)
+		bucket = PD_TIMER_LATENESS_BUCKETS - 1;
+
+	timer_stats[port][timer].expired++;
+	timer_stats[port][timer].lateness[bucket]++;
+#endif
+}
+
+/*
+ * Compare expiration lateness with the allowed fraction of the spec
+ * tolerance. Called from pd_timer_is_expired() only, timer-driven PE/PRL
+ * actions run right after it, so this is the lateness of the action itself.
+ */
+static void deadline_check(int port, enum pd_task_timer timer, pd_time_t now)
+{
+#ifdef CONFIG_PD_TIMER_DEADLINE_CHECK
+	struct pd_timer_deadline *dl = &timer_deadline[port][timer];
+	uint32_t tolerance = pd_timer_tolerance_us[timer];
+	uint64_t late;
+
+	timer_unchecked[port] &= ~PD_TIMER_BIT(timer);
+	if (!tolerance)
+		return;
+
+	late = PD_TIME_TO_US((pd_time_t)(now - timer_expires[port][timer]));
+	if (late > UINT32_MAX)
+		late = UINT32_MAX;
+
+	dl->checked++;
+	if (late > dl->worst_late_us)
+		dl->worst_late_us = late;
+
+	if (late * 100 > (uint64_t)tolerance * CONFIG_PD_TIMER_DEADLINE_PERCENT) {
+		dl->missed++;
+		dl->last_due = PD_TIME_TO_US(timer_expires[port][timer]);
+		dl->last_ran = PD_TIME_TO_US(now);
+	}
+#endif
+}
+
+/* Expired in background, check it when pd_timer_is_expired() sees it */
+static void deadline_defer(int port, enum pd_task_timer timer)
+{
+#ifdef CONFIG_PD_TIMER_DEADLINE_CHECK
+	timer_unchecked[port] |= PD_TIMER_BIT(timer);
+#endif
+}
+
+static bool deadline_deferred(int port, enum pd_task_timer timer)
+{
+#ifdef CONFIG_PD_TIMER_DEADLINE_CHECK
+	return !!(timer_unchecked[port] & PD_TIMER_BIT(timer));
+#else
+	return false;
+#endif
+}
+
+/* Restarted or disabled, expiration is not going to be seen */
+static void deadline_drop(int port, uint64_t mask)
+{
+#ifdef CONFIG_PD_TIMER_DEADLINE_CHECK
+	timer_unchecked[port] &= ~mask;
+#endif
+}
+
 /*****************************************************************************
  * PD_TIMER private functions
  *
@@ -94,9 +367,7 @@ static void pd_timer_inactive(int port, enum pd_task_timer timer)
 {
 	if (PD_CHK_ACTIVE(port, timer)) {
 		PD_CLR_ACTIVE(port, timer);
-
-		if (0/*IS_ENABLED(CONFIG_CMD_PD_TIMER)*/)
-			count[port]--;
+		heap_remove(port, timer);
 	}
 	PD_CLR_DISABLED(port, timer);
 }
@@ -114,74 +385,88 @@ static bool pd_timer_is_inactive(int port, enum pd_task_timer timer)
 /*****************************************************************************
  * PD_TIMER public functions
  */
-void pd_timer_init(int port)
+#ifdef CONFIG_PD_PORT_ARENA
+void pd_timer_port_arena_init(int count)
 {
-	if (0/*IS_ENABLED(CONFIG_CMD_PD_TIMER)*/)
-		count[port] = 0;
+	PD_PORT_DATA_TAKE(timer_active, count);
+	PD_PORT_DATA_TAKE(timer_disabled, count);
+	PD_PORT_DATA_TAKE(timer_expires, count);
+#ifdef CONFIG_PD_TIMER_TIME_SNAPSHOT
+	PD_PORT_DATA_TAKE(time_snapshot, count);
+	PD_PORT_DATA_TAKE(time_snapshot_valid, count);
+#endif
+	PD_PORT_DATA_TAKE(timer_heap, count);
+	PD_PORT_DATA_TAKE(timer_heap_pos, count);
+	PD_PORT_DATA_TAKE(timer_heap_size, count);
+#ifdef CONFIG_PD_TIMER_STATS
+	PD_PORT_DATA_TAKE(timer_stats, count);
+	PD_PORT_DATA_TAKE(timer_active_max, count);
+#endif
+#ifdef CONFIG_PD_TIMER_DEADLINE_CHECK
+	PD_PORT_DATA_TAKE(timer_deadline, count);
+	PD_PORT_DATA_TAKE(timer_unchecked, count);
+#endif
+}
+#endif
 
+void pd_timer_init(int port)
+{
 	/*
 	 * Set timers to init state for "port".
 	 */
-	for (int bit = 0; bit < PD_TIMER_COUNT; bit++) {
-		PD_CLR_ACTIVE(port, bit);
-		PD_SET_DISABLED(port, bit);
-	}
+	timer_active[port] = 0;
+	timer_disabled[port] = PD_TIMERS_ALL_MASK;
+
+	for (int bit = 0; bit < PD_TIMER_COUNT; bit++)
+		timer_heap_pos[port][bit] = 0;
+	timer_heap_size[port] = 0;
+	deadline_drop(port, PD_TIMERS_ALL_MASK);
 }
 
 void pd_timer_enable(int port, enum pd_task_timer timer, uint32_t expires_us)
 {
-	if (!PD_CHK_ACTIVE(port, timer)) {
-		PD_SET_ACTIVE(port, timer);
-
-		if (0/*IS_ENABLED(CONFIG_CMD_PD_TIMER)*/) {
-			count[port]++;
-			if (count[port] > max_count[port])
-				max_count[port] = count[port];
-		}
-	}
+	PD_SET_ACTIVE(port, timer);
 	PD_CLR_DISABLED(port, timer);
-	timer_expires[port][timer] = get_time().val + expires_us;
+	timer_expires[port][timer] =
+		pd_timer_now(port) + PD_TIME_FROM_US(expires_us);
+	heap_update(port, timer);
+	stats_enabled(port, timer);
+	deadline_drop(port, PD_TIMER_BIT(timer));
 }
 
 void pd_timer_disable(int port, enum pd_task_timer timer)
 {
 	if (PD_CHK_ACTIVE(port, timer)) {
 		PD_CLR_ACTIVE(port, timer);
-
-		if (0/*IS_ENABLED(CONFIG_CMD_PD_TIMER)*/)
-			count[port]--;
+		heap_remove(port, timer);
+		stats_cancelled(port, timer);
 	}
 	PD_SET_DISABLED(port, timer);
+	deadline_drop(port, PD_TIMER_BIT(timer));
 }
 
 void pd_timer_disable_range(int port, enum pd_timer_range range)
 {
-	int start, end;
-	enum pd_task_timer timer;
-
-	switch (range) {
-	case DPM_TIMER_RANGE:
-		start = DPM_TIMER_START;
-		end = DPM_TIMER_END;
-		break;
-	case PE_TIMER_RANGE:
-		start = PE_TIMER_START;
-		end = PE_TIMER_END;
-		break;
-	case PR_TIMER_RANGE:
-		start = PR_TIMER_START;
-		end = PR_TIMER_END;
-		break;
-	case TC_TIMER_RANGE:
-		start = TC_TIMER_START;
-		end = TC_TIMER_END;
-		break;
-	default:
+	uint64_t mask, active;
+
+	if (range < DPM_TIMER_RANGE || range > TC_TIMER_RANGE)
 		return;
+
+	mask = pd_timer_range_mask[range];
+
+	/* Only timers that were active have heap entries to drop */
+	active = timer_active[port] & mask;
+	while (active) {
+		enum pd_task_timer timer = __builtin_ctzll(active);
+
+		active &= active - 1;
+		heap_remove(port, timer);
+		stats_cancelled(port, timer);
 	}
 
-	for (timer = start; timer <= end; ++timer)
-		pd_timer_disable(port, timer);
+	timer_active[port] &= ~mask;
+	timer_disabled[port] |= mask;
+	deadline_drop(port, mask);
 }
 
 bool pd_timer_is_disabled(int port, enum pd_task_timer timer)
@@ -191,52 +476,167 @@ bool pd_timer_is_disabled(int port, enum pd_task_timer timer)
 
 bool pd_timer_is_expired(int port, enum pd_task_timer timer)
 {
+	pd_bench_timer_check(port);
+
 	if (pd_timer_is_active(port, timer)) {
-		if (get_time().val >= timer_expires[port][timer]) {
+		pd_time_t now = pd_timer_now(port);
+
+		if (!PD_TIME_BEFORE(now, timer_expires[port][timer])) {
+			stats_expired(port, timer, now);
+			deadline_check(port, timer, now);
 			pd_timer_inactive(port, timer);
 			return true;
 		}
 		return false;
 	}
+	if (deadline_deferred(port, timer))
+		deadline_check(port, timer, pd_timer_now(port));
 	return pd_timer_is_inactive(port, timer);
 }
 
 void pd_timer_manage_expired(int port)
 {
-	int timer;
+	pd_time_t now;
 
-	for (timer = 0; timer < PD_TIMER_COUNT; ++timer)
-		if (pd_timer_is_active(port, timer) &&
-		    pd_timer_is_expired(port, timer))
-			pd_timer_inactive(port, timer);
+	pd_bench_timer_check(port);
+
+	if (!timer_active[port])
+		return;
+
+	now = pd_timer_now(port);
+
+	/* Expired timers are always on top of the heap */
+	while (timer_heap_size[port] &&
+	       !PD_TIME_BEFORE(now, heap_expires(port, 0))) {
+		enum pd_task_timer timer = timer_heap[port][0];
+
+		stats_expired(port, timer, now);
+		deadline_defer(port, timer);
+		pd_timer_inactive(port, timer);
+	}
 }
 
 int pd_timer_next_expiration(int port)
 {
-	int timer;
-	int ret_value = MAX_EXPIRE;
-	uint64_t now = get_time().val;
+	pd_time_t now = pd_timer_now(port);
+	pd_time_t t_value;
+	uint64_t delta;
+
+	/* Only active timers are in the heap */
+	if (!timer_heap_size[port])
+		return NO_TIMEOUT;
+
+	t_value = heap_expires(port, 0);
+	if (!PD_TIME_BEFORE(now, t_value))
+		return EXPIRE_NOW;
+
+	delta = PD_TIME_TO_US((pd_time_t)(t_value - now));
+	if (delta > MAX_EXPIRE)
+		return MAX_EXPIRE;
+
+	return delta;
+}
+
+void pd_timer_snapshot_begin(int port)
+{
+#ifdef CONFIG_PD_TIMER_TIME_SNAPSHOT
+	time_snapshot[port] = PD_TIME_READ();
+	time_snapshot_valid[port] = true;
+#endif
+}
+
+void pd_timer_snapshot_end(int port)
+{
+#ifdef CONFIG_PD_TIMER_TIME_SNAPSHOT
+	time_snapshot_valid[port] = false;
+#endif
+}
+
+#ifdef CONFIG_PD_TIMER_STATS
+const struct pd_timer_stats *pd_timer_stats_get(int port,
+						enum pd_task_timer timer)
+{
+	return &timer_stats[port][timer];
+}
+
+int pd_timer_stats_max_active(int port)
+{
+	return timer_active_max[port];
+}
+
+void pd_timer_stats_reset(int port)
+{
+	memset(timer_stats[port], 0, sizeof(timer_stats[port]));
+	timer_active_max[port] = 0;
+}
+
+void pd_timer_stats_dump(int port, int (*print)(const char *format, ...))
+{
+	print("C%d: max active timers %d\n", port, timer_active_max[port]);
+
+	for (int timer = 0; timer < PD_TIMER_COUNT; timer++) {
+		const struct pd_timer_stats *st = &timer_stats[port][timer];
 
-	for (timer = 0; timer < PD_TIMER_COUNT; ++timer) {
-		/* Only use active timers for the next expired value */
-		if (pd_timer_is_active(port, timer)) {
-			int delta;
-			uint64_t t_value = timer_expires[port][timer];
+		if (!st->enabled)
+			continue;
 
-			if (t_value <= now) {
-				ret_value = EXPIRE_NOW;
-				break;
-			}
+		print("C%d: %-28s en %lu exp %lu cancel %lu late:", port,
+		      pd_timer_names[timer], (unsigned long)st->enabled,
+		      (unsigned long)st->expired,
+		      (unsigned long)st->cancelled);
 
-			delta = t_value - now;
-			if (ret_value > delta)
-				ret_value = delta;
+		/* Bucket N holds lateness below 2^N us, the last one - above */
+		for (int i = 0; i < PD_TIMER_LATENESS_BUCKETS - 1; i++) {
+			if (st->lateness[i])
+				print(" <%luus:%lu", 1UL << i,
+				      (unsigned long)st->lateness[i]);
 		}
+		if (st->lateness[PD_TIMER_LATENESS_BUCKETS - 1])
+			print(" >=%luus:%lu",
+			      1UL << (PD_TIMER_LATENESS_BUCKETS - 2),
+			      (unsigned long)st->lateness[PD_TIMER_LATENESS_BUCKETS - 1]);
+		print("\n");
 	}
+}
+#endif
 
-	if (ret_value == MAX_EXPIRE)
-		ret_value = NO_TIMEOUT;
+#ifdef CONFIG_PD_TIMER_DEADLINE_CHECK
+const struct pd_timer_deadline *pd_timer_deadline_get(int port,
+						      enum pd_task_timer timer)
+{
+	return &timer_deadline[port][timer];
+}
 
-	return ret_value;
+uint32_t pd_timer_deadline_misses(int port)
+{
+	uint32_t total = 0;
+
+	for (int timer = 0; timer < PD_TIMER_COUNT; timer++)
+		total += timer_deadline[port][timer].missed;
+
+	return total;
 }
 
+void pd_timer_deadline_reset(int port)
+{
+	memset(timer_deadline[port], 0, sizeof(timer_deadline[port]));
+}
+
+void pd_timer_deadline_dump(int port, int (*print)(const char *format, ...))
+{
+	for (int timer = 0; timer < PD_TIMER_COUNT; timer++) {
+		const struct pd_timer_deadline *dl = &timer_deadline[port][timer];
+
+		if (!dl->checked)
+			continue;
+
+		print("C%d: %-28s checked %lu missed %lu worst %luus "
+		      "budget %luus\n",
+		      port, pd_timer_names[timer], (unsigned long)dl->checked,
+		      (unsigned long)dl->missed,
+		      (unsigned long)dl->worst_late_us,
+		      (unsigned long)(pd_timer_tolerance_us[timer] *
+				      CONFIG_PD_TIMER_DEADLINE_PERCENT / 100));
+	}
+}
+#endif
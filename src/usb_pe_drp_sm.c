@@ -17,6 +17,9 @@
 #include "dps.h"
 #include "driver/tcpm/tcpm.h"
 #include "host_command.h"
+#include "pd_bench.h"
+#include "pd_port_arena.h"
+#include "pd_snk_policy.h"
 #include "stdbool.h"
 #include "usb_charge.h"
 #include "usb_common.h"
@@ -61,11 +64,28 @@
 #define CPRINTS_L2(format, args...) CPRINTS_LX(2, format, ##args)
 #define CPRINTS_L3(format, args...) CPRINTS_LX(3, format, ##args)
 
+/*
+ * PE flags are read and written by the event loop only, so plain
+ * read-modify-write is enough in the single context build. DPM requests and
+ * events below are set from application context and always stay atomic.
+ */
+#ifdef CONFIG_USB_PD_SINGLE_CONTEXT_FLAGS
+#define FLAG_OR(flags, mask) (*(flags) |= (mask))
+#define FLAG_CLEAR_BITS(flags, mask) (*(flags) &= ~(mask))
+#else
+#define FLAG_OR(flags, mask) atomic_or(flags, (mask))
+#define FLAG_CLEAR_BITS(flags, mask) atomic_clear_bits(flags, (mask))
+#endif
+
+#if defined(CONFIG_USB_PD_SINGLE_CONTEXT_FLAGS) && defined(CONFIG_USB_PD_FRS)
+#error "pd_got_frs_signal() sets PE flags from interrupt context"
+#endif
+
 #define PE_SET_FN(port, _fn) \
-	atomic_or(ATOMIC_ELEM(pe[port].flags_a, (_fn)), ATOMIC_MASK(_fn))
-#define PE_CLR_FN(port, _fn)                                    \
-	atomic_clear_bits(ATOMIC_ELEM(pe[port].flags_a, (_fn)), \
-			  ATOMIC_MASK(_fn))
+	FLAG_OR(ATOMIC_ELEM(pe[port].flags_a, (_fn)), ATOMIC_MASK(_fn))
+#define PE_CLR_FN(port, _fn)                                  \
+	FLAG_CLEAR_BITS(ATOMIC_ELEM(pe[port].flags_a, (_fn)), \
+			ATOMIC_MASK(_fn))
 #define PE_CHK_FN(port, _fn) \
 	(pe[port].flags_a[ATOMIC_ELEM(0, (_fn))] & ATOMIC_MASK(_fn))
 
@@ -76,8 +96,8 @@
 /*
  * TODO(b/229655319): support more than 32 bits
  */
-#define PE_SET_MASK(port, mask) atomic_or(&pe[port].flags_a[0], (mask))
-#define PE_CLR_MASK(port, mask) atomic_clear_bits(&pe[port].flags_a[0], (mask))
+#define PE_SET_MASK(port, mask) FLAG_OR(&pe[port].flags_a[0], (mask))
+#define PE_CLR_MASK(port, mask) FLAG_CLEAR_BITS(&pe[port].flags_a[0], (mask))
 
 /*
  * These macros SET, CLEAR, and CHECK, a DPM (Device Policy Manager)
@@ -188,92 +208,33 @@ typedef int (*svdm_rsp_func)(int port, uint32_t *payload);
 
 /* List of all Policy Engine level states */
 enum usb_pe_state {
-	/* Super States */
-	PE_PRS_FRS_SHARED, /* pe-st0 */
-	PE_VDM_SEND_REQUEST, /* pe-st1 */
-
-	/* Normal States */
-	PE_SRC_STARTUP, /* pe-st2 */
-	PE_SRC_DISCOVERY, /* pe-st3 */
-	PE_SRC_SEND_CAPABILITIES, /* pe-st4 */
-	PE_SRC_NEGOTIATE_CAPABILITY, /* pe-st5 */
-	PE_SRC_TRANSITION_SUPPLY, /* pe-st6 */
-	PE_SRC_READY, /* pe-st7 */
-	PE_SRC_DISABLED, /* pe-st8 */
-	PE_SRC_CAPABILITY_RESPONSE, /* pe-st9 */
-	PE_SRC_HARD_RESET, /* pe-st10 */
-	PE_SRC_HARD_RESET_RECEIVED, /* pe-st11 */
-	PE_SRC_TRANSITION_TO_DEFAULT, /* pe-st12 */
-	PE_SNK_STARTUP, /* pe-st13 */
-	PE_SNK_DISCOVERY, /* pe-st14 */
-	PE_SNK_WAIT_FOR_CAPABILITIES, /* pe-st15 */
-	PE_SNK_EVALUATE_CAPABILITY, /* pe-st16 */
-	PE_SNK_SELECT_CAPABILITY, /* pe-st17 */
-	PE_SNK_READY, /* pe-st18 */
-	PE_SNK_HARD_RESET, /* pe-st19 */
-	PE_SNK_TRANSITION_TO_DEFAULT, /* pe-st20 */
-	PE_SNK_GIVE_SINK_CAP, /* pe-st21 */
-	PE_SNK_GET_SOURCE_CAP, /* pe-st22 */
-	PE_SNK_TRANSITION_SINK, /* pe-st23 */
-	PE_SEND_SOFT_RESET, /* pe-st24 */
-	PE_SOFT_RESET, /* pe-st25 */
-	PE_SEND_NOT_SUPPORTED, /* pe-st26 */
-	PE_SRC_PING, /* pe-st27 */
-	PE_DRS_EVALUATE_SWAP, /* pe-st28 */
-	PE_DRS_CHANGE, /* pe-st29 */
-	PE_DRS_SEND_SWAP, /* pe-st30 */
-	PE_PRS_SRC_SNK_EVALUATE_SWAP, /* pe-st31 */
-	PE_PRS_SRC_SNK_TRANSITION_TO_OFF, /* pe-st32 */
-	PE_PRS_SRC_SNK_ASSERT_RD, /* pe-st33 */
-	PE_PRS_SRC_SNK_WAIT_SOURCE_ON, /* pe-st34 */
-	PE_PRS_SRC_SNK_SEND_SWAP, /* pe-st35 */
-	PE_PRS_SNK_SRC_EVALUATE_SWAP, /* pe-st36 */
-	PE_PRS_SNK_SRC_TRANSITION_TO_OFF, /* pe-st37 */
-	PE_PRS_SNK_SRC_ASSERT_RP, /* pe-st38 */
-	PE_PRS_SNK_SRC_SOURCE_ON, /* pe-st39 */
-	PE_PRS_SNK_SRC_SEND_SWAP, /* pe-st40 */
-	PE_VCS_EVALUATE_SWAP, /* pe-st41 */
-	PE_VCS_SEND_SWAP, /* pe-st42 */
-	PE_VCS_WAIT_FOR_VCONN_SWAP, /* pe-st43 */
-	PE_VCS_TURN_ON_VCONN_SWAP, /* pe-st44 */
-	PE_VCS_TURN_OFF_VCONN_SWAP, /* pe-st45 */
-	PE_VCS_SEND_PS_RDY_SWAP, /* pe-st46 */
-	PE_VCS_CBL_SEND_SOFT_RESET, /* pe-st47 */
-	PE_VDM_IDENTITY_REQUEST_CBL, /* pe-st48 */
-	PE_INIT_PORT_VDM_IDENTITY_REQUEST, /* pe-st49 */
-	PE_INIT_VDM_SVIDS_REQUEST, /* pe-st50 */
-	PE_INIT_VDM_MODES_REQUEST, /* pe-st51 */
-	PE_VDM_REQUEST_DPM, /* pe-st52 */
-	PE_VDM_RESPONSE, /* pe-st53 */
-	PE_WAIT_FOR_ERROR_RECOVERY, /* pe-st54 */
-	PE_BIST_TX, /* pe-st55 */
-	PE_DEU_SEND_ENTER_USB, /* pe-st56 */
-	PE_DR_GET_SINK_CAP, /* pe-st57 */
-	PE_DR_SNK_GIVE_SOURCE_CAP, /* pe-st58 */
-	PE_DR_SRC_GET_SOURCE_CAP, /* pe-st59 */
-
-	/* PD3.0 only states below here*/
-	/* UFP Data Reset States */
-	PE_UDR_SEND_DATA_RESET, /* pe-st60 */
-	PE_UDR_DATA_RESET_RECEIVED, /* pe-st61 */
-	PE_UDR_TURN_OFF_VCONN, /* pe-st62 */
-	PE_UDR_SEND_PS_RDY, /* pe-st63 */
-	PE_UDR_WAIT_FOR_DATA_RESET_COMPLETE, /* pe-st64 */
-	/* DFP Data Reset States */
-	PE_DDR_SEND_DATA_RESET, /* pe-st65 */
-	PE_DDR_DATA_RESET_RECEIVED, /* pe-st66 */
-	PE_DDR_WAIT_FOR_VCONN_OFF, /* pe-st67 */
-	PE_DDR_PERFORM_DATA_RESET, /* pe-st68 */
-	PE_FRS_SNK_SRC_START_AMS, /* pe-st69 */
-	PE_GIVE_BATTERY_CAP, /* pe-st70 */
-	PE_GIVE_BATTERY_STATUS, /* pe-st71 */
-	PE_GIVE_STATUS, /* pe-st72 */
-	PE_SEND_ALERT, /* pe-st73 */
-	PE_ALERT_RECEIVED, /* pe-st74 */
-	PE_SRC_CHUNK_RECEIVED, /* pe-st75 */
-	PE_SNK_CHUNK_RECEIVED, /* pe-st76 */
-	PE_VCS_FORCE_VCONN, /* pe-st77 */
-	PE_GET_REVISION, /* pe-st78 */
+	/*
+	 * Order matters: pe_states[] is sized by the last implemented
+	 * state, so states of the sink-only build go first, then the ones
+	 * CONFIG_PD_SINK_ONLY drops, then states not ported at all.
+	 */
+
+	/* Sink states */
+	PE_SNK_STARTUP,
+	PE_SNK_DISCOVERY,
+	PE_SNK_WAIT_FOR_CAPABILITIES,
+	PE_SNK_EVALUATE_CAPABILITY,
+	PE_SNK_SELECT_CAPABILITY,
+	PE_SNK_READY,
+	PE_SNK_HARD_RESET,
+	PE_SNK_TRANSITION_TO_DEFAULT,
+	PE_SNK_GIVE_SINK_CAP,
+	PE_SNK_GET_SOURCE_CAP,
+	PE_SNK_TRANSITION_SINK,
+	PE_SEND_SOFT_RESET,
+	PE_SOFT_RESET,
+	PE_SEND_NOT_SUPPORTED,
+	PE_WAIT_FOR_ERROR_RECOVERY,
+	PE_GET_REVISION,
+	PE_SNK_GET_PPS_STATUS,
+	PE_SNK_GET_SOURCE_CAP_EXT,
+	PE_GET_STATUS,
+	PE_SNK_CHUNK_RECEIVED,
 
 	/* EPR states */
 	PE_SNK_SEND_EPR_MODE_ENTRY,
@@ -281,6 +242,73 @@ enum usb_pe_state {
 	PE_SNK_EPR_KEEP_ALIVE,
 	PE_SNK_SEND_EPR_MODE_EXIT,
 	PE_SNK_EPR_MODE_EXIT_RECEIVED,
+
+	/* Swaps, BIST, Enter_USB, not in sink-only build */
+	PE_PRS_FRS_SHARED,
+	PE_SRC_PING,
+	PE_DRS_EVALUATE_SWAP,
+	PE_DRS_CHANGE,
+	PE_DRS_SEND_SWAP,
+	PE_PRS_SRC_SNK_EVALUATE_SWAP,
+	PE_PRS_SRC_SNK_TRANSITION_TO_OFF,
+	PE_PRS_SRC_SNK_ASSERT_RD,
+	PE_PRS_SRC_SNK_WAIT_SOURCE_ON,
+	PE_PRS_SRC_SNK_SEND_SWAP,
+	PE_PRS_SNK_SRC_EVALUATE_SWAP,
+	PE_PRS_SNK_SRC_TRANSITION_TO_OFF,
+	PE_PRS_SNK_SRC_ASSERT_RP,
+	PE_PRS_SNK_SRC_SOURCE_ON,
+	PE_PRS_SNK_SRC_SEND_SWAP,
+	PE_FRS_SNK_SRC_START_AMS,
+	PE_BIST_TX,
+	PE_DEU_SEND_ENTER_USB,
+	PE_DR_GET_SINK_CAP,
+	PE_DR_SNK_GIVE_SOURCE_CAP,
+	PE_DR_SRC_GET_SOURCE_CAP,
+	PE_SRC_CHUNK_RECEIVED,
+
+	/* Not ported, no entry in pe_states[], see set_state_pe() */
+	PE_NOT_PORTED_FIRST,
+	PE_VDM_SEND_REQUEST = PE_NOT_PORTED_FIRST,
+	PE_SRC_STARTUP,
+	PE_SRC_DISCOVERY,
+	PE_SRC_SEND_CAPABILITIES,
+	PE_SRC_NEGOTIATE_CAPABILITY,
+	PE_SRC_TRANSITION_SUPPLY,
+	PE_SRC_READY,
+	PE_SRC_DISABLED,
+	PE_SRC_CAPABILITY_RESPONSE,
+	PE_SRC_HARD_RESET,
+	PE_SRC_HARD_RESET_RECEIVED,
+	PE_SRC_TRANSITION_TO_DEFAULT,
+	PE_VCS_EVALUATE_SWAP,
+	PE_VCS_SEND_SWAP,
+	PE_VCS_WAIT_FOR_VCONN_SWAP,
+	PE_VCS_TURN_ON_VCONN_SWAP,
+	PE_VCS_TURN_OFF_VCONN_SWAP,
+	PE_VCS_SEND_PS_RDY_SWAP,
+	PE_VCS_CBL_SEND_SOFT_RESET,
+	PE_VDM_IDENTITY_REQUEST_CBL,
+	PE_INIT_PORT_VDM_IDENTITY_REQUEST,
+	PE_INIT_VDM_SVIDS_REQUEST,
+	PE_INIT_VDM_MODES_REQUEST,
+	PE_VDM_REQUEST_DPM,
+	PE_VDM_RESPONSE,
+	PE_UDR_SEND_DATA_RESET,
+	PE_UDR_DATA_RESET_RECEIVED,
+	PE_UDR_TURN_OFF_VCONN,
+	PE_UDR_SEND_PS_RDY,
+	PE_UDR_WAIT_FOR_DATA_RESET_COMPLETE,
+	PE_DDR_SEND_DATA_RESET,
+	PE_DDR_DATA_RESET_RECEIVED,
+	PE_DDR_WAIT_FOR_VCONN_OFF,
+	PE_DDR_PERFORM_DATA_RESET,
+	PE_GIVE_BATTERY_CAP,
+	PE_GIVE_BATTERY_STATUS,
+	PE_GIVE_STATUS,
+	PE_SEND_ALERT,
+	PE_ALERT_RECEIVED,
+	PE_VCS_FORCE_VCONN,
 };
 
 /*
@@ -322,8 +350,6 @@ static const struct usb_state pe_states[];
 
 /* List of human readable state names for console debugging */
 __maybe_unused static __const_data const char *const pe_state_names[] = {
-/* Super States */
-	[PE_PRS_FRS_SHARED] = "SS:PE_PRS_FRS_SHARED",
 	[PE_SNK_STARTUP] = "PE_SNK_Startup",
 	[PE_SNK_DISCOVERY] = "PE_SNK_Discovery",
 	[PE_SNK_WAIT_FOR_CAPABILITIES] = "PE_SNK_Wait_for_Capabilities",
@@ -338,6 +364,20 @@ __maybe_unused static __const_data const char *const pe_state_names[] = {
 	[PE_SEND_SOFT_RESET] = "PE_Send_Soft_Reset",
 	[PE_SOFT_RESET] = "PE_Soft_Reset",
 	[PE_SEND_NOT_SUPPORTED] = "PE_Send_Not_Supported",
+	[PE_WAIT_FOR_ERROR_RECOVERY] = "PE_Wait_For_Error_Recovery",
+	[PE_GET_REVISION] = "PE_Get_Revision",
+	[PE_SNK_GET_PPS_STATUS] = "PE_SNK_Get_PPS_Status",
+	[PE_SNK_GET_SOURCE_CAP_EXT] = "PE_SNK_Get_Source_Cap_Ext",
+	[PE_GET_STATUS] = "PE_Get_Status",
+	[PE_SNK_CHUNK_RECEIVED] = "PE_SNK_Chunk_Received",
+	[PE_SNK_SEND_EPR_MODE_ENTRY] = "PE_SNK_Send_EPR_Mode_Entry",
+	[PE_SNK_EPR_MODE_ENTRY_WAIT_FOR_RESPONSE] =
+		"PE_SNK_EPR_Mode_Entry_Wait_For_Response",
+	[PE_SNK_EPR_KEEP_ALIVE] = "PE_SNK_EPR_Keep_Alive",
+	[PE_SNK_SEND_EPR_MODE_EXIT] = "PE_SNK_Send_EPR_Mode_Exit",
+	[PE_SNK_EPR_MODE_EXIT_RECEIVED] = "PE_SNK_EPR_Mode_Exit_Received",
+#ifndef CONFIG_PD_SINK_ONLY
+	[PE_PRS_FRS_SHARED] = "SS:PE_PRS_FRS_SHARED",
 	[PE_SRC_PING] = "PE_SRC_Ping",
 	[PE_DRS_EVALUATE_SWAP] = "PE_DRS_Evaluate_Swap",
 	[PE_DRS_CHANGE] = "PE_DRS_Change",
@@ -352,24 +392,14 @@ __maybe_unused static __const_data const char *const pe_state_names[] = {
 	[PE_PRS_SNK_SRC_ASSERT_RP] = "PE_PRS_SNK_SRC_Assert_Rp",
 	[PE_PRS_SNK_SRC_SOURCE_ON] = "PE_PRS_SNK_SRC_Source_On",
 	[PE_PRS_SNK_SRC_SEND_SWAP] = "PE_PRS_SNK_SRC_Send_Swap",
-	[PE_WAIT_FOR_ERROR_RECOVERY] = "PE_Wait_For_Error_Recovery",
+	[PE_FRS_SNK_SRC_START_AMS] = "PE_FRS_SNK_SRC_Start_Ams",
 	[PE_BIST_TX] = "PE_Bist_TX",
 	[PE_DEU_SEND_ENTER_USB] = "PE_DEU_Send_Enter_USB",
 	[PE_DR_GET_SINK_CAP] = "PE_DR_Get_Sink_Cap",
 	[PE_DR_SNK_GIVE_SOURCE_CAP] = "PE_DR_SNK_Give_Source_Cap",
 	[PE_DR_SRC_GET_SOURCE_CAP] = "PE_DR_SRC_Get_Source_Cap",
-
-/* PD3.0 only states below here*/
-	[PE_FRS_SNK_SRC_START_AMS] = "PE_FRS_SNK_SRC_Start_Ams",
-	[PE_GET_REVISION] = "PE_Get_Revision",
 	[PE_SRC_CHUNK_RECEIVED] = "PE_SRC_Chunk_Received",
-	[PE_SNK_CHUNK_RECEIVED] = "PE_SNK_Chunk_Received",
-	[PE_SNK_SEND_EPR_MODE_ENTRY] = "PE_SNK_Send_EPR_Mode_Entry",
-	[PE_SNK_EPR_MODE_ENTRY_WAIT_FOR_RESPONSE] =
-		"PE_SNK_EPR_Mode_Entry_Wait_For_Response",
-	[PE_SNK_EPR_KEEP_ALIVE] = "PE_SNK_EPR_Keep_Alive",
-	[PE_SNK_SEND_EPR_MODE_EXIT] = "PE_SNK_Send_EPR_Mode_Exit",
-	[PE_SNK_EPR_MODE_EXIT_RECEIVED] = "PE_SNK_EPR_Mode_Exit_Received",
+#endif /* CONFIG_PD_SINK_ONLY */
 };
 
 GEN_NOT_SUPPORTED(PE_VCS_EVALUATE_SWAP);
@@ -397,6 +427,10 @@ GEN_NOT_SUPPORTED(PE_GIVE_STATUS);
 #define PE_GIVE_STATUS PE_GIVE_STATUS_NOT_SUPPORTED
 GEN_NOT_SUPPORTED(PE_SEND_ALERT);
 #define PE_SEND_ALERT PE_SEND_ALERT_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_ALERT_RECEIVED);
+#define PE_ALERT_RECEIVED PE_ALERT_RECEIVED_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_VDM_RESPONSE);
+#define PE_VDM_RESPONSE PE_VDM_RESPONSE_NOT_SUPPORTED
 
 
 GEN_NOT_SUPPORTED(PE_UDR_SEND_DATA_RESET);
@@ -419,7 +453,57 @@ GEN_NOT_SUPPORTED(PE_DDR_WAIT_FOR_VCONN_OFF);
 GEN_NOT_SUPPORTED(PE_DDR_PERFORM_DATA_RESET);
 #define PE_DDR_PERFORM_DATA_RESET PE_DDR_PERFORM_DATA_RESET_NOT_SUPPORTED
 
-static enum sm_local_state local_state[CONFIG_USB_PD_PORT_MAX_COUNT];
+#ifdef CONFIG_PD_SINK_ONLY
+GEN_NOT_SUPPORTED(PE_PRS_FRS_SHARED);
+#define PE_PRS_FRS_SHARED PE_PRS_FRS_SHARED_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_SRC_PING);
+#define PE_SRC_PING PE_SRC_PING_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_DRS_EVALUATE_SWAP);
+#define PE_DRS_EVALUATE_SWAP PE_DRS_EVALUATE_SWAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_DRS_CHANGE);
+#define PE_DRS_CHANGE PE_DRS_CHANGE_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_DRS_SEND_SWAP);
+#define PE_DRS_SEND_SWAP PE_DRS_SEND_SWAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SRC_SNK_EVALUATE_SWAP);
+#define PE_PRS_SRC_SNK_EVALUATE_SWAP PE_PRS_SRC_SNK_EVALUATE_SWAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SRC_SNK_TRANSITION_TO_OFF);
+#define PE_PRS_SRC_SNK_TRANSITION_TO_OFF \
+	PE_PRS_SRC_SNK_TRANSITION_TO_OFF_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SRC_SNK_ASSERT_RD);
+#define PE_PRS_SRC_SNK_ASSERT_RD PE_PRS_SRC_SNK_ASSERT_RD_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SRC_SNK_WAIT_SOURCE_ON);
+#define PE_PRS_SRC_SNK_WAIT_SOURCE_ON \
+	PE_PRS_SRC_SNK_WAIT_SOURCE_ON_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SRC_SNK_SEND_SWAP);
+#define PE_PRS_SRC_SNK_SEND_SWAP PE_PRS_SRC_SNK_SEND_SWAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SNK_SRC_EVALUATE_SWAP);
+#define PE_PRS_SNK_SRC_EVALUATE_SWAP PE_PRS_SNK_SRC_EVALUATE_SWAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SNK_SRC_TRANSITION_TO_OFF);
+#define PE_PRS_SNK_SRC_TRANSITION_TO_OFF \
+	PE_PRS_SNK_SRC_TRANSITION_TO_OFF_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SNK_SRC_ASSERT_RP);
+#define PE_PRS_SNK_SRC_ASSERT_RP PE_PRS_SNK_SRC_ASSERT_RP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SNK_SRC_SOURCE_ON);
+#define PE_PRS_SNK_SRC_SOURCE_ON PE_PRS_SNK_SRC_SOURCE_ON_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_PRS_SNK_SRC_SEND_SWAP);
+#define PE_PRS_SNK_SRC_SEND_SWAP PE_PRS_SNK_SRC_SEND_SWAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_FRS_SNK_SRC_START_AMS);
+#define PE_FRS_SNK_SRC_START_AMS PE_FRS_SNK_SRC_START_AMS_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_BIST_TX);
+#define PE_BIST_TX PE_BIST_TX_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_DEU_SEND_ENTER_USB);
+#define PE_DEU_SEND_ENTER_USB PE_DEU_SEND_ENTER_USB_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_DR_GET_SINK_CAP);
+#define PE_DR_GET_SINK_CAP PE_DR_GET_SINK_CAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_DR_SNK_GIVE_SOURCE_CAP);
+#define PE_DR_SNK_GIVE_SOURCE_CAP PE_DR_SNK_GIVE_SOURCE_CAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_DR_SRC_GET_SOURCE_CAP);
+#define PE_DR_SRC_GET_SOURCE_CAP PE_DR_SRC_GET_SOURCE_CAP_NOT_SUPPORTED
+GEN_NOT_SUPPORTED(PE_SRC_CHUNK_RECEIVED);
+#define PE_SRC_CHUNK_RECEIVED PE_SRC_CHUNK_RECEIVED_NOT_SUPPORTED
+#endif /* CONFIG_PD_SINK_ONLY */
+
+static enum sm_local_state PD_PORT_DATA(local_state);
 
 /*
  * Common message send checking
@@ -472,21 +556,19 @@ static enum debug_level pe_debug_level = DEBUG_LEVEL_1;
 
 /*
  * Policy Engine State Machine Object
+ *
+ * Only state touched on every pass of the event loop, or by each AMS, is
+ * here. It is grouped at the start, so a pass needs few cache lines per
+ * port. Data used by negotiation or rare AMS only is in `pe_cold`.
  */
 static struct policy_engine {
 	/* state machine context */
 	struct sm_ctx ctx;
-	/* current port power role (SOURCE or SINK) */
-	enum pd_power_role power_role;
-	/* current port data role (DFP or UFP) */
-	enum pd_data_role data_role;
 	/* state machine flags */
 	ATOMIC_DEFINE(flags_a, PE_FLAGS_COUNT);
 	/* Device Policy Manager Request */
 	atomic_t dpm_request;
 	uint32_t dpm_curr_request;
-	/* last requested voltage PDO index */
-	int requested_idx;
 
 	/*
 	 * Port events - PD_STATUS_EVENT_* values
@@ -494,42 +576,18 @@ static struct policy_engine {
 	 */
 	atomic_t events;
 
-	/*
-	 * Desired result of a requested VCONN Swap. Only meaningful if
-	 * DPM_REQUEST_VCONN_SWAP is active.
-	 */
-	enum pd_vconn_role requested_vconn_role;
-
-	/* port address where soft resets are sent */
-	enum tcpci_msg_type soft_reset_sop;
-
-	/* Current limit / voltage based on the last request message */
-	uint32_t curr_limit;
-	uint32_t supply_voltage;
-
-	/* PD_VDO_INVALID is used when there is an invalid VDO */
-	int32_t ama_vdo;
-	int32_t vpd_vdo;
-	/* Alternate mode discovery results */
-	struct pd_discovery discovery[DISCOVERY_TYPE_COUNT];
+	/* current port power role (SOURCE or SINK) */
+	enum pd_power_role power_role;
+	/* current port data role (DFP or UFP) */
+	enum pd_data_role data_role;
 
 	/* Partner type to send */
 	enum tcpci_msg_type tx_type;
+	/* SOP* of the last message passed to PRL */
+	enum tcpci_msg_type sent_type;
 
-	/* VDM - used to send information to shared VDM Request state */
-	uint32_t vdm_cnt;
-	uint32_t vdm_data[VDO_HDR_SIZE + VDO_MAX_SIZE];
-	uint8_t vdm_ack_min_data_objects;
-
-	/* ADO - Used to store information about alert messages */
-	uint32_t ado;
-	mutex_t ado_lock;
-
-	/*
-	 * Flag to indicate that the timeout of the current VDM request should
-	 * be extended
-	 */
-	bool vdm_request_extend_timeout;
+	/* port address where soft resets are sent */
+	enum tcpci_msg_type soft_reset_sop;
 
 	/* Counters */
 
@@ -574,6 +632,49 @@ static struct policy_engine {
 	 */
 	uint8_t vconn_swap_counter;
 
+	/*
+	 * Desired result of a requested VCONN Swap. Only meaningful if
+	 * DPM_REQUEST_VCONN_SWAP is active.
+	 */
+	enum pd_vconn_role requested_vconn_role;
+
+	/* last requested voltage PDO index */
+	int requested_idx;
+
+	/* Current limit / voltage based on the last request message */
+	uint32_t curr_limit;
+	uint32_t supply_voltage;
+} PD_PORT_DATA(pe);
+
+/*
+ * Policy Engine cold data: capabilities, VDM and discovery storage,
+ * alerts. Large and rarely touched, so kept out of `pe`. Can be placed
+ * into slower RAM with `__pd_cold_data`.
+ */
+static struct policy_engine_cold {
+	/* PD_VDO_INVALID is used when there is an invalid VDO */
+	int32_t ama_vdo;
+	int32_t vpd_vdo;
+#ifndef CONFIG_PD_SINK_ONLY
+	/* Alternate mode discovery results */
+	struct pd_discovery discovery[DISCOVERY_TYPE_COUNT];
+
+	/* VDM - used to send information to shared VDM Request state */
+	uint32_t vdm_cnt;
+	uint32_t vdm_data[VDO_HDR_SIZE + VDO_MAX_SIZE];
+	uint8_t vdm_ack_min_data_objects;
+
+	/*
+	 * Flag to indicate that the timeout of the current VDM request should
+	 * be extended
+	 */
+	bool vdm_request_extend_timeout;
+#endif
+
+	/* ADO - Used to store information about alert messages */
+	uint32_t ado;
+	mutex_t ado_lock;
+
 	/* Last received source cap */
 	uint32_t src_caps[PDO_MAX_OBJECTS];
 	int src_cap_cnt; /* -1 on error retrieving source caps */
@@ -584,7 +685,13 @@ static struct policy_engine {
 
 	/* Last received Revision Message Data Object (RMDO) from the partner */
 	struct rmdo partner_rmdo;
-} pe[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+	/* Last received Source_Capabilities_Extended and Status data blocks */
+	uint8_t src_cap_ext[PD_SCEDB_SIZE];
+	uint8_t src_cap_ext_len;
+	uint8_t partner_sdb[sizeof(struct pd_sdb)];
+	uint8_t partner_sdb_len;
+} PD_PORT_DATA(pe_cold) __pd_cold_data;
 
 test_export_static enum usb_pe_state get_state_pe(const int port);
 test_export_static void set_state_pe(const int port,
@@ -638,6 +745,7 @@ static inline void send_data_msg(int port, enum tcpci_msg_type type,
 {
 	/* Clear any previous TX status before sending a new message */
 	PE_CLR_FLAG(port, PE_FLAGS_TX_COMPLETE);
+	pe[port].sent_type = type;
 	prl_send_data_msg(port, type, msg);
 }
 
@@ -646,6 +754,7 @@ send_ext_data_msg(int port, enum tcpci_msg_type type, enum pd_ext_msg_type msg)
 {
 	/* Clear any previous TX status before sending a new message */
 	PE_CLR_FLAG(port, PE_FLAGS_TX_COMPLETE);
+	pe[port].sent_type = type;
 	prl_send_ext_data_msg(port, type, msg);
 }
 
@@ -654,6 +763,7 @@ static inline void send_ctrl_msg(int port, enum tcpci_msg_type type,
 {
 	/* Clear any previous TX status before sending a new message */
 	PE_CLR_FLAG(port, PE_FLAGS_TX_COMPLETE);
+	pe[port].sent_type = type;
 	prl_send_ctrl_msg(port, type, msg);
 }
 
@@ -693,6 +803,9 @@ static void init_cable_rev(int port)
 
 static void pe_init(int port)
 {
+	usb_sm_check_table(pe_states, ARRAY_SIZE(pe_state_names));
+	usb_sm_trace_register(&pe[port].ctx, USB_SM_PE, pe_states,
+			      ARRAY_SIZE(pe_state_names));
 	memset(&pe[port].flags_a, 0, sizeof(pe[port].flags_a));
 	pe[port].dpm_request = 0;
 	pe[port].dpm_curr_request = 0;
@@ -792,6 +905,7 @@ void pe_run(int port, int evt, int en)
 		 * make sure to handle it immediately.
 		 */
 		if (1/*IS_ENABLED(CONFIG_USB_PD_REV30)*/ &&
+		    !IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
 		    PE_CHK_FLAG(port, PE_FLAGS_FAST_ROLE_SWAP_SIGNALED)) {
 			PE_CLR_FLAG(port, PE_FLAGS_FAST_ROLE_SWAP_SIGNALED);
 			set_state_pe(port, PE_FRS_SNK_SRC_START_AMS);
@@ -799,6 +913,10 @@ void pe_run(int port, int evt, int en)
 
 		/* Run state machine */
 		run_state(port, &pe[port].ctx);
+
+		/* Received message is consumed, let PRL reuse its RX slot */
+		if (!PE_CHK_FLAG(port, PE_FLAGS_MSG_RECEIVED))
+			prl_rx_release(port);
 		break;
 	}
 }
@@ -967,19 +1085,19 @@ uint32_t pd_get_events(int port)
 
 void pe_set_snk_caps(int port, int cnt, uint32_t *snk_caps)
 {
-	pe[port].snk_cap_cnt = cnt;
+	pe_cold[port].snk_cap_cnt = cnt;
 
-	memcpy(pe[port].snk_caps, snk_caps, sizeof(uint32_t) * cnt);
+	memcpy(pe_cold[port].snk_caps, snk_caps, sizeof(uint32_t) * cnt);
 }
 
 const uint32_t *const pd_get_snk_caps(int port)
 {
-	return pe[port].snk_caps;
+	return pe_cold[port].snk_caps;
 }
 
 uint8_t pd_get_snk_cap_cnt(int port)
 {
-	return pe[port].snk_cap_cnt;
+	return pe_cold[port].snk_cap_cnt;
 }
 
 uint32_t pd_get_requested_voltage(int port)
@@ -1038,7 +1156,7 @@ static bool pe_can_send_sop_vdm(int port, int vdm_cmd)
 
 static const uint32_t pd_get_fixed_pdo(int port)
 {
-	return pe[port].src_caps[0];
+	return pe_cold[port].src_caps[0];
 }
 
 bool pe_snk_in_epr_mode(int port)
@@ -1048,7 +1166,11 @@ bool pe_snk_in_epr_mode(int port)
 
 void pe_snk_epr_explicit_exit(int port)
 {
-	PE_SET_FLAG(port, PE_FLAGS_EPR_EXPLICIT_EXIT);
+	/*
+	 * Called from application context, so pass it as DPM request.
+	 * PE_FLAGS_EPR_EXPLICIT_EXIT is set when the request is taken.
+	 */
+	pd_dpm_request(port, DPM_REQUEST_EPR_MODE_EXIT);
 }
 
 bool pe_snk_can_enter_epr_mode(int port)
@@ -1155,9 +1277,10 @@ void pe_report_error(int port, enum pe_error e, enum tcpci_msg_type type)
 	 */
 	if ((get_state_pe(port) == PE_SRC_SEND_CAPABILITIES ||
 	     get_state_pe(port) == PE_SRC_TRANSITION_SUPPLY ||
-	     get_state_pe(port) == PE_PRS_SNK_SRC_EVALUATE_SWAP ||
-	     get_state_pe(port) == PE_PRS_SNK_SRC_SOURCE_ON ||
-	     get_state_pe(port) == PE_PRS_SRC_SNK_WAIT_SOURCE_ON ||
+	     (!IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+	      (get_state_pe(port) == PE_PRS_SNK_SRC_EVALUATE_SWAP ||
+	       get_state_pe(port) == PE_PRS_SNK_SRC_SOURCE_ON ||
+	       get_state_pe(port) == PE_PRS_SRC_SNK_WAIT_SOURCE_ON)) ||
 	     get_state_pe(port) == PE_SRC_DISABLED ||
 	     get_state_pe(port) == PE_SRC_DISCOVERY ||
 	     get_state_pe(port) == PE_VCS_CBL_SEND_SOFT_RESET ||
@@ -1172,7 +1295,7 @@ void pe_report_error(int port, enum pe_error e, enum tcpci_msg_type type)
 	      get_state_pe(port) == PE_DDR_DATA_RESET_RECEIVED ||
 	      get_state_pe(port) == PE_DDR_WAIT_FOR_VCONN_OFF ||
 	      get_state_pe(port) == PE_DDR_PERFORM_DATA_RESET)) ||
-	    (pe_in_frs_mode(port) &&
+	    (!IS_ENABLED(CONFIG_PD_SINK_ONLY) && pe_in_frs_mode(port) &&
 	     get_state_pe(port) == PE_PRS_SNK_SRC_SEND_SWAP)) {
 		PE_SET_FLAG(port, PE_FLAGS_PROTOCOL_ERROR);
 		pd_loop_wake(port);
@@ -1288,6 +1411,8 @@ void pd_resume_check_pr_swap_needed(int port)
 void pd_dpm_request(int port, enum pd_dpm_request req)
 {
 	PE_SET_DPM_REQUEST(port, req);
+	/* Tickless loop would not look at it until the next event */
+	pd_loop_wake(port);
 }
 
 void pe_vconn_swap_complete(int port)
@@ -1312,14 +1437,28 @@ void pe_message_sent(int port)
 	assert(port == TASK_ID_TO_PD_PORT(task_get_current()));
 
 	PE_SET_FLAG(port, PE_FLAGS_TX_COMPLETE);
+
+	/*
+	 * Source's EPR watchdog is fed by any message from us, so postpone
+	 * EPR_KeepAlive. Messages from source don't count.
+	 */
+	if (1/*IS_ENABLED(CONFIG_USB_PD_EPR)*/ && pe_snk_in_epr_mode(port) &&
+	    pe[port].sent_type == TCPCI_MSG_SOP)
+		pd_timer_enable(port, PE_TIMER_SINK_EPR_KEEP_ALIVE,
+				PD_T_SINK_EPR_KEEP_ALIVE);
+
 	pd_loop_wake(port);
 }
 
 void pd_send_vdm(int port, uint32_t vid, int cmd, const uint32_t *data,
 		 int count)
 {
+#ifdef CONFIG_PD_SINK_ONLY
+	/* No VDM Request state in sink-only build */
+	return;
+#else
 	/* Copy VDM Header */
-	pe[port].vdm_data[0] = VDO(
+	pe_cold[port].vdm_data[0] = VDO(
 		vid,
 		((vid & USB_SID_PD) == USB_SID_PD) ?
 			1 :
@@ -1330,9 +1469,9 @@ void pd_send_vdm(int port, uint32_t vid, int cmd, const uint32_t *data,
 	 * Copy VDOs after the VDM Header. Note that the count refers to VDO
 	 * count.
 	 */
-	memcpy((pe[port].vdm_data + 1), data, count * sizeof(uint32_t));
+	memcpy((pe_cold[port].vdm_data + 1), data, count * sizeof(uint32_t));
 
-	pe[port].vdm_cnt = count + 1;
+	pe_cold[port].vdm_cnt = count + 1;
 
 	/*
 	 * The PE transmit routine assumes that tx_type was set already. Note,
@@ -1343,6 +1482,7 @@ void pd_send_vdm(int port, uint32_t vid, int cmd, const uint32_t *data,
 	pd_dpm_request(port, DPM_REQUEST_VDM);
 
 	pd_loop_wake(port);
+#endif
 }
 
 #ifdef TEST_BUILD
@@ -1379,11 +1519,13 @@ static void pe_clear_port_data(int port)
 	/*
 	 * Saved Revision responses are no longer valid on disconnect
 	 */
-	pe[port].partner_rmdo.reserved = 0;
-	pe[port].partner_rmdo.minor_ver = 0;
-	pe[port].partner_rmdo.major_ver = 0;
-	pe[port].partner_rmdo.minor_rev = 0;
-	pe[port].partner_rmdo.major_rev = 0;
+	pe_cold[port].partner_rmdo.reserved = 0;
+	pe_cold[port].partner_rmdo.minor_ver = 0;
+	pe_cold[port].partner_rmdo.major_ver = 0;
+	pe_cold[port].partner_rmdo.minor_rev = 0;
+	pe_cold[port].partner_rmdo.major_rev = 0;
+	pe_cold[port].src_cap_ext_len = 0;
+	pe_cold[port].partner_sdb_len = 0;
 
 	/* Clear any stored discovery data, but leave modes for alt mode exit */
 	pd_dfp_discovery_init(port);
@@ -1409,26 +1551,43 @@ int pe_set_ado(int port, uint32_t data)
 	/* return busy error if unable to set ado */
 	int ret = EC_ERROR_BUSY;
 
-	mutex_lock(&pe[port].ado_lock);
-	if (pe[port].ado == 0x0) {
-		pe[port].ado = data;
+	mutex_lock(&pe_cold[port].ado_lock);
+	if (pe_cold[port].ado == 0x0) {
+		pe_cold[port].ado = data;
 		ret = EC_SUCCESS;
 	}
 
-	mutex_unlock(&pe[port].ado_lock);
+	mutex_unlock(&pe_cold[port].ado_lock);
 	return ret;
 }
 
 void pe_clear_ado(int port)
 {
-	mutex_lock(&pe[port].ado_lock);
-	pe[port].ado = 0x0;
-	mutex_unlock(&pe[port].ado_lock);
+	mutex_lock(&pe_cold[port].ado_lock);
+	pe_cold[port].ado = 0x0;
+	mutex_unlock(&pe_cold[port].ado_lock);
 }
 
 struct rmdo pd_get_partner_rmdo(int port)
 {
-	return pe[port].partner_rmdo;
+	return pe_cold[port].partner_rmdo;
+}
+
+int pd_get_src_cap_ext(int port, uint8_t *scedb)
+{
+	const int len = pe_cold[port].src_cap_ext_len;
+
+	memcpy(scedb, pe_cold[port].src_cap_ext, len);
+	return len;
+}
+
+int pd_get_partner_status(int port, struct pd_sdb *sdb)
+{
+	const int len = pe_cold[port].partner_sdb_len;
+
+	memset(sdb, 0, sizeof(*sdb));
+	memcpy(sdb, pe_cold[port].partner_sdb, len);
+	return len;
 }
 
 static void pe_handle_detach(void)
@@ -1453,6 +1612,16 @@ static void pe_set_dpm_curr_request(const int port, const int request)
 test_export_static void set_state_pe(const int port,
 				     const enum usb_pe_state new_state)
 {
+	/*
+	 * Some unported states are still reachable from shared code, e.g.
+	 * by DPM VDM requests. They have no table entry, so stay in the
+	 * current state.
+	 */
+	if (new_state >= PE_NOT_PORTED_FIRST) {
+		CPRINTS("C%d: PE state %d not supported", port, new_state);
+		return;
+	}
+
 	set_state(port, &pe[port].ctx, &pe_states[new_state]);
 }
 
@@ -1514,7 +1683,8 @@ static bool common_src_snk_dpm_requests(int port)
 		pe_set_dpm_curr_request(port, DPM_REQUEST_VCONN_SWAP);
 		set_state_pe(port, PE_VCS_SEND_SWAP);
 		return true;
-	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_BIST_TX)) {
+	} else if (!IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+		   PE_CHK_DPM_REQUEST(port, DPM_REQUEST_BIST_TX)) {
 		pe_set_dpm_curr_request(port, DPM_REQUEST_BIST_TX);
 		set_state_pe(port, PE_BIST_TX);
 		return true;
@@ -1531,7 +1701,8 @@ static bool common_src_snk_dpm_requests(int port)
 		/* Currently only support sending soft reset to SOP */
 		pe_send_soft_reset(port, TCPCI_MSG_SOP);
 		return true;
-	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_PORT_DISCOVERY)) {
+	} else if (!IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+		   PE_CHK_DPM_REQUEST(port, DPM_REQUEST_PORT_DISCOVERY)) {
 		pe_set_dpm_curr_request(port, DPM_REQUEST_PORT_DISCOVERY);
 		if (!PE_CHK_FLAG(port, PE_FLAGS_MODAL_OPERATION)) {
 			/*
@@ -1557,7 +1728,8 @@ static bool common_src_snk_dpm_requests(int port)
 		/* Send previously set up SVDM. */
 		set_state_pe(port, PE_VDM_REQUEST_DPM);
 		return true;
-	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_ENTER_USB)) {
+	} else if (!IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+		   PE_CHK_DPM_REQUEST(port, DPM_REQUEST_ENTER_USB)) {
 		pe_set_dpm_curr_request(port, DPM_REQUEST_ENTER_USB);
 		set_state_pe(port, PE_DEU_SEND_ENTER_USB);
 		return true;
@@ -1565,7 +1737,8 @@ static bool common_src_snk_dpm_requests(int port)
 		pe_set_dpm_curr_request(port, DPM_REQUEST_EXIT_MODES);
 		dpm_set_mode_exit_request(port);
 		return true;
-	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_GET_SNK_CAPS)) {
+	} else if (!IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+		   PE_CHK_DPM_REQUEST(port, DPM_REQUEST_GET_SNK_CAPS)) {
 		pe_set_dpm_curr_request(port, DPM_REQUEST_GET_SNK_CAPS);
 		set_state_pe(port, PE_DR_GET_SINK_CAP);
 		return true;
@@ -1576,7 +1749,8 @@ static bool common_src_snk_dpm_requests(int port)
 		pe[port].tx_type = TCPCI_MSG_SOP_PRIME;
 		set_state_pe(port, PE_VCS_CBL_SEND_SOFT_RESET);
 		return true;
-	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_DR_SWAP)) {
+	} else if (!IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+		   PE_CHK_DPM_REQUEST(port, DPM_REQUEST_DR_SWAP)) {
 		pe_set_dpm_curr_request(port, DPM_REQUEST_DR_SWAP);
 		/* 6.3.9 DR_Swap Message in Revision 3.1, Version 1.3
 		 * If there are any Active Modes between the Port Partners when
@@ -1611,6 +1785,22 @@ static bool common_src_snk_dpm_requests(int port)
 		pe_set_dpm_curr_request(port, DPM_REQUEST_GET_REVISION);
 		set_state_pe(port, PE_GET_REVISION);
 		return true;
+	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_GET_SRC_CAP_EXT)) {
+		if (prl_get_rev(port, TCPCI_MSG_SOP) < PD_REV30) {
+			PE_CLR_DPM_REQUEST(port, DPM_REQUEST_GET_SRC_CAP_EXT);
+			return false;
+		}
+		pe_set_dpm_curr_request(port, DPM_REQUEST_GET_SRC_CAP_EXT);
+		set_state_pe(port, PE_SNK_GET_SOURCE_CAP_EXT);
+		return true;
+	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_GET_STATUS)) {
+		if (prl_get_rev(port, TCPCI_MSG_SOP) < PD_REV30) {
+			PE_CLR_DPM_REQUEST(port, DPM_REQUEST_GET_STATUS);
+			return false;
+		}
+		pe_set_dpm_curr_request(port, DPM_REQUEST_GET_STATUS);
+		set_state_pe(port, PE_GET_STATUS);
+		return true;
 	} else if (0/*IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)*/ &&
 		   PE_CHK_DPM_REQUEST(port, DPM_REQUEST_SEND_ALERT)) {
 		if (prl_get_rev(port, TCPCI_MSG_SOP) < PD_REV30) {
@@ -1642,12 +1832,22 @@ static bool sink_dpm_requests(int port)
 					 DPM_REQUEST_SRC_CAP_CHANGE |
 					 DPM_REQUEST_SEND_PING);
 
+	/* Sink-only build can't swap, run BIST, discovery or Enter_USB */
+	if (IS_ENABLED(CONFIG_PD_SINK_ONLY))
+		PE_CLR_DPM_REQUEST(port, DPM_REQUEST_PR_SWAP |
+						 DPM_REQUEST_DR_SWAP |
+						 DPM_REQUEST_BIST_TX |
+						 DPM_REQUEST_PORT_DISCOVERY |
+						 DPM_REQUEST_ENTER_USB |
+						 DPM_REQUEST_GET_SNK_CAPS);
+
 	if (!pe[port].dpm_request)
 		return false;
 
 	PE_SET_FLAG(port, PE_FLAGS_LOCALLY_INITIATED_AMS);
 
-	if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_PR_SWAP)) {
+	if (!IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+	    PE_CHK_DPM_REQUEST(port, DPM_REQUEST_PR_SWAP)) {
 		pe_set_dpm_curr_request(port, DPM_REQUEST_PR_SWAP);
 		set_state_pe(port, PE_PRS_SNK_SRC_SEND_SWAP);
 		return true;
@@ -1659,6 +1859,15 @@ static bool sink_dpm_requests(int port)
 		pe_set_dpm_curr_request(port, DPM_REQUEST_NEW_POWER_LEVEL);
 		set_state_pe(port, PE_SNK_SELECT_CAPABILITY);
 		return true;
+	} else if (IS_ENABLED(CONFIG_PD_SNK_PPS) &&
+		   PE_CHK_DPM_REQUEST(port, DPM_REQUEST_GET_PPS_STATUS)) {
+		if (prl_get_rev(port, TCPCI_MSG_SOP) < PD_REV30) {
+			PE_CLR_DPM_REQUEST(port, DPM_REQUEST_GET_PPS_STATUS);
+			return false;
+		}
+		pe_set_dpm_curr_request(port, DPM_REQUEST_GET_PPS_STATUS);
+		set_state_pe(port, PE_SNK_GET_PPS_STATUS);
+		return true;
 	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_FRS_DET_ENABLE)) {
 		pe_set_frs_enable(port, 1);
 
@@ -1691,6 +1900,9 @@ static bool sink_dpm_requests(int port)
 		set_state_pe(port, PE_SNK_SEND_EPR_MODE_ENTRY);
 		return true;
 	} else if (PE_CHK_DPM_REQUEST(port, DPM_REQUEST_EPR_MODE_EXIT)) {
+		/* Don't re-enter EPR automatically after exit */
+		PE_SET_FLAG(port, PE_FLAGS_EPR_EXPLICIT_EXIT);
+
 		if (!pe_snk_in_epr_mode(port)) {
 			PE_CLR_DPM_REQUEST(port, DPM_REQUEST_EPR_MODE_EXIT);
 			CPRINTS("C%d: Not in EPR mode", port);
@@ -1794,6 +2006,19 @@ static void pe_send_request_msg(int port)
 	/* Build and send request RDO */
 	pd_build_request(vpd_vdo, &rdo, &curr_limit, &supply_voltage, port);
 
+	/*
+	 * Use unchunked extended messages, if source supports those too.
+	 * Flag is in vSafe5V PDO, and must be the same for EPR requests.
+	 */
+	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_UNCHUNKED) &&
+	    prl_get_rev(port, TCPCI_MSG_SOP) == PD_REV30 &&
+	    (pd_get_src_caps(port)[0] & PDO_FIXED_UNCHUNK_EXT)) {
+		rdo |= RDO_UNCHUNK_EXT;
+		prl_set_unchunked_ext(port, true);
+	} else {
+		prl_set_unchunked_ext(port, false);
+	}
+
 	CPRINTF("C%d: Req [%d] %dmV %dmA", port, RDO_POS(rdo), supply_voltage,
 		curr_limit);
 	if (rdo & RDO_CAP_MISMATCH)
@@ -1850,6 +2075,9 @@ bool pe_is_pr_swapping(int port)
 {
 	enum usb_pe_state cur_state = get_state_pe(port);
 
+	if (IS_ENABLED(CONFIG_PD_SINK_ONLY))
+		return false;
+
 	if (cur_state == PE_PRS_SRC_SNK_EVALUATE_SWAP ||
 	    cur_state == PE_PRS_SRC_SNK_TRANSITION_TO_OFF ||
 	    cur_state == PE_PRS_SNK_SRC_EVALUATE_SWAP ||
@@ -1903,6 +2131,9 @@ __maybe_unused static bool pe_attempt_port_discovery(int port)
 	if (!0/*IS_ENABLED(CONFIG_USB_PD_ALT_MODE_DFP)*/)
 		assert(0);
 
+	if (IS_ENABLED(CONFIG_PD_SINK_ONLY))
+		return false;
+
 	/* TODO(b/272827504): Gate discovery via a DPM request and remove this
 	 * flag.
 	 */
@@ -1989,14 +2220,18 @@ __maybe_unused static bool pe_attempt_port_discovery(int port)
 bool pd_setup_vdm_request(int port, enum tcpci_msg_type tx_type, uint32_t *vdm,
 			  uint32_t vdo_cnt)
 {
+#ifdef CONFIG_PD_SINK_ONLY
+	return false;
+#else
 	if (vdo_cnt < VDO_HDR_SIZE || vdo_cnt > VDO_MAX_SIZE)
 		return false;
 
 	pe[port].tx_type = tx_type;
-	memcpy(pe[port].vdm_data, vdm, vdo_cnt * sizeof(*vdm));
-	pe[port].vdm_cnt = vdo_cnt;
+	memcpy(pe_cold[port].vdm_data, vdm, vdo_cnt * sizeof(*vdm));
+	pe_cold[port].vdm_cnt = vdo_cnt;
 
 	return true;
+#endif
 }
 
 /*
@@ -2135,11 +2370,13 @@ static void extended_message_not_supported(int port, uint32_t *payload)
 	uint16_t ext_header = GET_EXT_HEADER(*payload);
 
 	if (1/*IS_ENABLED(CONFIG_USB_PD_REV30)*/ &&
-	    !0/*IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)*/ &&
+	    !IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES) &&
 	    PD_EXT_HEADER_CHUNKED(ext_header) &&
 	    PD_EXT_HEADER_DATA_SIZE(ext_header) >
 		    PD_MAX_EXTENDED_MSG_CHUNK_LEN) {
-		set_state_pe(port, pe[port].power_role == PD_ROLE_SOURCE ?
+		set_state_pe(port, !IS_ENABLED(CONFIG_PD_SINK_ONLY) &&
+						   pe[port].power_role ==
+							   PD_ROLE_SOURCE ?
 					   PE_SRC_CHUNK_RECEIVED :
 					   PE_SNK_CHUNK_RECEIVED);
 		return;
@@ -2155,6 +2392,8 @@ static void pe_snk_startup_entry(int port)
 {
 	print_current_state(port);
 
+	pd_bench_start(port);
+
 	/* Reset the protocol layer */
 	prl_reset_soft(port);
 
@@ -2202,7 +2441,8 @@ static void pe_snk_startup_entry(int port)
 		 * Set DiscoverIdentityTimer to trigger when we enter
 		 * snk_ready for the first time.
 		 */
-		pd_timer_enable(port, PE_TIMER_DISCOVER_IDENTITY, 0);
+		if (!IS_ENABLED(CONFIG_PD_SINK_ONLY))
+			pd_timer_enable(port, PE_TIMER_DISCOVER_IDENTITY, 0);
 
 		/* Clear port discovery/mode flags */
 		pd_dfp_discovery_init(port);
@@ -2352,8 +2592,8 @@ static void pe_snk_evaluate_capability_entry(int port)
 	init_cable_rev(port);
 
 	/* Parse source caps if they have changed */
-	if (pe[port].src_cap_cnt != num ||
-	    memcmp(pdo, pe[port].src_caps, num << 2)) {
+	if (pe_cold[port].src_cap_cnt != num ||
+	    memcmp(pdo, pe_cold[port].src_caps, num << 2)) {
 		/*
 		 * If port policy preference is to be a power role source,
 		 * then request a power role swap.  If we'd previously queued a
@@ -2369,7 +2609,8 @@ static void pe_snk_evaluate_capability_entry(int port)
 	pd_set_src_caps(port, num, pdo);
 
 	/* Evaluate the options based on supplied capabilities */
-	pd_process_source_cap(port, pe[port].src_cap_cnt, pe[port].src_caps);
+	pd_process_source_cap(port, pe_cold[port].src_cap_cnt,
+			      pe_cold[port].src_caps);
 
 	/* Device Policy Response Received */
 	set_state_pe(port, PE_SNK_SELECT_CAPABILITY);
@@ -2496,6 +2737,7 @@ static void pe_snk_select_capability_run(int port)
 					PE_SET_FLAG(port, PE_FLAGS_WAIT);
 
 				pd_timer_disable(port, PE_TIMER_SINK_REQUEST);
+				pd_snk_request_done(port, false);
 
 				/*
 				 * We had a previous explicit contract, so
@@ -2615,6 +2857,10 @@ static void pe_snk_transition_sink_run(int port)
 				/* Set ceiling based on what's negotiated */
 				charge_manager_set_ceil(port, CEIL_REQUESTOR_PD,
 							pe[port].curr_limit);
+			pd_snk_request_done(port, true);
+			pd_bench_contract(port,
+					  prl_get_rev(port, TCPCI_MSG_SOP),
+					  pe_snk_in_epr_mode(port));
 			set_state_pe(port, PE_SNK_READY);
 		} else {
 			/*
@@ -2684,11 +2930,161 @@ static void pe_snk_ready_entry(int port)
 		if (pe_snk_in_epr_mode(port))
 			pd_timer_enable(port, PE_TIMER_SINK_EPR_KEEP_ALIVE,
 					PD_T_SINK_EPR_KEEP_ALIVE);
-		else if (!PE_CHK_FLAG(port, PE_FLAGS_EPR_EXPLICIT_EXIT))
+		else if (!PE_CHK_FLAG(port, PE_FLAGS_EPR_EXPLICIT_EXIT) &&
+			 !PE_CHK_DPM_REQUEST(port, DPM_REQUEST_EPR_MODE_EXIT) &&
+			 !pd_snk_cache_skip_epr(port))
 			pd_dpm_request(port, DPM_REQUEST_EPR_MODE_ENTRY);
 	}
 }
 
+/*
+ * PE_SNK_Ready message dispatch, indexed by message class (control, data,
+ * extended) and type. Entry is either a plain transition, built with
+ * SNK_RX_TO(), or one of the actions below. Types not listed are zero, so
+ * unsupported messages take a single lookup to the Not_Supported reply.
+ */
+enum snk_ready_rx_action {
+	/* Not_Supported, or ignore for PD 2.0 */
+	SNK_RX_NOT_SUPPORTED = 0,
+	/* Do nothing, keep running PE_SNK_Ready */
+	SNK_RX_IGNORE,
+	/* USB PD 3.0 6.8.1: unexpected message is answered with Soft_Reset */
+	SNK_RX_SOFT_RESET,
+	SNK_RX_VENDOR_DEF,
+	SNK_RX_EPR_MODE,
+	SNK_RX_EPR_SOURCE_CAP,
+	SNK_RX_DR_SWAP,
+	/* First transition, SNK_RX_TO(state) */
+	SNK_RX_STATE,
+};
+
+/* Target state must have an entry in pe_states[], checked at build */
+#define SNK_RX_TO(state) \
+	(SNK_RX_STATE + (state) + \
+	 0 * sizeof(char[(state) < PE_NOT_PORTED_FIRST ? 1 : -1]))
+
+enum snk_ready_rx_class {
+	SNK_RX_CTRL,
+	SNK_RX_DATA,
+	SNK_RX_EXT,
+	SNK_RX_CLASS_COUNT
+};
+
+static const uint8_t snk_ready_rx[SNK_RX_CLASS_COUNT][32] = {
+	[SNK_RX_CTRL] = {
+		[PD_CTRL_GOOD_CRC] = SNK_RX_IGNORE,
+		[PD_CTRL_PING] = SNK_RX_IGNORE,
+		[PD_CTRL_NOT_SUPPORTED] = SNK_RX_IGNORE,
+		[PD_CTRL_GET_SINK_CAP] = SNK_RX_TO(PE_SNK_GIVE_SINK_CAP),
+		[PD_CTRL_GOTO_MIN] = SNK_RX_TO(PE_SNK_TRANSITION_SINK),
+#ifndef CONFIG_PD_SINK_ONLY
+		[PD_CTRL_GET_SOURCE_CAP] = SNK_RX_TO(PE_DR_SNK_GIVE_SOURCE_CAP),
+		[PD_CTRL_PR_SWAP] = SNK_RX_TO(PE_PRS_SNK_SRC_EVALUATE_SWAP),
+		[PD_CTRL_DR_SWAP] = SNK_RX_DR_SWAP,
+#endif
+		/* PE_VCS_EVALUATE_SWAP is not supported (no CONFIG_USBC_VCONN) */
+		[PD_CTRL_VCONN_SWAP] = SNK_RX_NOT_SUPPORTED,
+		[PD_CTRL_ACCEPT] = SNK_RX_SOFT_RESET,
+		[PD_CTRL_REJECT] = SNK_RX_SOFT_RESET,
+		[PD_CTRL_WAIT] = SNK_RX_SOFT_RESET,
+		[PD_CTRL_PS_RDY] = SNK_RX_SOFT_RESET,
+	},
+	[SNK_RX_DATA] = {
+		[PD_DATA_SOURCE_CAP] = SNK_RX_TO(PE_SNK_EVALUATE_CAPABILITY),
+		[PD_DATA_VENDOR_DEF] = SNK_RX_VENDOR_DEF,
+#ifndef CONFIG_PD_SINK_ONLY
+		[PD_DATA_BIST] = SNK_RX_TO(PE_BIST_TX),
+#endif
+		/* PE_ALERT_RECEIVED is not ported, Alert needs no response */
+		[PD_DATA_ALERT] = SNK_RX_IGNORE,
+		[PD_DATA_EPR_MODE] = SNK_RX_EPR_MODE,
+	},
+	[SNK_RX_EXT] = {
+		[PD_EXT_EPR_SOURCE_CAP] = SNK_RX_EPR_SOURCE_CAP,
+		/*
+		 * Late responses to Get_Source_Cap_Extended, Get_Status and
+		 * Get_PPS_Status
+		 */
+		[PD_EXT_SOURCE_CAP] = SNK_RX_IGNORE,
+		[PD_EXT_STATUS] = SNK_RX_IGNORE,
+		[PD_EXT_PPS_STATUS] = SNK_RX_IGNORE,
+	},
+};
+
+/*
+ * Handle message received in PE_SNK_Ready. Returns true if state was
+ * changed.
+ */
+static bool pe_snk_ready_rx(int port)
+{
+	const uint32_t header = rx_emsg[port].header;
+	uint32_t *payload = (uint32_t *)rx_emsg[port].buf;
+	enum snk_ready_rx_class class;
+	uint8_t action;
+
+	if (PD_HEADER_EXT(header))
+		class = SNK_RX_EXT;
+	else if (PD_HEADER_CNT(header))
+		class = SNK_RX_DATA;
+	else
+		class = SNK_RX_CTRL;
+
+	action = snk_ready_rx[class][PD_HEADER_TYPE(header)];
+
+	if (action >= SNK_RX_STATE) {
+		set_state_pe(port, action - SNK_RX_STATE);
+		return true;
+	}
+
+	switch (action) {
+	case SNK_RX_IGNORE:
+		return false;
+	case SNK_RX_SOFT_RESET:
+		pe_send_soft_reset(port, PD_HEADER_GET_SOP(header));
+		return true;
+	case SNK_RX_VENDOR_DEF:
+		/*
+		 * PE_VDM_RESPONSE is not ported, so neither structured nor
+		 * unstructured VDMs are supported. For PD 3.x, send Not
+		 * Supported. For PD 2.0, ignore.
+		 */
+		if (prl_get_rev(port, TCPCI_MSG_SOP) <= PD_REV20)
+			return true;
+		break;
+	case SNK_RX_EPR_MODE:
+		if (((struct eprmdo *)payload)->action ==
+		    PD_EPRMDO_ACTION_EXIT)
+			set_state_pe(port, PE_SNK_EPR_MODE_EXIT_RECEIVED);
+		return true;
+	case SNK_RX_EPR_SOURCE_CAP:
+		/* Source sends it unsolicited on change, in EPR mode only */
+		if (!pe_snk_in_epr_mode(port))
+			break;
+		set_state_pe(port, PE_SNK_EVALUATE_CAPABILITY);
+		return true;
+#ifndef CONFIG_PD_SINK_ONLY
+	case SNK_RX_DR_SWAP:
+		if (PE_CHK_FLAG(port, PE_FLAGS_MODAL_OPERATION))
+			pe_set_hard_reset(port);
+		else
+			set_state_pe(port, PE_DRS_EVALUATE_SWAP);
+		return true;
+#endif
+	default:
+		break;
+	}
+
+	/*
+	 * Receiving an unknown or unsupported message shall be responded to
+	 * with a not supported message.
+	 */
+	if (class == SNK_RX_EXT)
+		extended_message_not_supported(port, payload);
+	else
+		set_state_pe(port, PE_SEND_NOT_SUPPORTED);
+	return true;
+}
+
 static void pe_snk_ready_run(int port)
 {
 	/*
@@ -2696,121 +3092,10 @@ static void pe_snk_ready_run(int port)
 	 * reset
 	 */
 	if (PE_CHK_FLAG(port, PE_FLAGS_MSG_RECEIVED)) {
-		uint8_t type = PD_HEADER_TYPE(rx_emsg[port].header);
-		uint8_t cnt = PD_HEADER_CNT(rx_emsg[port].header);
-		uint8_t ext = PD_HEADER_EXT(rx_emsg[port].header);
-		uint32_t *payload = (uint32_t *)rx_emsg[port].buf;
-
 		PE_CLR_FLAG(port, PE_FLAGS_MSG_RECEIVED);
 
-		/* Extended Message Request */
-		if (ext > 0) {
-			switch (type) {
-			default:
-				extended_message_not_supported(port, payload);
-			}
+		if (pe_snk_ready_rx(port))
 			return;
-		}
-		/* Data Messages */
-		else if (cnt > 0) {
-			switch (type) {
-			case PD_DATA_SOURCE_CAP:
-				set_state_pe(port, PE_SNK_EVALUATE_CAPABILITY);
-				return;
-			case PD_DATA_VENDOR_DEF:
-				if (PD_VDO_SVDM(*payload))
-					set_state_pe(port, PE_VDM_RESPONSE);
-				/* The TCPM does not support any unstructured
-				 * VDMs. For PD 3.x, send Not Supported. For
-				 * PD 2.0, ignore.
-				 */
-				else if (prl_get_rev(port, TCPCI_MSG_SOP) >
-					 PD_REV20)
-					set_state_pe(port,
-						     PE_SEND_NOT_SUPPORTED);
-				return;
-			case PD_DATA_BIST:
-				set_state_pe(port, PE_BIST_TX);
-				return;
-			case PD_DATA_ALERT:
-				set_state_pe(port, PE_ALERT_RECEIVED);
-				return;
-			case PD_DATA_EPR_MODE:
-				struct eprmdo *mdo = (void *)payload;
-
-				if (mdo->action == PD_EPRMDO_ACTION_EXIT) {
-					set_state_pe(
-						port,
-						PE_SNK_EPR_MODE_EXIT_RECEIVED);
-				}
-				return;
-			default:
-				set_state_pe(port, PE_SEND_NOT_SUPPORTED);
-				return;
-			}
-		}
-		/* Control Messages */
-		else {
-			switch (type) {
-			case PD_CTRL_GOOD_CRC:
-				/* Do nothing */
-				break;
-			case PD_CTRL_PING:
-				/* Do nothing */
-				break;
-			case PD_CTRL_GET_SOURCE_CAP:
-				set_state_pe(port, PE_DR_SNK_GIVE_SOURCE_CAP);
-				return;
-			case PD_CTRL_GET_SINK_CAP:
-				set_state_pe(port, PE_SNK_GIVE_SINK_CAP);
-				return;
-			case PD_CTRL_GOTO_MIN:
-				set_state_pe(port, PE_SNK_TRANSITION_SINK);
-				return;
-			case PD_CTRL_PR_SWAP:
-				set_state_pe(port,
-					     PE_PRS_SNK_SRC_EVALUATE_SWAP);
-				return;
-			case PD_CTRL_DR_SWAP:
-				if (PE_CHK_FLAG(port, PE_FLAGS_MODAL_OPERATION))
-					pe_set_hard_reset(port);
-				else
-					set_state_pe(port,
-						     PE_DRS_EVALUATE_SWAP);
-				return;
-			case PD_CTRL_VCONN_SWAP:
-				if (0/*IS_ENABLED(CONFIG_USBC_VCONN)*/)
-					set_state_pe(port,
-						     PE_VCS_EVALUATE_SWAP);
-				else
-					set_state_pe(port,
-						     PE_SEND_NOT_SUPPORTED);
-				return;
-			case PD_CTRL_NOT_SUPPORTED:
-				/* Do nothing */
-				break;
-			/*
-			 * USB PD 3.0 6.8.1:
-			 * Receiving an unexpected message shall be responded
-			 * to with a soft reset message.
-			 */
-			case PD_CTRL_ACCEPT:
-			case PD_CTRL_REJECT:
-			case PD_CTRL_WAIT:
-			case PD_CTRL_PS_RDY:
-				pe_send_soft_reset(
-					port, PD_HEADER_GET_SOP(
-						      rx_emsg[port].header));
-				return;
-			/*
-			 * Receiving an unknown or unsupported message
-			 * shall be responded to with a not supported message.
-			 */
-			default:
-				set_state_pe(port, PE_SEND_NOT_SUPPORTED);
-				return;
-			}
-		}
 	}
 
 	/*
@@ -3194,7 +3479,7 @@ static void pe_send_not_supported_run(int port)
 __maybe_unused static void pe_chunk_received_entry(int port)
 {
 	if (!1/*IS_ENABLED(CONFIG_USB_PD_REV30)*/ ||
-	    0/*IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)*/)
+	    IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
 		assert(0);
 
 	print_current_state(port);
@@ -3205,7 +3490,7 @@ __maybe_unused static void pe_chunk_received_entry(int port)
 __maybe_unused static void pe_chunk_received_run(int port)
 {
 	if (!1/*IS_ENABLED(CONFIG_USB_PD_REV30)*/ ||
-	    0/*IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)*/)
+	    IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
 		assert(0);
 
 	if (pd_timer_is_expired(port, PE_TIMER_CHUNKING_NOT_SUPPORTED))
@@ -3217,6 +3502,7 @@ __maybe_unused static void pe_chunk_received_exit(int port)
 	pd_timer_disable(port, PE_TIMER_CHUNKING_NOT_SUPPORTED);
 }
 
+#ifndef CONFIG_PD_SINK_ONLY
 /**
  * PE_SRC_Ping
  */
@@ -4151,6 +4437,7 @@ static void pe_bist_tx_exit(int port)
 {
 	pd_timer_disable(port, PE_TIMER_BIST_CONT_MODE);
 }
+#endif /* CONFIG_PD_SINK_ONLY */
 
 /**
  * Give_Sink_Cap Message
@@ -4199,6 +4486,7 @@ uint32_t pd_compose_svdm_req_header(int port, enum tcpci_msg_type type,
 			   VDM_VERS_MINOR | cmd);
 }
 
+#ifndef CONFIG_PD_SINK_ONLY
 /**
  * PE_DEU_SEND_ENTER_USB
  */
@@ -4520,6 +4808,7 @@ static void pe_dr_src_get_source_cap_exit(int port)
 {
 	pe_sender_response_msg_exit(port);
 }
+#endif /* CONFIG_PD_SINK_ONLY */
 
 /*
  * PE_Get_Revision
@@ -4553,7 +4842,7 @@ __maybe_unused static void pe_get_revision_run(int port)
 
 		if (ext == 0 && cnt == 1 && type == PD_DATA_REVISION) {
 			/* Revision returned by partner */
-			pe[port].partner_rmdo =
+			pe_cold[port].partner_rmdo =
 				*((struct rmdo *)rx_emsg[port].buf);
 		} else if (type != PD_CTRL_NOT_SUPPORTED) {
 			/*
@@ -4586,6 +4875,157 @@ __maybe_unused static void pe_get_revision_exit(int port)
 	pe_sender_response_msg_exit(port);
 }
 
+/*
+ * PE_SNK_Get_PPS_Status
+ */
+static void pe_snk_get_pps_status_entry(int port)
+{
+	print_current_state(port);
+
+	/* Send a Get_PPS_Status message */
+	send_ctrl_msg(port, TCPCI_MSG_SOP, PD_CTRL_GET_PPS_STATUS);
+	pe_sender_response_msg_entry(port);
+}
+
+static void pe_snk_get_pps_status_run(int port)
+{
+	int type;
+	int cnt;
+	int ext;
+	enum pe_msg_check msg_check;
+
+	/* Check the state of the message sent */
+	msg_check = pe_sender_response_msg_run(port);
+
+	if ((msg_check & PE_MSG_SENT) &&
+	    PE_CHK_FLAG(port, PE_FLAGS_MSG_RECEIVED)) {
+		PE_CLR_FLAG(port, PE_FLAGS_MSG_RECEIVED);
+
+		type = PD_HEADER_TYPE(rx_emsg[port].header);
+		cnt = PD_HEADER_CNT(rx_emsg[port].header);
+		ext = PD_HEADER_EXT(rx_emsg[port].header);
+
+		if (ext && type == PD_EXT_PPS_STATUS &&
+		    rx_emsg[port].len >= 4) {
+			pd_snk_pps_status_received(port, rx_emsg[port].buf);
+		} else if (ext || cnt || type != PD_CTRL_NOT_SUPPORTED) {
+			/* Interrupted by another message, handle it in Ready */
+			PE_SET_FLAG(port, PE_FLAGS_MSG_RECEIVED);
+		}
+
+		/* Get_PPS_Status is an interruptible AMS */
+		pe_set_ready_state(port);
+		return;
+	}
+
+	/*
+	 * Return to ready state if the message was discarded or timer expires
+	 */
+	if ((msg_check & PE_MSG_DISCARDED) ||
+	    pd_timer_is_expired(port, PE_TIMER_SENDER_RESPONSE))
+		pe_set_ready_state(port);
+}
+
+static void pe_snk_get_pps_status_exit(int port)
+{
+	pe_sender_response_msg_exit(port);
+}
+
+/*
+ * Wait for extended response `resp` to the request sent on entry, and save
+ * its data block into `buf`. Both AMS are interruptible, like
+ * Get_Revision.
+ */
+static void pe_get_ext_response_run(int port, enum pd_ext_msg_type resp,
+				    uint8_t *buf, uint8_t *len, int size)
+{
+	int type;
+	int cnt;
+	int ext;
+	enum pe_msg_check msg_check;
+
+	/* Check the state of the message sent */
+	msg_check = pe_sender_response_msg_run(port);
+
+	if ((msg_check & PE_MSG_SENT) &&
+	    PE_CHK_FLAG(port, PE_FLAGS_MSG_RECEIVED)) {
+		PE_CLR_FLAG(port, PE_FLAGS_MSG_RECEIVED);
+
+		type = PD_HEADER_TYPE(rx_emsg[port].header);
+		cnt = PD_HEADER_CNT(rx_emsg[port].header);
+		ext = PD_HEADER_EXT(rx_emsg[port].header);
+
+		if (ext && type == resp) {
+			/* Longer blocks are from newer revisions, keep ours */
+			*len = MIN(rx_emsg[port].len, size);
+			memcpy(buf, rx_emsg[port].buf, *len);
+		} else if (ext || cnt || type != PD_CTRL_NOT_SUPPORTED) {
+			/* Interrupted by another message, handle it in Ready */
+			PE_SET_FLAG(port, PE_FLAGS_MSG_RECEIVED);
+		}
+
+		pe_set_ready_state(port);
+		return;
+	}
+
+	/*
+	 * Return to ready state if the message was discarded or timer expires
+	 */
+	if ((msg_check & PE_MSG_DISCARDED) ||
+	    pd_timer_is_expired(port, PE_TIMER_SENDER_RESPONSE))
+		pe_set_ready_state(port);
+}
+
+/*
+ * PE_SNK_Get_Source_Cap_Ext
+ */
+static void pe_snk_get_source_cap_ext_entry(int port)
+{
+	print_current_state(port);
+
+	/* Send a Get_Source_Cap_Extended message */
+	send_ctrl_msg(port, TCPCI_MSG_SOP, PD_CTRL_GET_SOURCE_CAP_EXT);
+	pe_sender_response_msg_entry(port);
+}
+
+static void pe_snk_get_source_cap_ext_run(int port)
+{
+	pe_get_ext_response_run(port, PD_EXT_SOURCE_CAP,
+				pe_cold[port].src_cap_ext,
+				&pe_cold[port].src_cap_ext_len,
+				sizeof(pe_cold[port].src_cap_ext));
+}
+
+static void pe_snk_get_source_cap_ext_exit(int port)
+{
+	pe_sender_response_msg_exit(port);
+}
+
+/*
+ * PE_Get_Status
+ */
+static void pe_get_status_entry(int port)
+{
+	print_current_state(port);
+
+	/* Send a Get_Status message */
+	send_ctrl_msg(port, TCPCI_MSG_SOP, PD_CTRL_GET_STATUS);
+	pe_sender_response_msg_entry(port);
+}
+
+static void pe_get_status_run(int port)
+{
+	pe_get_ext_response_run(port, PD_EXT_STATUS,
+				pe_cold[port].partner_sdb,
+				&pe_cold[port].partner_sdb_len,
+				sizeof(pe_cold[port].partner_sdb));
+}
+
+static void pe_get_status_exit(int port)
+{
+	pe_sender_response_msg_exit(port);
+}
+
 
 static void pe_enter_epr_mode(int port)
 {
@@ -4754,6 +5194,7 @@ static void pe_snk_epr_mode_entry_wait_for_response_run(int port)
 			struct eprmdo *eprmdo = (void *)rx_emsg[port].buf;
 
 			if (eprmdo->action == PD_EPRMDO_ACTION_ENTER_SUCCESS) {
+				pd_snk_cache_epr_done(port, true, 0);
 				pe_enter_epr_mode(port);
 				set_state_pe(port,
 					     PE_SNK_WAIT_FOR_CAPABILITIES);
@@ -4764,10 +5205,12 @@ static void pe_snk_epr_mode_entry_wait_for_response_run(int port)
 				/* Table 6-50 EPR Mode Data Object */
 				CPRINTS("C%d: Failed to enter EPR for 0x%x",
 					port, eprmdo->data);
+				pd_snk_cache_epr_done(port, false,
+						      eprmdo->data);
 			}
 			/* Fall through to soft reset. */
-		} else if ((ext == 0) && (cnt == 0) &&
-			   (type == PD_CTRL_VCONN_SWAP)) {
+		} else if (IS_ENABLED(CONFIG_USBC_VCONN) && (ext == 0) &&
+			   (cnt == 0) && (type == PD_CTRL_VCONN_SWAP)) {
 			set_state_pe(port, PE_VCS_EVALUATE_SWAP);
 			return;
 		}
@@ -4859,12 +5302,12 @@ static void pe_snk_epr_mode_exit_received_entry(int port)
 
 const uint32_t *const pd_get_src_caps(int port)
 {
-	return pe[port].src_caps;
+	return pe_cold[port].src_caps;
 }
 
 void pd_set_src_caps(int port, int cnt, uint32_t *src_caps)
 {
-	const int limit = ARRAY_SIZE(pe[port].src_caps);
+	const int limit = ARRAY_SIZE(pe_cold[port].src_caps);
 	int i;
 
 	if (cnt > limit) {
@@ -4873,22 +5316,32 @@ void pd_set_src_caps(int port, int cnt, uint32_t *src_caps)
 		cnt = limit;
 	}
 
-	pe[port].src_cap_cnt = cnt;
+	pe_cold[port].src_cap_cnt = cnt;
 
 	for (i = 0; i < cnt; i++)
-		pe[port].src_caps[i] = *src_caps++;
+		pe_cold[port].src_caps[i] = *src_caps++;
 }
 
 uint8_t pd_get_src_cap_cnt(int port)
 {
-	if (pe[port].src_cap_cnt > 0)
-		return pe[port].src_cap_cnt;
+	if (pe_cold[port].src_cap_cnt > 0)
+		return pe_cold[port].src_cap_cnt;
 
 	return 0;
 }
 
 /* Track access to the PD discovery structures during HC execution */
-atomic_t task_access[CONFIG_USB_PD_PORT_MAX_COUNT][DISCOVERY_TYPE_COUNT];
+atomic_t PD_PORT_DATA(task_access)[DISCOVERY_TYPE_COUNT];
+
+#ifdef CONFIG_PD_PORT_ARENA
+void pe_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(local_state, count);
+	PD_PORT_DATA_TAKE(pe, count);
+	PD_PORT_DATA_TAKE(pe_cold, count);
+	PD_PORT_DATA_TAKE(task_access, count);
+}
+#endif
 
 void pd_dfp_discovery_init(int port)
 {
@@ -4896,7 +5349,9 @@ void pd_dfp_discovery_init(int port)
 	atomic_or(&task_access[port][TCPCI_MSG_SOP_PRIME],
 		  BIT(task_get_current()));
 
-	memset(pe[port].discovery, 0, sizeof(pe[port].discovery));
+#ifndef CONFIG_PD_SINK_ONLY
+	memset(pe_cold[port].discovery, 0, sizeof(pe_cold[port].discovery));
+#endif
 }
 
 void pd_dfp_mode_init(int port)
@@ -4949,7 +5404,14 @@ pd_get_am_discovery(int port, enum tcpci_msg_type type)
 		assert(0);
 	ASSERT(type < DISCOVERY_TYPE_COUNT);
 
-	return &pe[port].discovery[type];
+#ifdef CONFIG_PD_SINK_ONLY
+	/* Nothing is discovered in sink-only build */
+	static const struct pd_discovery no_discovery;
+
+	return &no_discovery;
+#else
+	return &pe_cold[port].discovery[type];
+#endif
 }
 
 __maybe_unused void pd_set_dfp_enter_mode_flag(int port, bool set)
@@ -4980,11 +5442,6 @@ uint32_t pe_get_flags(int port)
 }
 
 static __const_data const struct usb_state pe_states[] = {
-/* Super States */
-	[PE_PRS_FRS_SHARED] = {
-		.entry = pe_prs_frs_shared_entry,
-		.exit  = pe_prs_frs_shared_exit,
-	},
 	[PE_SNK_STARTUP] = {
 		.entry = pe_snk_startup_entry,
 		.run = pe_snk_startup_run,
@@ -5045,6 +5502,62 @@ static __const_data const struct usb_state pe_states[] = {
 		.entry = pe_send_not_supported_entry,
 		.run = pe_send_not_supported_run,
 	},
+	[PE_WAIT_FOR_ERROR_RECOVERY] = {
+		.entry = pe_wait_for_error_recovery_entry,
+		.run   = pe_wait_for_error_recovery_run,
+	},
+	[PE_GET_REVISION] = {
+		.entry = pe_get_revision_entry,
+		.run   = pe_get_revision_run,
+		.exit  = pe_get_revision_exit,
+	},
+	[PE_SNK_GET_PPS_STATUS] = {
+		.entry = pe_snk_get_pps_status_entry,
+		.run   = pe_snk_get_pps_status_run,
+		.exit  = pe_snk_get_pps_status_exit,
+	},
+	[PE_SNK_GET_SOURCE_CAP_EXT] = {
+		.entry = pe_snk_get_source_cap_ext_entry,
+		.run   = pe_snk_get_source_cap_ext_run,
+		.exit  = pe_snk_get_source_cap_ext_exit,
+	},
+	[PE_GET_STATUS] = {
+		.entry = pe_get_status_entry,
+		.run   = pe_get_status_run,
+		.exit  = pe_get_status_exit,
+	},
+	[PE_SNK_CHUNK_RECEIVED] = {
+		.entry = pe_chunk_received_entry,
+		.run   = pe_chunk_received_run,
+		.exit  = pe_chunk_received_exit,
+	},
+	[PE_SNK_EPR_KEEP_ALIVE] = {
+		.entry = pe_snk_epr_keep_alive_entry,
+		.run = pe_snk_epr_keep_alive_run,
+	},
+	[PE_SNK_SEND_EPR_MODE_ENTRY] = {
+		.entry = pe_snk_send_epr_mode_entry_entry,
+		.run = pe_snk_send_epr_mode_entry_run,
+		.exit = pe_snk_send_epr_mode_entry_exit,
+	},
+	[PE_SNK_EPR_MODE_ENTRY_WAIT_FOR_RESPONSE] = {
+		.entry = pe_snk_epr_mode_entry_wait_for_response_entry,
+		.run = pe_snk_epr_mode_entry_wait_for_response_run,
+		.exit = pe_snk_epr_mode_entry_wait_for_response_exit,
+	},
+	[PE_SNK_SEND_EPR_MODE_EXIT] = {
+		.entry = pe_snk_send_epr_mode_exit_entry,
+		.run = pe_snk_send_epr_mode_exit_run,
+	},
+	[PE_SNK_EPR_MODE_EXIT_RECEIVED] = {
+		.entry = pe_snk_epr_mode_exit_received_entry,
+	},
+#ifndef CONFIG_PD_SINK_ONLY
+/* Super States */
+	[PE_PRS_FRS_SHARED] = {
+		.entry = pe_prs_frs_shared_entry,
+		.exit  = pe_prs_frs_shared_exit,
+	},
 	[PE_SRC_PING] = {
 		.entry = pe_src_ping_entry,
 		.run   = pe_src_ping_run,
@@ -5099,12 +5612,14 @@ static __const_data const struct usb_state pe_states[] = {
 		.run   = pe_prs_snk_src_transition_to_off_run,
 		.exit  = pe_prs_snk_src_transition_to_off_exit,
 		.parent = &pe_states[PE_PRS_FRS_SHARED],
+		.depth = 1,
 	},
 	/* State actions are shared with PE_FRS_SNK_SRC_ASSERT_RP */
 	[PE_PRS_SNK_SRC_ASSERT_RP] = {
 		.entry = pe_prs_snk_src_assert_rp_entry,
 		.run   = pe_prs_snk_src_assert_rp_run,
 		.parent = &pe_states[PE_PRS_FRS_SHARED],
+		.depth = 1,
 	},
 	/* State actions are shared with PE_FRS_SNK_SRC_SOURCE_ON */
 	[PE_PRS_SNK_SRC_SOURCE_ON] = {
@@ -5112,6 +5627,7 @@ static __const_data const struct usb_state pe_states[] = {
 		.run   = pe_prs_snk_src_source_on_run,
 		.exit  = pe_prs_snk_src_source_on_exit,
 		.parent = &pe_states[PE_PRS_FRS_SHARED],
+		.depth = 1,
 	},
 	/* State actions are shared with PE_FRS_SNK_SRC_SEND_SWAP */
 	[PE_PRS_SNK_SRC_SEND_SWAP] = {
@@ -5119,21 +5635,23 @@ static __const_data const struct usb_state pe_states[] = {
 		.run   = pe_prs_snk_src_send_swap_run,
 		.exit  = pe_prs_snk_src_send_swap_exit,
 		.parent = &pe_states[PE_PRS_FRS_SHARED],
+		.depth = 1,
 	},
-	[PE_DEU_SEND_ENTER_USB] = {
-		.entry = pe_enter_usb_entry,
-		.run = pe_enter_usb_run,
-		.exit = pe_enter_usb_exit,
-	},
-	[PE_WAIT_FOR_ERROR_RECOVERY] = {
-		.entry = pe_wait_for_error_recovery_entry,
-		.run   = pe_wait_for_error_recovery_run,
+	[PE_FRS_SNK_SRC_START_AMS] = {
+		.entry = pe_frs_snk_src_start_ams_entry,
+		.parent = &pe_states[PE_PRS_FRS_SHARED],
+		.depth = 1,
 	},
 	[PE_BIST_TX] = {
 		.entry = pe_bist_tx_entry,
 		.run   = pe_bist_tx_run,
 		.exit  = pe_bist_tx_exit,
 	},
+	[PE_DEU_SEND_ENTER_USB] = {
+		.entry = pe_enter_usb_entry,
+		.run = pe_enter_usb_run,
+		.exit = pe_enter_usb_exit,
+	},
 	[PE_DR_GET_SINK_CAP] = {
 		.entry = pe_dr_get_sink_cap_entry,
 		.run   = pe_dr_get_sink_cap_run,
@@ -5148,47 +5666,21 @@ static __const_data const struct usb_state pe_states[] = {
 		.run   = pe_dr_src_get_source_cap_run,
 		.exit  = pe_dr_src_get_source_cap_exit,
 	},
-	[PE_FRS_SNK_SRC_START_AMS] = {
-		.entry = pe_frs_snk_src_start_ams_entry,
-		.parent = &pe_states[PE_PRS_FRS_SHARED],
-	},
-	[PE_GET_REVISION] = {
-		.entry = pe_get_revision_entry,
-		.run   = pe_get_revision_run,
-		.exit  = pe_get_revision_exit,
-	},
 	[PE_SRC_CHUNK_RECEIVED] = {
 		.entry = pe_chunk_received_entry,
 		.run   = pe_chunk_received_run,
 		.exit  = pe_chunk_received_exit,
 	},
-	[PE_SNK_CHUNK_RECEIVED] = {
-		.entry = pe_chunk_received_entry,
-		.run   = pe_chunk_received_run,
-		.exit  = pe_chunk_received_exit,
-	},
-	[PE_SNK_EPR_KEEP_ALIVE] = {
-		.entry = pe_snk_epr_keep_alive_entry,
-		.run = pe_snk_epr_keep_alive_run,
-	},
-	[PE_SNK_SEND_EPR_MODE_ENTRY] = {
-		.entry = pe_snk_send_epr_mode_entry_entry,
-		.run = pe_snk_send_epr_mode_entry_run,
-		.exit = pe_snk_send_epr_mode_entry_exit,
-	},
-	[PE_SNK_EPR_MODE_ENTRY_WAIT_FOR_RESPONSE] = {
-		.entry = pe_snk_epr_mode_entry_wait_for_response_entry,
-		.run = pe_snk_epr_mode_entry_wait_for_response_run,
-		.exit = pe_snk_epr_mode_entry_wait_for_response_exit,
-	},
-	[PE_SNK_SEND_EPR_MODE_EXIT] = {
-		.entry = pe_snk_send_epr_mode_exit_entry,
-		.run = pe_snk_send_epr_mode_exit_run,
-	},
-	[PE_SNK_EPR_MODE_EXIT_RECEIVED] = {
-		.entry = pe_snk_epr_mode_exit_received_entry,
-	},
+#endif /* CONFIG_PD_SINK_ONLY */
 };
+/* Target states of snk_ready_rx[] must fit uint8_t */
+BUILD_ASSERT(ARRAY_SIZE(pe_states) <= UINT8_MAX - SNK_RX_STATE);
+/* States below PE_NOT_PORTED_FIRST are built, or never link */
+#ifdef CONFIG_PD_SINK_ONLY
+BUILD_ASSERT(ARRAY_SIZE(pe_states) == PE_SNK_EPR_MODE_EXIT_RECEIVED + 1);
+#else
+BUILD_ASSERT(ARRAY_SIZE(pe_states) == PE_NOT_PORTED_FIRST);
+#endif
 
 #ifdef TEST_BUILD
 /* TODO(b/173791979): Unit tests shouldn't need to access internal states */
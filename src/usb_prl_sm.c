@@ -10,6 +10,8 @@
 #include "cros_version.h"
 #include "gpio.h"
 #include "host_command.h"
+#include "pd_capture.h"
+#include "pd_port_arena.h"
 #include "registers.h"
 #include "usb_charge.h"
 #include "usb_emsg.h"
@@ -22,6 +24,8 @@
 #include "util.h"
 #include "vpd_api.h"
 
+#include <stdatomic.h>
+
 #define CPRINTF(format, args...)
 #define CPRINTS(format, args...)
 
@@ -30,49 +34,65 @@
  */
 #undef DEBUG_PRINT_FLAG_NAMES
 
+/*
+ * All flags below are read and written by the event loop only. TCPC alert
+ * handlers (pd_transmit_complete(), pd_execute_hard_reset()) store into
+ * dedicated fields instead, so plain read-modify-write is enough in the
+ * single context build.
+ */
+#ifdef CONFIG_USB_PD_SINGLE_CONTEXT_FLAGS
+#define FLAG_OR(flags, flag) (*(flags) |= (flag))
+#define FLAG_CLEAR_BITS(flags, flag) (*(flags) &= ~(flag))
+#else
+#define FLAG_OR(flags, flag) atomic_or(flags, (flag))
+#define FLAG_CLEAR_BITS(flags, flag) atomic_clear_bits(flags, (flag))
+#endif
+
 #ifdef DEBUG_PRINT_FLAG_NAMES
 __maybe_unused static void print_flag(const char *group, int set_or_clear,
 				      int flag);
 #define SET_FLAG(group, flags, flag)        \
 	do {                                \
 		print_flag(group, 1, flag); \
-		atomic_or(flags, (flag));   \
+		FLAG_OR(flags, (flag));     \
 	} while (0)
 #define CLR_FLAG(group, flags, flag)                \
 	do {                                        \
 		int before = *flags;                \
-		atomic_clear_bits(flags, (flag));   \
+		FLAG_CLEAR_BITS(flags, (flag));     \
 		if (*flags != before)               \
 			print_flag(group, 0, flag); \
 	} while (0)
 #else
-#define SET_FLAG(group, flags, flag) atomic_or(flags, (flag))
-#define CLR_FLAG(group, flags, flag) atomic_clear_bits(flags, (flag))
+#define SET_FLAG(group, flags, flag) FLAG_OR(flags, (flag))
+#define CLR_FLAG(group, flags, flag) FLAG_CLEAR_BITS(flags, (flag))
 #endif
 
-#define RCH_SET_FLAG(port, flag) SET_FLAG("RCH", &rch[port].flags, (flag))
-#define RCH_CLR_FLAG(port, flag) CLR_FLAG("RCH", &rch[port].flags, (flag))
-#define RCH_CHK_FLAG(port, flag) (rch[port].flags & (flag))
+#define RCH_SET_FLAG(port, flag) SET_FLAG("RCH", &prl[port].rch.flags, (flag))
+#define RCH_CLR_FLAG(port, flag) CLR_FLAG("RCH", &prl[port].rch.flags, (flag))
+#define RCH_CHK_FLAG(port, flag) (prl[port].rch.flags & (flag))
 
-#define TCH_SET_FLAG(port, flag) SET_FLAG("TCH", &tch[port].flags, (flag))
-#define TCH_CLR_FLAG(port, flag) CLR_FLAG("TCH", &tch[port].flags, (flag))
-#define TCH_CHK_FLAG(port, flag) (tch[port].flags & (flag))
+#define TCH_SET_FLAG(port, flag) SET_FLAG("TCH", &prl[port].tch.flags, (flag))
+#define TCH_CLR_FLAG(port, flag) CLR_FLAG("TCH", &prl[port].tch.flags, (flag))
+#define TCH_CHK_FLAG(port, flag) (prl[port].tch.flags & (flag))
 
 #define PRL_TX_SET_FLAG(port, flag) \
-	SET_FLAG("PRL_TX", &prl_tx[port].flags, (flag))
+	SET_FLAG("PRL_TX", &prl[port].tx.flags, (flag))
 #define PRL_TX_CLR_FLAG(port, flag) \
-	CLR_FLAG("PRL_TX", &prl_tx[port].flags, (flag))
-#define PRL_TX_CHK_FLAG(port, flag) (prl_tx[port].flags & (flag))
+	CLR_FLAG("PRL_TX", &prl[port].tx.flags, (flag))
+#define PRL_TX_CHK_FLAG(port, flag) (prl[port].tx.flags & (flag))
 
 #define PRL_HR_SET_FLAG(port, flag) \
-	SET_FLAG("PRL_HR", &prl_hr[port].flags, (flag))
+	SET_FLAG("PRL_HR", &prl[port].hr.flags, (flag))
 #define PRL_HR_CLR_FLAG(port, flag) \
-	CLR_FLAG("PRL_HR", &prl_hr[port].flags, (flag))
-#define PRL_HR_CHK_FLAG(port, flag) (prl_hr[port].flags & (flag))
+	CLR_FLAG("PRL_HR", &prl[port].hr.flags, (flag))
+#define PRL_HR_CHK_FLAG(port, flag) (prl[port].hr.flags & (flag))
 
-#define PDMSG_SET_FLAG(port, flag) SET_FLAG("PDMSG", &pdmsg[port].flags, (flag))
-#define PDMSG_CLR_FLAG(port, flag) CLR_FLAG("PDMSG", &pdmsg[port].flags, (flag))
-#define PDMSG_CHK_FLAG(port, flag) (pdmsg[port].flags & (flag))
+#define PDMSG_SET_FLAG(port, flag) \
+	SET_FLAG("PDMSG", &prl[port].msg.flags, (flag))
+#define PDMSG_CLR_FLAG(port, flag) \
+	CLR_FLAG("PDMSG", &prl[port].msg.flags, (flag))
+#define PDMSG_CHK_FLAG(port, flag) (prl[port].msg.flags & (flag))
 
 /* Protocol Layer Flags */
 /*
@@ -164,6 +184,13 @@ __maybe_unused static void print_flag(const char *group, int set_or_clear,
 #define CHK_BUF_SIZE 7
 #define CHK_BUF_SIZE_BYTES 28
 
+/* Size of extended messages reassembly buffer, in 32-bit words */
+#ifdef CONFIG_USB_PD_EXTENDED_MESSAGES
+#define RX_EXT_BUF_SIZE DIV_ROUND_UP(EXTENDED_BUFFER_SIZE, 4)
+#else
+#define RX_EXT_BUF_SIZE 0
+#endif
+
 /*
  * Debug log level - higher number == more log
  *   Level 0: disabled
@@ -182,7 +209,7 @@ static enum debug_level prl_debug_level = CONFIG_USB_PD_INITIAL_DEBUG_LEVEL;
 static enum debug_level prl_debug_level = DEBUG_LEVEL_1;
 #endif
 
-static enum sm_local_state local_state[CONFIG_USB_PD_PORT_MAX_COUNT];
+static enum sm_local_state PD_PORT_DATA(local_state);
 
 /* Protocol Transmit States (Section 6.11.2.2) */
 enum usb_prl_tx_state {
@@ -279,35 +306,37 @@ __maybe_unused static const struct usb_state rch_states[];
 __maybe_unused static const struct usb_state tch_states[];
 
 /* Chunked Rx State Machine Object */
-static struct rx_chunked {
+struct rx_chunked {
 	/* state machine context */
 	struct sm_ctx ctx;
 	/* PRL_FLAGS */
 	atomic_t flags;
 	/* error to report when moving to rch_report_error state */
 	enum pe_error error;
-} rch[CONFIG_USB_PD_PORT_MAX_COUNT];
+};
 
 /* Chunked Tx State Machine Object */
-static struct tx_chunked {
+struct tx_chunked {
 	/* state machine context */
 	struct sm_ctx ctx;
 	/* state machine flags */
 	atomic_t flags;
 	/* error to report when moving to tch_report_error state */
 	enum pe_error error;
-} tch[CONFIG_USB_PD_PORT_MAX_COUNT];
+};
 
 /* Message Reception State Machine Object */
-static struct protocol_layer_rx {
+struct protocol_layer_rx {
 	/* received message type */
 	enum tcpci_msg_type sop;
 	/* message ids for all valid port partners */
 	int msg_id[NUM_SOP_STAR_TYPES];
-} prl_rx[CONFIG_USB_PD_PORT_MAX_COUNT];
+	/* TCPM RX slot, referenced by rx_emsg, is not released yet */
+	bool held;
+};
 
 /* Message Transmission State Machine Object */
-static struct protocol_layer_tx {
+struct protocol_layer_tx {
 	/* state machine context */
 	struct sm_ctx ctx;
 	/* state machine flags */
@@ -318,18 +347,20 @@ static struct protocol_layer_tx {
 	uint32_t msg_id_counter[NUM_SOP_STAR_TYPES];
 	/* transmit status */
 	int xmit_status;
-} prl_tx[CONFIG_USB_PD_PORT_MAX_COUNT];
+};
 
 /* Hard Reset State Machine Object */
-static struct protocol_hard_reset {
+struct protocol_hard_reset {
 	/* state machine context */
 	struct sm_ctx ctx;
 	/* state machine flags */
 	atomic_t flags;
-} prl_hr[CONFIG_USB_PD_PORT_MAX_COUNT];
+	/* Hard Reset received, set by TCPC alert and consumed by prl_run */
+	atomic_bool partner_hard_reset;
+};
 
 /* Chunking Message Object */
-static struct pd_message {
+struct pd_message {
 	/* message status flags */
 	atomic_t flags;
 	/* SOP* */
@@ -338,17 +369,47 @@ static struct pd_message {
 	uint8_t msg_type;
 	/* PD revision */
 	enum pd_rev_type rev[NUM_SOP_STAR_TYPES];
+	/* extended message */
+	uint8_t ext;
+	/* Unchunked extended messages negotiated with SOP partner */
+	bool unchunked;
 	/* Number of 32-bit objects in chk_buf */
 	uint16_t data_objs;
-	/* temp chunk buffer */
+	/*
+	 * TX buffer of all messages, used when TCPC driver does not provide
+	 * its own, see tcpm_get_tx_buf()
+	 */
 	uint32_t tx_chk_buf[CHK_BUF_SIZE];
-	uint32_t rx_chk_buf[CHK_BUF_SIZE];
+	/* Payload of the last received packet, in TCPM RX slot */
+	const uint32_t *rx_chk_buf;
 	uint32_t chunk_number_expected;
 	uint32_t num_bytes_received;
-} pdmsg[CONFIG_USB_PD_PORT_MAX_COUNT];
+	uint32_t chunk_number_to_send;
+	uint32_t send_offset;
+};
 
-struct extended_msg rx_emsg[CONFIG_USB_PD_PORT_MAX_COUNT];
-struct extended_msg tx_emsg[CONFIG_USB_PD_PORT_MAX_COUNT];
+/*
+ * All state machines of one port, contiguous. prl_run() walks them in
+ * this order on each pass.
+ */
+static struct protocol_layer {
+	struct protocol_layer_tx tx;
+	struct protocol_hard_reset hr;
+	struct rx_chunked rch;
+	struct tx_chunked tch;
+	struct protocol_layer_rx rx;
+	struct pd_message msg;
+} PD_PORT_DATA(prl);
+
+/* Extended messages reassembly buffer, used by chunking only */
+static struct protocol_layer_buf {
+	uint32_t rx_ext_buf[RX_EXT_BUF_SIZE];
+	/* Extended messages passed up without payload */
+	uint32_t rx_too_long;
+} PD_PORT_DATA(prl_buf) __pd_cold_data;
+
+struct rx_msg PD_PORT_DATA(rx_emsg);
+struct tx_msg PD_PORT_DATA(tx_emsg);
 
 enum prl_event_log_state_kind {
 	/* Identifies uninitialized entries */
@@ -365,23 +426,36 @@ prl_event_log_append(enum prl_event_log_state_kind kind, int port);
 /* Common Protocol Layer Message Transmission */
 static void prl_tx_construct_message(int port);
 static void prl_rx_wait_for_phy_message(const int port, int evt);
-static void prl_copy_msg_to_buffer(int port);
+static void prl_pad_msg_buffer(int port);
+static void rx_release(int port);
 
 
 /* To store the time stamp when TCPC sets TX Complete Success */
-static timestamp_t tcpc_tx_success_ts[CONFIG_USB_PD_PORT_MAX_COUNT];
+static timestamp_t PD_PORT_DATA(tcpc_tx_success_ts);
+
+#ifdef CONFIG_PD_PORT_ARENA
+void prl_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(local_state, count);
+	PD_PORT_DATA_TAKE(prl, count);
+	PD_PORT_DATA_TAKE(prl_buf, count);
+	PD_PORT_DATA_TAKE(rx_emsg, count);
+	PD_PORT_DATA_TAKE(tx_emsg, count);
+	PD_PORT_DATA_TAKE(tcpc_tx_success_ts, count);
+}
+#endif
 
 /* Set the protocol transmit statemachine to a new state. */
 static void set_state_prl_tx(const int port,
 			     const enum usb_prl_tx_state new_state)
 {
-	set_state(port, &prl_tx[port].ctx, &prl_tx_states[new_state]);
+	set_state(port, &prl[port].tx.ctx, &prl_tx_states[new_state]);
 }
 
 /* Get the protocol transmit statemachine's current state. */
 test_export_static enum usb_prl_tx_state prl_tx_get_state(const int port)
 {
-	return prl_tx[port].ctx.current - &prl_tx_states[0];
+	return prl[port].tx.ctx.current - &prl_tx_states[0];
 }
 
 /* Print the protocol transmit statemachine's current state. */
@@ -397,13 +471,13 @@ static void print_current_prl_tx_state(const int port)
 static void set_state_prl_hr(const int port,
 			     const enum usb_prl_hr_state new_state)
 {
-	set_state(port, &prl_hr[port].ctx, &prl_hr_states[new_state]);
+	set_state(port, &prl[port].hr.ctx, &prl_hr_states[new_state]);
 }
 
 /* Get the hard reset statemachine's current state. */
 enum usb_prl_hr_state prl_hr_get_state(const int port)
 {
-	return prl_hr[port].ctx.current - &prl_hr_states[0];
+	return prl[port].hr.ctx.current - &prl_hr_states[0];
 }
 
 /* Print the hard reset statemachine's current state. */
@@ -419,26 +493,49 @@ static void print_current_prl_hr_state(const int port)
 static void set_state_rch(const int port, const enum usb_rch_state new_state)
 {
 	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
-		set_state(port, &rch[port].ctx, &rch_states[new_state]);
+		set_state(port, &prl[port].rch.ctx, &rch_states[new_state]);
+}
+
+/* Get the chunked Rx statemachine's current state. */
+test_export_static enum usb_rch_state rch_get_state(const int port)
+{
+	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
+		return prl[port].rch.ctx.current - &rch_states[0];
+	else
+		return 0;
 }
 
+/* Print the chunked Rx statemachine's current state. */
+static void print_current_rch_state(const int port)
+{
+	prl_event_log_append(PRL_EVENT_LOG_STATE_RCH, port);
+	if (prl_debug_level >= DEBUG_LEVEL_3)
+		CPRINTS("C%d: %s", port, rch_state_names[rch_get_state(port)]);
+}
 
 /* Set the chunked Tx statemachine to a new state. */
 static void set_state_tch(const int port, const enum usb_tch_state new_state)
 {
 	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
-		set_state(port, &tch[port].ctx, &tch_states[new_state]);
+		set_state(port, &prl[port].tch.ctx, &tch_states[new_state]);
 }
 
 /* Get the chunked Tx statemachine's current state. */
 test_export_static enum usb_tch_state tch_get_state(const int port)
 {
 	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
-		return tch[port].ctx.current - &tch_states[0];
+		return prl[port].tch.ctx.current - &tch_states[0];
 	else
 		return 0;
 }
 
+/* Print the chunked Tx statemachine's current state. */
+static void print_current_tch_state(const int port)
+{
+	prl_event_log_append(PRL_EVENT_LOG_STATE_TCH, port);
+	if (prl_debug_level >= DEBUG_LEVEL_3)
+		CPRINTS("C%d: %s", port, tch_state_names[tch_get_state(port)]);
+}
 
 timestamp_t prl_get_tcpc_tx_success_ts(int port)
 {
@@ -455,7 +552,8 @@ void pd_transmit_complete(int port, int status)
 {
 	if (status == TCPC_TX_COMPLETE_SUCCESS)
 		set_tcpc_tx_success_ts(port);
-	prl_tx[port].xmit_status = status;
+	pd_capture_tx_status(port, status);
+	prl[port].tx.xmit_status = status;
 }
 
 void pd_execute_hard_reset(int port)
@@ -464,8 +562,11 @@ void pd_execute_hard_reset(int port)
 	if (!prl_is_running(port))
 		return;
 
-	PRL_HR_SET_FLAG(port, PRL_FLAGS_PORT_PARTNER_HARD_RESET);
-	set_state_prl_hr(port, PRL_HR_RESET_LAYER);
+	/*
+	 * Called from TCPC alert, which may interrupt the event loop. Leave
+	 * the state transition to prl_run().
+	 */
+	atomic_store(&prl[port].hr.partner_hard_reset, true);
 	pd_loop_wake(port);
 }
 
@@ -502,45 +603,77 @@ static void prl_init(int port)
 	 * flags without PRL_FLAGS_SINK_NG present means we are initially
 	 * in SinkTxOK state
 	 */
-	prl_tx[port].flags = 0;
+	prl[port].tx.flags = 0;
 	if (IS_ENABLED(CONFIG_USB_PD_REV30))
 		typec_select_src_collision_rp(port, SINK_TX_OK);
-	prl_tx[port].last_xmit_type = TCPCI_MSG_SOP;
-	prl_tx[port].xmit_status = TCPC_TX_UNSET;
+	prl[port].tx.last_xmit_type = TCPCI_MSG_SOP;
+	prl[port].tx.xmit_status = TCPC_TX_UNSET;
 
 	if (IS_ENABLED(CONFIG_USB_PD_REV30)) {
-		tch[port].flags = 0;
-		rch[port].flags = 0;
+		prl[port].tch.flags = 0;
+		prl[port].rch.flags = 0;
 	}
 
-	pdmsg[port].flags = 0;
+	prl[port].msg.flags = 0;
+	prl[port].msg.unchunked = false;
+
+	/* Let PE build messages right in the TCPC driver TX buffer */
+	tx_emsg[port].buf = (uint8_t *)tcpm_get_tx_buf(port);
+	if (!tx_emsg[port].buf)
+		tx_emsg[port].buf = (uint8_t *)prl[port].msg.tx_chk_buf;
 
-	prl_hr[port].flags = 0;
+	prl[port].hr.flags = 0;
 
 	for (i = 0; i < NUM_SOP_STAR_TYPES; i++)
 		prl_reset_msg_ids(port, i);
 
 	pd_timer_disable_range(port, PR_TIMER_RANGE);
 
+	rx_release(port);
+
 	/* Clear state machines and set initial states */
-	prl_tx[port].ctx = cleared;
+	prl[port].tx.ctx = cleared;
+	usb_sm_trace_register(&prl[port].tx.ctx, USB_SM_PRL_TX, prl_tx_states,
+			      ARRAY_SIZE(prl_tx_state_names));
 	set_state_prl_tx(port, PRL_TX_PHY_LAYER_RESET);
 
 	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)) {
-		rch[port].ctx = cleared;
+		prl[port].rch.ctx = cleared;
+		usb_sm_trace_register(&prl[port].rch.ctx, USB_SM_RCH,
+				      rch_states, ARRAY_SIZE(rch_state_names));
 		set_state_rch(port, RCH_WAIT_FOR_MESSAGE_FROM_PROTOCOL_LAYER);
 
-		tch[port].ctx = cleared;
+		prl[port].tch.ctx = cleared;
+		usb_sm_trace_register(&prl[port].tch.ctx, USB_SM_TCH,
+				      tch_states, ARRAY_SIZE(tch_state_names));
 		set_state_tch(port, TCH_WAIT_FOR_MESSAGE_REQUEST_FROM_PE);
 	}
 
-	prl_hr[port].ctx = cleared;
+	prl[port].hr.ctx = cleared;
+	usb_sm_trace_register(&prl[port].hr.ctx, USB_SM_PRL_HR, prl_hr_states,
+			      ARRAY_SIZE(prl_hr_state_names));
 	set_state_prl_hr(port, PRL_HR_WAIT_FOR_REQUEST);
 }
 
 bool prl_is_busy(int port)
 {
-	return false;
+	if (!IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
+		return false;
+
+	return rch_get_state(port) !=
+		       RCH_WAIT_FOR_MESSAGE_FROM_PROTOCOL_LAYER ||
+	       tch_get_state(port) != TCH_WAIT_FOR_MESSAGE_REQUEST_FROM_PE;
+}
+
+void prl_set_unchunked_ext(int port, bool enable)
+{
+	prl[port].msg.unchunked =
+		IS_ENABLED(CONFIG_USB_PD_EXTENDED_UNCHUNKED) && enable;
+}
+
+uint32_t prl_get_ext_rx_too_long(int port)
+{
+	return prl_buf[port].rx_too_long;
 }
 
 void prl_set_debug_level(enum debug_level debug_level)
@@ -559,12 +692,16 @@ void prl_hard_reset_complete(int port)
 void prl_send_ctrl_msg(int port, enum tcpci_msg_type type,
 		       enum pd_ctrl_msg_type msg)
 {
-	pdmsg[port].xmit_type = type;
-	pdmsg[port].msg_type = msg;
-	pdmsg[port].data_objs = 0;
+	prl[port].msg.xmit_type = type;
+	prl[port].msg.msg_type = msg;
+	prl[port].msg.ext = 0;
+	prl[port].msg.data_objs = 0;
 	tx_emsg[port].len = 0;
 
-	PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
+		TCH_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+	else
+		PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
 
 	pd_loop_wake(port);
 }
@@ -572,11 +709,32 @@ void prl_send_ctrl_msg(int port, enum tcpci_msg_type type,
 void prl_send_data_msg(int port, enum tcpci_msg_type type,
 		       enum pd_data_msg_type msg)
 {
-	pdmsg[port].xmit_type = type;
-	pdmsg[port].msg_type = msg;
+	prl[port].msg.xmit_type = type;
+	prl[port].msg.msg_type = msg;
+	prl[port].msg.ext = 0;
 
-	prl_copy_msg_to_buffer(port);
-	PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)) {
+		/* Padding is done by TCH, on pass down */
+		TCH_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+	} else {
+		prl_pad_msg_buffer(port);
+		PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+	}
+
+	pd_loop_wake(port);
+}
+
+void prl_send_ext_data_msg(int port, enum tcpci_msg_type type,
+			   enum pd_ext_msg_type msg)
+{
+	if (!IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
+		return;
+
+	prl[port].msg.xmit_type = type;
+	prl[port].msg.msg_type = msg;
+	prl[port].msg.ext = 1;
+
+	TCH_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
 
 	pd_loop_wake(port);
 }
@@ -589,11 +747,11 @@ void prl_set_default_pd_revision(int port)
 	 * partner doesn't support this revision, the Protocol Engine will
 	 * lower this value to the revision supported by the partner.
 	 */
-	pdmsg[port].rev[TCPCI_MSG_SOP] = PD_REVISION;
-	pdmsg[port].rev[TCPCI_MSG_SOP_PRIME] = PD_REVISION;
-	pdmsg[port].rev[TCPCI_MSG_SOP_PRIME_PRIME] = PD_REVISION;
-	pdmsg[port].rev[TCPCI_MSG_SOP_DEBUG_PRIME] = PD_REVISION;
-	pdmsg[port].rev[TCPCI_MSG_SOP_DEBUG_PRIME_PRIME] = PD_REVISION;
+	prl[port].msg.rev[TCPCI_MSG_SOP] = PD_REVISION;
+	prl[port].msg.rev[TCPCI_MSG_SOP_PRIME] = PD_REVISION;
+	prl[port].msg.rev[TCPCI_MSG_SOP_PRIME_PRIME] = PD_REVISION;
+	prl[port].msg.rev[TCPCI_MSG_SOP_DEBUG_PRIME] = PD_REVISION;
+	prl[port].msg.rev[TCPCI_MSG_SOP_DEBUG_PRIME_PRIME] = PD_REVISION;
 }
 
 void prl_reset_soft(int port)
@@ -625,12 +783,20 @@ void prl_run(int port, int evt, int en)
 			else
 				tcpm_set_rx_enable(port, 0);
 
+			/* Nothing to reset while paused */
+			atomic_store(&prl[port].hr.partner_hard_reset, false);
 			local_state[port] = SM_PAUSED;
 			break;
 		}
 
+		if (atomic_exchange(&prl[port].hr.partner_hard_reset, false)) {
+			PRL_HR_SET_FLAG(port,
+					PRL_FLAGS_PORT_PARTNER_HARD_RESET);
+			set_state_prl_hr(port, PRL_HR_RESET_LAYER);
+		}
+
 		/* Run Protocol Layer Hard Reset state machine */
-		run_state(port, &prl_hr[port].ctx);
+		run_state(port, &prl[port].hr.ctx);
 
 		/*
 		 * If the Hard Reset state machine is active, then there is no
@@ -648,18 +814,18 @@ void prl_run(int port, int evt, int en)
 				 * This is what informs the PE of incoming
 				 * message. Its input is prl_rx
 				 */
-				run_state(port, &rch[port].ctx);
+				run_state(port, &prl[port].rch.ctx);
 
 				/*
 				 * Run TX Chunked state machine before prl_tx
 				 * in case we need to split an extended message
 				 * and prl_tx can send it for us
 				 */
-				run_state(port, &tch[port].ctx);
+				run_state(port, &prl[port].tch.ctx);
 			}
 
 			/* Run Protocol Layer Message Tx state machine */
-			run_state(port, &prl_tx[port].ctx);
+			run_state(port, &prl[port].tx.ctx);
 
 			if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES))
 				/*
@@ -667,7 +833,7 @@ void prl_run(int port, int evt, int en)
 				 * prl_tx so we can handle passing TX_COMPLETE
 				 * (or failure) up to PE in a single iteration.
 				 */
-				run_state(port, &tch[port].ctx);
+				run_state(port, &prl[port].tch.ctx);
 		}
 		break;
 	}
@@ -678,7 +844,7 @@ void prl_set_rev(int port, enum tcpci_msg_type type, enum pd_rev_type rev)
 	/* We only store revisions for SOP* types. */
 	ASSERT(type < NUM_SOP_STAR_TYPES);
 
-	pdmsg[port].rev[type] = rev;
+	prl[port].msg.rev[type] = rev;
 }
 
 enum pd_rev_type prl_get_rev(int port, enum tcpci_msg_type type)
@@ -686,24 +852,24 @@ enum pd_rev_type prl_get_rev(int port, enum tcpci_msg_type type)
 	/* We only store revisions for SOP* types. */
 	ASSERT(type < NUM_SOP_STAR_TYPES);
 
-	return pdmsg[port].rev[type];
+	return prl[port].msg.rev[type];
 }
 
 void prl_reset_msg_ids(int port, enum tcpci_msg_type type)
 {
-	prl_tx[port].msg_id_counter[type] = 0;
-	prl_rx[port].msg_id[type] = -1;
+	prl[port].tx.msg_id_counter[type] = 0;
+	prl[port].rx.msg_id[type] = -1;
 }
 
-static void prl_copy_msg_to_buffer(int port)
+static void prl_pad_msg_buffer(int port)
 {
 	/*
 	 * Control Messages will have a length of 0 and
-	 * no need to spend time with the tx_chk_buf
+	 * no need to spend time with the buffer
 	 * for this path
 	 */
 	if (tx_emsg[port].len == 0) {
-		pdmsg[port].data_objs = 0;
+		prl[port].msg.data_objs = 0;
 		return;
 	}
 
@@ -717,10 +883,12 @@ static void prl_copy_msg_to_buffer(int port)
 	if (tx_emsg[port].len > CHK_BUF_SIZE_BYTES)
 		tx_emsg[port].len = CHK_BUF_SIZE_BYTES;
 
-	/* Copy message to chunked buffer */
-	memset((uint8_t *)pdmsg[port].tx_chk_buf, 0, CHK_BUF_SIZE_BYTES);
-	memcpy((uint8_t *)pdmsg[port].tx_chk_buf, (uint8_t *)tx_emsg[port].buf,
-	       tx_emsg[port].len);
+	/*
+	 * Message is already built in place, only zero the
+	 * padding of the last data object.
+	 */
+	memset(tx_emsg[port].buf + tx_emsg[port].len, 0,
+	       -tx_emsg[port].len & 3);
 	/*
 	 * Pad length to 4-byte boundary and
 	 * convert to number of 32-bit objects.
@@ -728,14 +896,15 @@ static void prl_copy_msg_to_buffer(int port)
 	 * no need to explicitly clear the lower
 	 * 2-bits.
 	 */
-	pdmsg[port].data_objs = (tx_emsg[port].len + 3) >> 2;
+	prl[port].msg.data_objs = (tx_emsg[port].len + 3) >> 2;
 }
 
 static __maybe_unused int pdmsg_xmit_type_is_rev30(const int port)
 {
 	if (IS_ENABLED(CONFIG_USB_PD_REV30))
-		return ((pdmsg[port].xmit_type < NUM_SOP_STAR_TYPES) &&
-			(prl_get_rev(port, pdmsg[port].xmit_type) == PD_REV30));
+		return ((prl[port].msg.xmit_type < NUM_SOP_STAR_TYPES) &&
+			(prl_get_rev(port, prl[port].msg.xmit_type) ==
+			 PD_REV30));
 	else
 		return 0;
 }
@@ -765,7 +934,7 @@ static void prl_tx_phy_layer_reset_entry(const int port)
 static void prl_tx_wait_for_message_request_entry(const int port)
 {
 	/* No phy layer response is pending */
-	prl_tx[port].xmit_status = TCPC_TX_UNSET;
+	prl[port].tx.xmit_status = TCPC_TX_UNSET;
 	print_current_prl_tx_state(port);
 }
 
@@ -819,7 +988,7 @@ static void prl_tx_wait_for_message_request_run(const int port)
 		/*
 		 * Soft Reset Message Message pending
 		 */
-		if ((pdmsg[port].msg_type == PD_CTRL_SOFT_RESET) &&
+		if ((prl[port].msg.msg_type == PD_CTRL_SOFT_RESET) &&
 		    (tx_emsg[port].len == 0)) {
 			set_state_prl_tx(port, PRL_TX_LAYER_RESET_FOR_TRANSMIT);
 		}
@@ -839,11 +1008,11 @@ static void prl_tx_wait_for_message_request_run(const int port)
 static void increment_msgid_counter(int port)
 {
 	/* If the last message wasn't an SOP* message, no need to increment */
-	if (prl_tx[port].last_xmit_type >= NUM_SOP_STAR_TYPES)
+	if (prl[port].tx.last_xmit_type >= NUM_SOP_STAR_TYPES)
 		return;
 
-	prl_tx[port].msg_id_counter[prl_tx[port].last_xmit_type] =
-		(prl_tx[port].msg_id_counter[prl_tx[port].last_xmit_type] + 1) &
+	prl[port].tx.msg_id_counter[prl[port].tx.last_xmit_type] =
+		(prl[port].tx.msg_id_counter[prl[port].tx.last_xmit_type] + 1) &
 		PD_MESSAGE_ID_COUNT;
 }
 
@@ -867,8 +1036,8 @@ static void prl_tx_discard_message_entry(const int port)
 	 * discard event has been detected.
 	 */
 	if (PRL_TX_CHK_FLAG(port, PRL_FLAGS_MSG_XMIT) ||
-	    prl_tx[port].xmit_status == TCPC_TX_WAIT ||
-	    prl_tx[port].xmit_status == TCPC_TX_COMPLETE_DISCARDED) {
+	    prl[port].tx.xmit_status == TCPC_TX_WAIT ||
+	    prl[port].tx.xmit_status == TCPC_TX_COMPLETE_DISCARDED) {
 		PRL_TX_CLR_FLAG(port, PRL_FLAGS_MSG_XMIT);
 		increment_msgid_counter(port);
 		pe_report_discard(port);
@@ -926,7 +1095,7 @@ static void prl_tx_layer_reset_for_transmit_entry(const int port)
 {
 	print_current_prl_tx_state(port);
 
-	if (pdmsg[port].xmit_type < NUM_SOP_STAR_TYPES) {
+	if (prl[port].msg.xmit_type < NUM_SOP_STAR_TYPES) {
 		/*
 		 * This state is only used during soft resets. Reset only the
 		 * matching message type.
@@ -941,7 +1110,7 @@ static void prl_tx_layer_reset_for_transmit_entry(const int port)
 		 * don't implement a full state machine for PRL RX states so
 		 * clear the MessageID here.
 		 */
-		prl_reset_msg_ids(port, pdmsg[port].xmit_type);
+		prl_reset_msg_ids(port, prl[port].msg.xmit_type);
 	}
 }
 
@@ -954,33 +1123,34 @@ static void prl_tx_layer_reset_for_transmit_run(const int port)
 
 static uint32_t get_sop_star_header(const int port)
 {
-	const int is_sop_packet = pdmsg[port].xmit_type == TCPCI_MSG_SOP;
+	const int is_sop_packet = prl[port].msg.xmit_type == TCPCI_MSG_SOP;
 	int ext;
 
-	ext = 0;
+	ext = IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES) ? prl[port].msg.ext :
+							     0;
 
 	/* SOP vs SOP'/SOP" headers are different. Replace fields as needed */
-	return PD_HEADER(pdmsg[port].msg_type,
+	return PD_HEADER(prl[port].msg.msg_type,
 			 is_sop_packet ? pd_get_power_role(port) :
 					 tc_get_cable_plug(port),
 			 is_sop_packet ? pd_get_data_role(port) : 0,
-			 prl_tx[port].msg_id_counter[pdmsg[port].xmit_type],
-			 pdmsg[port].data_objs,
-			 pdmsg[port].rev[pdmsg[port].xmit_type], ext);
+			 prl[port].tx.msg_id_counter[prl[port].msg.xmit_type],
+			 prl[port].msg.data_objs,
+			 prl[port].msg.rev[prl[port].msg.xmit_type], ext);
 }
 
 static void prl_tx_construct_message(const int port)
 {
 	/* The header is unused for hard reset, etc. */
-	const uint32_t header = pdmsg[port].xmit_type < NUM_SOP_STAR_TYPES ?
+	const uint32_t header = prl[port].msg.xmit_type < NUM_SOP_STAR_TYPES ?
 					get_sop_star_header(port) :
 					0;
 
 	/* Save SOP* so the correct msg_id_counter can be incremented */
-	prl_tx[port].last_xmit_type = pdmsg[port].xmit_type;
+	prl[port].tx.last_xmit_type = prl[port].msg.xmit_type;
 
 	/* Indicate that a tx message is being passed to the phy layer */
-	prl_tx[port].xmit_status = TCPC_TX_WAIT;
+	prl[port].tx.xmit_status = TCPC_TX_WAIT;
 	/*
 	 * PRL_FLAGS_TX_COMPLETE could be set if this function is called before
 	 * the Policy Engine is informed of the previous transmission. Clear the
@@ -996,8 +1166,10 @@ static void prl_tx_construct_message(const int port)
 	 * should not retry those messages. We do not support that and probably
 	 * never will (since we support chunking).
 	 */
-	tcpm_transmit(port, pdmsg[port].xmit_type, header,
-		      pdmsg[port].tx_chk_buf);
+	pd_capture_tx(port, prl[port].msg.xmit_type, header,
+		      (const uint32_t *)tx_emsg[port].buf);
+	tcpm_transmit(port, prl[port].msg.xmit_type, header,
+		      (const uint32_t *)tx_emsg[port].buf);
 }
 
 /*
@@ -1021,7 +1193,7 @@ static void prl_tx_wait_for_phy_response_run(const int port)
 	 *       requirement.
 	 */
 
-	if (prl_tx[port].xmit_status == TCPC_TX_COMPLETE_SUCCESS) {
+	if (prl[port].tx.xmit_status == TCPC_TX_COMPLETE_SUCCESS) {
 		/* NOTE: PRL_TX_Message_Sent State embedded here. */
 		/* Increment messageId counter */
 		increment_msgid_counter(port);
@@ -1039,7 +1211,7 @@ static void prl_tx_wait_for_phy_response_run(const int port)
 		pd_loop_wake(port);
 		set_state_prl_tx(port, PRL_TX_WAIT_FOR_MESSAGE_REQUEST);
 	} else if (pd_timer_is_expired(port, PR_TIMER_TCPC_TX_TIMEOUT) ||
-		   prl_tx[port].xmit_status == TCPC_TX_COMPLETE_FAILED) {
+		   prl[port].tx.xmit_status == TCPC_TX_COMPLETE_FAILED) {
 		/*
 		 * NOTE: PRL_Tx_Transmission_Error State embedded
 		 * here.
@@ -1054,7 +1226,7 @@ static void prl_tx_wait_for_phy_response_run(const int port)
 		} else {
 			/* Report Error To Policy Engine */
 			pe_report_error(port, ERR_TCH_XMIT,
-					prl_tx[port].last_xmit_type);
+					prl[port].tx.last_xmit_type);
 		}
 
 		/* Increment message id counter */
@@ -1094,7 +1266,7 @@ static void prl_tx_src_pending_run(const int port)
 		 * SinkTxTimer timeout
 		 */
 		if ((tx_emsg[port].len == 0) &&
-		    (pdmsg[port].msg_type == PD_CTRL_SOFT_RESET)) {
+		    (prl[port].msg.msg_type == PD_CTRL_SOFT_RESET)) {
 			set_state_prl_tx(port, PRL_TX_LAYER_RESET_FOR_TRANSMIT);
 		}
 		/* Message pending (except Soft Reset) &
@@ -1153,7 +1325,7 @@ static void prl_tx_snk_pending_run(const int port)
 		 * Soft Reset Message Message pending &
 		 * Rp = SinkTxOk
 		 */
-		if ((pdmsg[port].msg_type == PD_CTRL_SOFT_RESET) &&
+		if ((prl[port].msg.msg_type == PD_CTRL_SOFT_RESET) &&
 		    (tx_emsg[port].len == 0)) {
 			set_state_prl_tx(port, PRL_TX_LAYER_RESET_FOR_TRANSMIT);
 		}
@@ -1175,26 +1347,28 @@ void prl_hr_send_msg_to_phy(const int port)
 	/* Header is not used for hard reset */
 	const uint32_t header = 0;
 
-	pdmsg[port].xmit_type = TCPCI_MSG_TX_HARD_RESET;
+	prl[port].msg.xmit_type = TCPCI_MSG_TX_HARD_RESET;
 
 	/*
 	 * These flags could be set if this function is called before the
 	 * Policy Engine is informed of the previous transmission. Clear the
 	 * flags so that this message can be sent.
 	 */
-	prl_tx[port].xmit_status = TCPC_TX_UNSET;
+	prl[port].tx.xmit_status = TCPC_TX_UNSET;
 	PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_COMPLETE);
 
 	/* Pass message to PHY Layer */
-	tcpm_transmit(port, pdmsg[port].xmit_type, header,
-		      pdmsg[port].tx_chk_buf);
+	pd_capture_tx(port, prl[port].msg.xmit_type, header,
+		      prl[port].msg.tx_chk_buf);
+	tcpm_transmit(port, prl[port].msg.xmit_type, header,
+		      prl[port].msg.tx_chk_buf);
 }
 
 static void prl_hr_wait_for_request_entry(const int port)
 {
 	print_current_prl_hr_state(port);
 
-	prl_hr[port].flags = 0;
+	prl[port].hr.flags = 0;
 }
 
 static void prl_hr_wait_for_request_run(const int port)
@@ -1214,11 +1388,12 @@ static void prl_hr_reset_layer_entry(const int port)
 	print_current_prl_hr_state(port);
 
 	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)) {
-		tch[port].flags = 0;
-		rch[port].flags = 0;
+		prl[port].tch.flags = 0;
+		prl[port].rch.flags = 0;
 	}
 
-	pdmsg[port].flags = 0;
+	prl[port].msg.flags = 0;
+	prl[port].msg.unchunked = false;
 
 	/* Hard reset resets messageIDCounters for all TX types */
 	for (i = 0; i < NUM_SOP_STAR_TYPES; i++) {
@@ -1343,18 +1518,745 @@ static void prl_hr_wait_for_pe_hard_reset_complete_exit(const int port)
 	}
 }
 
-static void copy_chunk_to_ext(int port)
+static void rch_clear_abort_set_chunking(int port)
 {
-	/* Calculate number of bytes */
-	pdmsg[port].num_bytes_received =
-		(PD_HEADER_CNT(rx_emsg[port].header) * 4);
+	/* Clear Abort flag */
+	PDMSG_CLR_FLAG(port, PRL_FLAGS_ABORT);
 
-	/* Copy chunk into extended message */
-	memcpy((uint8_t *)rx_emsg[port].buf, (uint8_t *)pdmsg[port].rx_chk_buf,
-	       pdmsg[port].num_bytes_received);
+	/* Messages are chunked, unless both partners support unchunked */
+	RCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+	if (prl[port].msg.unchunked)
+		RCH_CLR_FLAG(port, PRL_FLAGS_CHUNKING);
+	else
+		RCH_SET_FLAG(port, PRL_FLAGS_CHUNKING);
+}
 
-	/* Set extended message length */
-	rx_emsg[port].len = pdmsg[port].num_bytes_received;
+static void tch_clear_abort_set_chunking(int port)
+{
+	/* Clear Abort flag */
+	PDMSG_CLR_FLAG(port, PRL_FLAGS_ABORT);
+
+	/* Messages are chunked, unless both partners support unchunked */
+	if (prl[port].msg.unchunked)
+		TCH_CLR_FLAG(port, PRL_FLAGS_CHUNKING);
+	else
+		TCH_SET_FLAG(port, PRL_FLAGS_CHUNKING);
+}
+
+/*
+ * Passes up extended message, too long for reassembly buffer, with empty
+ * payload. PE sees the type only and rejects it as not supported. Remaining
+ * chunks are not requested, that's allowed for the chunk sender.
+ */
+static void rch_pass_up_too_long(const int port, uint32_t data_size)
+{
+	CPRINTS("C%d: Ext msg too long (%d)", port, data_size);
+	prl_buf[port].rx_too_long++;
+
+	rx_emsg[port].buf = (const uint8_t *)prl_buf[port].rx_ext_buf;
+	rx_emsg[port].len = 0;
+	set_state_rch(port, RCH_PASS_UP_MESSAGE);
+}
+
+/*
+ * Chunked Rx State Machine
+ */
+/*
+ * RchWaitForMessageFromProtocolLayer
+ */
+static void rch_wait_for_message_from_protocol_layer_entry(const int port)
+{
+	print_current_rch_state(port);
+	rch_clear_abort_set_chunking(port);
+}
+
+static void rch_wait_for_message_from_protocol_layer_run(const int port)
+{
+	if (RCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		RCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+		/*
+		 * Are we communicating with a PD3.0 device and is
+		 * this an extended message?
+		 */
+		if (IS_ENABLED(CONFIG_USB_PD_REV30) &&
+		    prl_get_rev(port, prl[port].rx.sop) == PD_REV30 &&
+		    PD_HEADER_EXT(rx_emsg[port].header)) {
+			uint16_t exhdr =
+				GET_EXT_HEADER(prl[port].msg.rx_chk_buf[0]);
+			uint8_t chunked = PD_EXT_HEADER_CHUNKED(exhdr);
+			uint32_t data_size = PD_EXT_HEADER_DATA_SIZE(exhdr);
+			const uint8_t *const chk_buf =
+				(const uint8_t *)prl[port].msg.rx_chk_buf;
+			uint8_t *const ext_buf =
+				(uint8_t *)prl_buf[port].rx_ext_buf;
+
+			/*
+			 * Received Extended Message &
+			 * (Chunking = 1 & Chunked = 1)
+			 */
+			if ((RCH_CHK_FLAG(port, PRL_FLAGS_CHUNKING)) &&
+			    chunked) {
+				if (data_size > EXTENDED_BUFFER_SIZE) {
+					rch_pass_up_too_long(port, data_size);
+					return;
+				}
+				/*
+				 * RCH_Processing_Extended_Message first chunk
+				 * entry processing embedded here
+				 *
+				 * This is the first chunk:
+				 * Set Chunk_number_expected = 0 and
+				 * Num_Bytes_Received = 0
+				 */
+				prl[port].msg.chunk_number_expected = 0;
+				prl[port].msg.num_bytes_received = 0;
+				prl[port].msg.msg_type =
+					PD_HEADER_TYPE(rx_emsg[port].header);
+				rx_emsg[port].buf = ext_buf;
+				rx_emsg[port].len = 0;
+
+				set_state_rch(port,
+					      RCH_PROCESSING_EXTENDED_MESSAGE);
+			}
+			/*
+			 * (Received Extended Message &
+			 * (Chunking = 0 & Chunked = 0))
+			 */
+			else if (!RCH_CHK_FLAG(port, PRL_FLAGS_CHUNKING) &&
+				 !chunked) {
+				/*
+				 * Whole message is in single packet, TCPC
+				 * drivers do not receive longer ones.
+				 */
+				if (data_size > EXTENDED_BUFFER_SIZE ||
+				    data_size + 2 > PD_HEADER_CNT(
+					    rx_emsg[port].header) * 4) {
+					rch_pass_up_too_long(port, data_size);
+					return;
+				}
+
+				/* Skip over extended message header */
+				memcpy(ext_buf, chk_buf + 2, data_size);
+				rx_emsg[port].buf = ext_buf;
+				rx_emsg[port].len = data_size;
+
+				/* Pass Message to Policy Engine */
+				set_state_rch(port, RCH_PASS_UP_MESSAGE);
+			}
+			/*
+			 * Chunked != Chunking
+			 */
+			else {
+				prl[port].rch.error = ERR_RCH_CHUNKED;
+				set_state_rch(port, RCH_REPORT_ERROR);
+			}
+		}
+		/*
+		 * Received Non-Extended Message
+		 */
+		else if (!PD_HEADER_EXT(rx_emsg[port].header)) {
+			/* Payload is already referenced by rx_emsg */
+			set_state_rch(port, RCH_PASS_UP_MESSAGE);
+		}
+		/*
+		 * Received an Extended Message while communicating at a
+		 * revision lower than PD3.0
+		 */
+		else {
+			prl[port].rch.error = ERR_RCH_CHUNKED;
+			set_state_rch(port, RCH_REPORT_ERROR);
+		}
+	}
+}
+
+/*
+ * RchPassUpMessage
+ */
+static void rch_pass_up_message_entry(const int port)
+{
+	print_current_rch_state(port);
+
+	/* Pass Message to Policy Engine */
+	pe_message_received(port);
+	set_state_rch(port, RCH_WAIT_FOR_MESSAGE_FROM_PROTOCOL_LAYER);
+}
+
+/*
+ * RchProcessingExtendedMessage
+ */
+static void rch_processing_extended_message_entry(const int port)
+{
+	print_current_rch_state(port);
+}
+
+static void rch_processing_extended_message_run(const int port)
+{
+	uint16_t exhdr = GET_EXT_HEADER(prl[port].msg.rx_chk_buf[0]);
+	uint8_t chunk_num = PD_EXT_HEADER_CHUNK_NUM(exhdr);
+	uint32_t data_size = PD_EXT_HEADER_DATA_SIZE(exhdr);
+	uint32_t byte_num;
+
+	/*
+	 * Abort Flag Set
+	 */
+	if (PDMSG_CHK_FLAG(port, PRL_FLAGS_ABORT))
+		set_state_rch(port, RCH_WAIT_FOR_MESSAGE_FROM_PROTOCOL_LAYER);
+
+	/*
+	 * If expected Chunk Number:
+	 *   Append data to Extended_Message_Buffer
+	 *   Increment Chunk_number_Expected
+	 *   Adjust Num Bytes Received
+	 */
+	else if (chunk_num == prl[port].msg.chunk_number_expected) {
+		byte_num = data_size - prl[port].msg.num_bytes_received;
+
+		if (byte_num >= PD_MAX_EXTENDED_MSG_CHUNK_LEN)
+			byte_num = PD_MAX_EXTENDED_MSG_CHUNK_LEN;
+
+		/* Make sure extended message buffer does not overflow */
+		if (prl[port].msg.num_bytes_received + byte_num >
+		    EXTENDED_BUFFER_SIZE) {
+			prl[port].rch.error = ERR_RCH_CHUNKED;
+			set_state_rch(port, RCH_REPORT_ERROR);
+			return;
+		}
+
+		/* Append data */
+		/* Add 2 to chk_buf to skip over extended message header */
+		memcpy((uint8_t *)prl_buf[port].rx_ext_buf +
+			       prl[port].msg.num_bytes_received,
+		       (const uint8_t *)prl[port].msg.rx_chk_buf + 2, byte_num);
+		/* increment chunk number expected */
+		prl[port].msg.chunk_number_expected++;
+		/* adjust num bytes received */
+		prl[port].msg.num_bytes_received += byte_num;
+
+		/* Was that the last chunk? */
+		if (prl[port].msg.num_bytes_received >= data_size) {
+			rx_emsg[port].buf =
+				(const uint8_t *)prl_buf[port].rx_ext_buf;
+			rx_emsg[port].len = prl[port].msg.num_bytes_received;
+			/* Pass Message to Policy Engine */
+			set_state_rch(port, RCH_PASS_UP_MESSAGE);
+		}
+		/*
+		 * Message not Complete
+		 */
+		else
+			set_state_rch(port, RCH_REQUESTING_CHUNK);
+	}
+	/*
+	 * Unexpected Chunk Number
+	 */
+	else {
+		prl[port].rch.error = ERR_RCH_CHUNKED;
+		set_state_rch(port, RCH_REPORT_ERROR);
+	}
+}
+
+/*
+ * RchRequestingChunk
+ */
+static void rch_requesting_chunk_entry(const int port)
+{
+	print_current_rch_state(port);
+
+	/*
+	 * Send Chunk Request to Protocol Layer
+	 * with chunk number = Chunk_Number_Expected
+	 */
+	*(uint32_t *)tx_emsg[port].buf = PD_EXT_HEADER(
+		prl[port].msg.chunk_number_expected, 1, /* Request Chunk */
+		0 /* Data Size */
+	);
+
+	prl[port].msg.data_objs = 1;
+	prl[port].msg.ext = 1;
+	prl[port].msg.xmit_type = TCPCI_MSG_SOP;
+	PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+}
+
+static void rch_requesting_chunk_run(const int port)
+{
+	/*
+	 * Transmission Error from Protocol Layer or
+	 * Message Received From Protocol Layer
+	 */
+	if (RCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED) ||
+	    PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_ERROR)) {
+		/*
+		 * Leave PRL_FLAGS_MSG_RECEIVED flag set. It'll be
+		 * cleared in rch_report_error state
+		 */
+		PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_ERROR);
+		prl[port].rch.error = ERR_RCH_CHUNKED;
+		set_state_rch(port, RCH_REPORT_ERROR);
+	}
+	/*
+	 * Message Transmitted received from Protocol Layer
+	 */
+	else if (PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_COMPLETE)) {
+		PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_COMPLETE);
+		set_state_rch(port, RCH_WAITING_CHUNK);
+	}
+}
+
+/*
+ * RchWaitingChunk
+ */
+static void rch_waiting_chunk_entry(const int port)
+{
+	print_current_rch_state(port);
+
+	/*
+	 * Start ChunkSenderResponseTimer
+	 */
+	pd_timer_enable(port, PR_TIMER_CHUNK_SENDER_RESPONSE,
+			PD_T_CHUNK_SENDER_RESPONSE);
+}
+
+static void rch_waiting_chunk_run(const int port)
+{
+	if (RCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		/*
+		 * Leave PRL_FLAGS_MSG_RECEIVED flag set just in case an error
+		 * is detected. If an error is detected, PRL_FLAGS_MSG_RECEIVED
+		 * will be cleared in rch_report_error state.
+		 */
+
+		if (PD_HEADER_EXT(rx_emsg[port].header)) {
+			uint16_t exhdr =
+				GET_EXT_HEADER(prl[port].msg.rx_chk_buf[0]);
+			/*
+			 * Other Message Received from Protocol Layer
+			 */
+			if (PD_EXT_HEADER_REQ_CHUNK(exhdr) ||
+			    !PD_EXT_HEADER_CHUNKED(exhdr)) {
+				prl[port].rch.error = ERR_RCH_CHUNKED;
+				set_state_rch(port, RCH_REPORT_ERROR);
+			}
+			/*
+			 * Chunk response Received from Protocol Layer
+			 */
+			else {
+				/*
+				 * No error was detected, so clear
+				 * PRL_FLAGS_MSG_RECEIVED flag.
+				 */
+				RCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+				set_state_rch(port,
+					      RCH_PROCESSING_EXTENDED_MESSAGE);
+			}
+		} else {
+			prl[port].rch.error = ERR_RCH_CHUNKED;
+			set_state_rch(port, RCH_REPORT_ERROR);
+		}
+	}
+	/*
+	 * ChunkSenderResponseTimer Timeout
+	 */
+	else if (pd_timer_is_expired(port, PR_TIMER_CHUNK_SENDER_RESPONSE)) {
+		prl[port].rch.error = ERR_RCH_CHUNK_WAIT_TIMEOUT;
+		set_state_rch(port, RCH_REPORT_ERROR);
+	}
+}
+
+static void rch_waiting_chunk_exit(int port)
+{
+	pd_timer_disable(port, PR_TIMER_CHUNK_SENDER_RESPONSE);
+}
+
+/*
+ * RchReportError
+ */
+static void rch_report_error_entry(const int port)
+{
+	print_current_rch_state(port);
+
+	/*
+	 * If the state was entered because a message was received,
+	 * this message is passed to the Policy Engine.
+	 */
+	if (RCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		RCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+
+		/* Pass extended message as is, with extended header */
+		if (PD_HEADER_EXT(rx_emsg[port].header)) {
+			rx_emsg[port].buf =
+				(const uint8_t *)prl[port].msg.rx_chk_buf;
+			rx_emsg[port].len =
+				MIN(PD_HEADER_CNT(rx_emsg[port].header),
+				    CHK_BUF_SIZE) * 4;
+		}
+
+		/* Pass Message to Policy Engine */
+		pe_message_received(port);
+		/* Report error */
+		pe_report_error(port, ERR_RCH_MSG_REC, prl[port].rx.sop);
+	} else {
+		pe_report_error(port, prl[port].rch.error, prl[port].rx.sop);
+	}
+}
+
+static void rch_report_error_run(const int port)
+{
+	set_state_rch(port, RCH_WAIT_FOR_MESSAGE_FROM_PROTOCOL_LAYER);
+}
+
+/*
+ * Chunked Tx State Machine
+ */
+/*
+ * TchWaitForMessageRequestFromPe
+ */
+static void tch_wait_for_message_request_from_pe_entry(const int port)
+{
+	print_current_tch_state(port);
+	tch_clear_abort_set_chunking(port);
+}
+
+static void tch_wait_for_message_request_from_pe_run(const int port)
+{
+	/*
+	 * Any message received and not in state TCH_Wait_Chunk_Request
+	 */
+	if (TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		TCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+		set_state_tch(port, TCH_MESSAGE_RECEIVED);
+	} else if (TCH_CHK_FLAG(port, PRL_FLAGS_MSG_XMIT)) {
+		/*
+		 * Rx Chunking State != RCH_Wait_For_Message_From_Protocol_Layer
+		 * & Abort Supported
+		 *
+		 * Discard the Message
+		 */
+		if (rch_get_state(port) !=
+		    RCH_WAIT_FOR_MESSAGE_FROM_PROTOCOL_LAYER) {
+			prl[port].tch.error = ERR_TCH_XMIT;
+			set_state_tch(port, TCH_REPORT_ERROR);
+		} else if (prl[port].msg.ext) {
+			/*
+			 * Extended Message Request
+			 */
+			if (!pdmsg_xmit_type_is_rev30(port)) {
+				prl[port].tch.error = ERR_TCH_XMIT;
+				set_state_tch(port, TCH_REPORT_ERROR);
+				return;
+			}
+			/*
+			 * NOTE: TCH_Prepare_To_Send_Chunked_Message
+			 * embedded here.
+			 */
+			prl[port].msg.send_offset = 0;
+			prl[port].msg.chunk_number_to_send = 0;
+			set_state_tch(port, TCH_CONSTRUCT_CHUNKED_MESSAGE);
+		} else {
+			/*
+			 * Non-Extended Message Request
+			 */
+			/* NOTE: TCH_Pass_Down_Message embedded here. */
+			prl_pad_msg_buffer(port);
+
+			/* Pass Message to Protocol Layer */
+			PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+			set_state_tch(port, TCH_WAIT_FOR_TRANSMISSION_COMPLETE);
+		}
+	}
+}
+
+/*
+ * TchWaitForTransmissionComplete
+ */
+static void tch_wait_for_transmission_complete_entry(const int port)
+{
+	print_current_tch_state(port);
+}
+
+static void tch_wait_for_transmission_complete_run(const int port)
+{
+	/*
+	 * Inform Policy Engine that Message was sent.
+	 */
+	if (PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_COMPLETE)) {
+		PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_COMPLETE);
+		set_state_tch(port, TCH_MESSAGE_SENT);
+	}
+	/*
+	 * Inform Policy Engine of Tx Error
+	 */
+	else if (PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_ERROR)) {
+		PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_ERROR);
+		prl[port].tch.error = ERR_TCH_XMIT;
+		set_state_tch(port, TCH_REPORT_ERROR);
+	}
+}
+
+/*
+ * TchConstructChunkedMessage
+ */
+static void tch_construct_chunked_message_entry(const int port)
+{
+	uint8_t *buf = tx_emsg[port].buf;
+	uint16_t num;
+
+	print_current_tch_state(port);
+
+	/*
+	 * Any message received and not in state TCH_Wait_Chunk_Request
+	 */
+	if (TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		TCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+		set_state_tch(port, TCH_MESSAGE_RECEIVED);
+		return;
+	}
+
+	/*
+	 * Whole message is built by PE in place in TX buffer, so it must fit
+	 * single chunk (sink never sends longer ones). There is no data for
+	 * the next chunks.
+	 */
+	if (tx_emsg[port].len > PD_MAX_EXTENDED_MSG_CHUNK_LEN ||
+	    prl[port].msg.send_offset) {
+		prl[port].tch.error = ERR_TCH_XMIT;
+		set_state_tch(port, TCH_REPORT_ERROR);
+		return;
+	}
+
+	num = tx_emsg[port].len;
+
+	/* Shift data to make room for extended header */
+	memmove(buf + 2, buf, num);
+
+	/* Set the chunks extended header */
+	if (TCH_CHK_FLAG(port, PRL_FLAGS_CHUNKING))
+		*(uint16_t *)buf =
+			PD_EXT_HEADER(prl[port].msg.chunk_number_to_send,
+				      0, /* Chunk Request */
+				      tx_emsg[port].len);
+	else
+		*(uint16_t *)buf = PD_EXT_HEADER_UNCHUNKED(tx_emsg[port].len);
+
+	/* Zero padding of the last data object */
+	memset(buf + 2 + num, 0, -(num + 2) & 3);
+	prl[port].msg.send_offset += num;
+
+	/*
+	 * Add in 2 bytes for extended header
+	 * pad out to 4-byte boundary
+	 * convert to number of 4-byte words
+	 * Since the value is shifted right by 2,
+	 * no need to explicitly clear the lower
+	 * 2-bits.
+	 */
+	prl[port].msg.data_objs = (num + 2 + 3) >> 2;
+
+	/* Pass message chunk to Protocol Layer */
+	PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
+}
+
+static void tch_construct_chunked_message_run(const int port)
+{
+	if (PDMSG_CHK_FLAG(port, PRL_FLAGS_ABORT))
+		set_state_tch(port, TCH_WAIT_FOR_MESSAGE_REQUEST_FROM_PE);
+	else
+		set_state_tch(port, TCH_SENDING_CHUNKED_MESSAGE);
+}
+
+/*
+ * TchSendingChunkedMessage
+ */
+static void tch_sending_chunked_message_entry(const int port)
+{
+	print_current_tch_state(port);
+}
+
+static void tch_sending_chunked_message_run(const int port)
+{
+	/*
+	 * Transmission Error
+	 */
+	if (PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_ERROR)) {
+		PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_ERROR);
+		prl[port].tch.error = ERR_TCH_XMIT;
+		set_state_tch(port, TCH_REPORT_ERROR);
+	}
+	/*
+	 * Message Transmitted from Protocol Layer &
+	 * Last Chunk
+	 */
+	else if (PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_COMPLETE) &&
+		 tx_emsg[port].len == prl[port].msg.send_offset) {
+		PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_COMPLETE);
+		set_state_tch(port, TCH_MESSAGE_SENT);
+	}
+	/*
+	 * Any message received and not in state TCH_Wait_Chunk_Request
+	 */
+	else if (TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		TCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+		set_state_tch(port, TCH_MESSAGE_RECEIVED);
+	}
+	/*
+	 * Message Transmitted from Protocol Layer &
+	 * Not Last Chunk
+	 */
+	else if (PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_COMPLETE)) {
+		PDMSG_CLR_FLAG(port, PRL_FLAGS_TX_COMPLETE);
+		set_state_tch(port, TCH_WAIT_CHUNK_REQUEST);
+	}
+}
+
+/*
+ * TchWaitChunkRequest
+ */
+static void tch_wait_chunk_request_entry(const int port)
+{
+	print_current_tch_state(port);
+
+	/* Increment Chunk Number to Send */
+	prl[port].msg.chunk_number_to_send++;
+	/* Start Chunk Sender Request Timer */
+	pd_timer_enable(port, PR_TIMER_CHUNK_SENDER_REQUEST,
+			PD_T_CHUNK_SENDER_REQUEST);
+}
+
+static void tch_wait_chunk_request_run(const int port)
+{
+	if (TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		TCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+
+		if (PD_HEADER_EXT(rx_emsg[port].header)) {
+			uint16_t exthdr;
+
+			exthdr = GET_EXT_HEADER(prl[port].msg.rx_chk_buf[0]);
+			if (PD_EXT_HEADER_REQ_CHUNK(exthdr)) {
+				/*
+				 * Chunk Request Received &
+				 * Chunk Number = Chunk Number to Send
+				 */
+				if (PD_EXT_HEADER_CHUNK_NUM(exthdr) ==
+				    prl[port].msg.chunk_number_to_send) {
+					set_state_tch(
+						port,
+						TCH_CONSTRUCT_CHUNKED_MESSAGE);
+				}
+				/*
+				 * Chunk Request Received &
+				 * Chunk Number != Chunk Number to Send
+				 */
+				else {
+					prl[port].tch.error = ERR_TCH_CHUNKED;
+					set_state_tch(port, TCH_REPORT_ERROR);
+				}
+				return;
+			}
+		}
+
+		/*
+		 * Other message received
+		 */
+		set_state_tch(port, TCH_MESSAGE_RECEIVED);
+	}
+	/*
+	 * ChunkSenderRequestTimer timeout
+	 */
+	else if (pd_timer_is_expired(port, PR_TIMER_CHUNK_SENDER_REQUEST)) {
+		set_state_tch(port, TCH_MESSAGE_SENT);
+	}
+}
+
+static void tch_wait_chunk_request_exit(const int port)
+{
+	pd_timer_disable(port, PR_TIMER_CHUNK_SENDER_REQUEST);
+}
+
+/*
+ * TchMessageReceived
+ */
+static void tch_message_received_entry(const int port)
+{
+	print_current_tch_state(port);
+
+	/* Pass message to chunked Rx */
+	RCH_SET_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+
+	/* Clear extended message objects */
+	TCH_CLR_FLAG(port, PRL_FLAGS_MSG_XMIT);
+	prl[port].msg.data_objs = 0;
+}
+
+static void tch_message_received_run(const int port)
+{
+	set_state_tch(port, TCH_WAIT_FOR_MESSAGE_REQUEST_FROM_PE);
+}
+
+/*
+ * TchMessageSent
+ */
+static void tch_message_sent_entry(const int port)
+{
+	print_current_tch_state(port);
+
+	/* Tell PE message was sent */
+	pe_message_sent(port);
+	TCH_CLR_FLAG(port, PRL_FLAGS_MSG_XMIT);
+
+	/*
+	 * Any message received and not in state TCH_Wait_Chunk_Request
+	 */
+	if (TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		TCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+		set_state_tch(port, TCH_MESSAGE_RECEIVED);
+		return;
+	}
+
+	set_state_tch(port, TCH_WAIT_FOR_MESSAGE_REQUEST_FROM_PE);
+}
+
+/*
+ * TchReportError
+ */
+static void tch_report_error_entry(const int port)
+{
+	print_current_tch_state(port);
+
+	/* Report Error To Policy Engine */
+	pe_report_error(port, prl[port].tch.error, prl[port].tx.last_xmit_type);
+
+	TCH_CLR_FLAG(port, PRL_FLAGS_MSG_XMIT);
+
+	/*
+	 * Any message received and not in state TCH_Wait_Chunk_Request
+	 */
+	if (TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED)) {
+		TCH_CLR_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
+		set_state_tch(port, TCH_MESSAGE_RECEIVED);
+		return;
+	}
+
+	set_state_tch(port, TCH_WAIT_FOR_MESSAGE_REQUEST_FROM_PE);
+}
+
+static void rx_release(int port)
+{
+	if (!prl[port].rx.held)
+		return;
+
+	prl[port].rx.held = false;
+	tcpm_release_message(port);
+}
+
+void prl_rx_release(int port)
+{
+	/* Chunk is passed to RCH/TCH, but not copied to reassembly buffer yet */
+	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES) &&
+	    (RCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED) ||
+	     TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED) ||
+	     rch_get_state(port) == RCH_PROCESSING_EXTENDED_MESSAGE))
+		return;
+
+	rx_release(port);
 }
 
 
@@ -1363,6 +2265,7 @@ static void copy_chunk_to_ext(int port)
  */
 static void prl_rx_wait_for_phy_message(const int port, int evt)
 {
+	const uint32_t *payload;
 	uint32_t header;
 	uint8_t type;
 	uint8_t cnt;
@@ -1377,20 +2280,46 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 		return;
 
 	/* If we don't have any message, just stop processing now. */
-	if (!tcpm_has_pending_message(port) ||
-	    tcpm_dequeue_message(port, pdmsg[port].rx_chk_buf, &header))
+	if (!tcpm_has_pending_message(port))
 		return;
 
-	rx_emsg[port].header = header;
+	/*
+	 * Previous message is overwritten if PE did not take it yet. Give its
+	 * slot back before peeking, or we would get the same message again.
+	 */
+	rx_release(port);
+
+	if (tcpm_peek_message(port, &payload, &header))
+		return;
+
+	/* Record before any filtering, to see what is really on the wire */
+	pd_capture_rx(port, tcpm_get_message_rx_ts(port), header, payload);
+
+	/*
+	 * Reference the payload in place. The slot is held until PE consumes
+	 * the message or the next one arrives.
+	 */
+	prl[port].rx.held = true;
+
 	type = PD_HEADER_TYPE(header);
 	cnt = PD_HEADER_CNT(header);
 	msid = PD_HEADER_ID(header);
-	prl_rx[port].sop = PD_HEADER_GET_SOP(header);
+	prl[port].rx.sop = PD_HEADER_GET_SOP(header);
 
 	/* Make sure an incorrect count doesn't overflow the chunk buffer */
 	if (cnt > CHK_BUF_SIZE)
 		cnt = CHK_BUF_SIZE;
 
+	rx_emsg[port].header = header;
+	prl[port].msg.rx_chk_buf = payload;
+
+	/* Extended messages are passed up by RCH, from reassembly buffer */
+	if (!IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES) ||
+	    !PD_HEADER_EXT(header)) {
+		rx_emsg[port].buf = (const uint8_t *)payload;
+		rx_emsg[port].len = cnt * 4;
+	}
+
 	/* dump received packet content (only dump ping at debug level MAX) */
 	if ((prl_debug_level >= DEBUG_LEVEL_2 && type != PD_CTRL_PING) ||
 	    prl_debug_level >= DEBUG_LEVEL_3) {
@@ -1398,7 +2327,7 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 
 		ccprintf("C%d: RECV %04x/%d ", port, header, cnt);
 		for (p = 0; p < cnt; p++)
-			ccprintf("[%d]%08x ", p, pdmsg[port].rx_chk_buf[p]);
+			ccprintf("[%d]%08x ", p, payload[p]);
 		ccprintf("\n");
 	}
 
@@ -1434,7 +2363,7 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 	/* Handle incoming soft reset as special case */
 	if (cnt == 0 && type == PD_CTRL_SOFT_RESET) {
 		/* Clear MessageIdCounter and stored MessageID value. */
-		prl_reset_msg_ids(port, prl_rx[port].sop);
+		prl_reset_msg_ids(port, prl[port].rx.sop);
 
 		/* Soft Reset occurred */
 		set_state_prl_tx(port, PRL_TX_PHY_LAYER_RESET);
@@ -1459,7 +2388,7 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 	/*
 	 * Ignore if this is a duplicate message. Stop processing.
 	 */
-	if (prl_rx[port].msg_id[prl_rx[port].sop] == msid)
+	if (prl[port].rx.msg_id[prl[port].rx.sop] == msid)
 		return;
 
 	/*
@@ -1475,13 +2404,13 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 		 * complete at the same time as a response so only do this if a
 		 * message is pending.
 		 */
-		if (prl_tx[port].xmit_status != TCPC_TX_COMPLETE_SUCCESS ||
+		if (prl[port].tx.xmit_status != TCPC_TX_COMPLETE_SUCCESS ||
 		    PRL_TX_CHK_FLAG(port, PRL_FLAGS_MSG_XMIT))
 			set_state_prl_tx(port, PRL_TX_DISCARD_MESSAGE);
 	}
 
 	/* Store Message Id */
-	prl_rx[port].msg_id[prl_rx[port].sop] = msid;
+	prl[port].rx.msg_id[prl[port].rx.sop] = msid;
 
 	if (IS_ENABLED(CONFIG_USB_PD_EXTENDED_MESSAGES)) {
 		/* RTR Chunked Message Router States. */
@@ -1525,8 +2454,6 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 			RCH_SET_FLAG(port, PRL_FLAGS_MSG_RECEIVED);
 		}
 	} else {
-		/* Copy chunk to extended buffer */
-		copy_chunk_to_ext(port);
 		/* Send message to Policy Engine */
 		pe_message_received(port);
 	}
@@ -1597,11 +2524,66 @@ static __const_data const struct usb_state prl_hr_states[] = {
 };
 
 /* All necessary Chunked Rx states (Section 6.11.2.1.2) */
-__maybe_unused static const struct usb_state rch_states[] = {
+__maybe_unused static __const_data const struct usb_state rch_states[] = {
+	[RCH_WAIT_FOR_MESSAGE_FROM_PROTOCOL_LAYER] = {
+		.entry  = rch_wait_for_message_from_protocol_layer_entry,
+		.run    = rch_wait_for_message_from_protocol_layer_run,
+	},
+	[RCH_PASS_UP_MESSAGE] = {
+		.entry  = rch_pass_up_message_entry,
+	},
+	[RCH_PROCESSING_EXTENDED_MESSAGE] = {
+		.entry  = rch_processing_extended_message_entry,
+		.run    = rch_processing_extended_message_run,
+	},
+	[RCH_REQUESTING_CHUNK] = {
+		.entry  = rch_requesting_chunk_entry,
+		.run    = rch_requesting_chunk_run,
+	},
+	[RCH_WAITING_CHUNK] = {
+		.entry  = rch_waiting_chunk_entry,
+		.run    = rch_waiting_chunk_run,
+		.exit   = rch_waiting_chunk_exit,
+	},
+	[RCH_REPORT_ERROR] = {
+		.entry  = rch_report_error_entry,
+		.run    = rch_report_error_run,
+	},
 };
 
 /* All necessary Chunked Tx states (Section 6.11.2.1.3) */
-__maybe_unused static const struct usb_state tch_states[] = {
+__maybe_unused static __const_data const struct usb_state tch_states[] = {
+	[TCH_WAIT_FOR_MESSAGE_REQUEST_FROM_PE] = {
+		.entry  = tch_wait_for_message_request_from_pe_entry,
+		.run    = tch_wait_for_message_request_from_pe_run,
+	},
+	[TCH_WAIT_FOR_TRANSMISSION_COMPLETE] = {
+		.entry  = tch_wait_for_transmission_complete_entry,
+		.run    = tch_wait_for_transmission_complete_run,
+	},
+	[TCH_CONSTRUCT_CHUNKED_MESSAGE] = {
+		.entry  = tch_construct_chunked_message_entry,
+		.run    = tch_construct_chunked_message_run,
+	},
+	[TCH_SENDING_CHUNKED_MESSAGE] = {
+		.entry  = tch_sending_chunked_message_entry,
+		.run    = tch_sending_chunked_message_run,
+	},
+	[TCH_WAIT_CHUNK_REQUEST] = {
+		.entry  = tch_wait_chunk_request_entry,
+		.run    = tch_wait_chunk_request_run,
+		.exit   = tch_wait_chunk_request_exit,
+	},
+	[TCH_MESSAGE_RECEIVED] = {
+		.entry  = tch_message_received_entry,
+		.run    = tch_message_received_run,
+	},
+	[TCH_MESSAGE_SENT] = {
+		.entry  = tch_message_sent_entry,
+	},
+	[TCH_REPORT_ERROR] = {
+		.entry  = tch_report_error_entry,
+	},
 };
 
 __maybe_unused static void
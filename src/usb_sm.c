@@ -11,6 +11,10 @@
 
 #include "common.h"
 #include "stdbool.h"
+#include <stdatomic.h>
+#include <string.h>
+#include "pd_bench.h"
+#include "pd_port_arena.h"
 #include "usb_pd.h"
 #include "usb_sm.h"
 #include "util.h"
@@ -29,38 +33,130 @@ struct internal_ctx {
 	uint32_t running : 1;
 	uint32_t enter : 1;
 	uint32_t exit : 1;
+	/* enum usb_sm_id + 1, zero if not traced */
+	uint32_t trace_id : 3;
 };
 BUILD_ASSERT(sizeof(struct internal_ctx) ==
 	     member_size(struct sm_ctx, internal));
 
-/* Gets the first shared parent state between a and b (inclusive) */
-static usb_state_ptr shared_parent_state(usb_state_ptr a, usb_state_ptr b)
+#ifdef CONFIG_USB_SM_TRACE
+#ifndef CONFIG_USB_SM_TRACE_DEPTH
+#define CONFIG_USB_SM_TRACE_DEPTH 64
+#endif
+
+static struct {
+	usb_state_ptr base;
+	int count;
+} trace_tables[USB_SM_COUNT];
+
+/*
+ * Each port is traced only from its own event loop, so there is a single
+ * writer per ring. trace_head counts all records ever written, the reader
+ * uses it to detect overwritten slots.
+ */
+static struct usb_sm_trace_rec
+	PD_PORT_DATA(trace_ring)[CONFIG_USB_SM_TRACE_DEPTH];
+static atomic_uint PD_PORT_DATA(trace_head);
+
+#ifdef CONFIG_PD_PORT_ARENA
+void usb_sm_port_arena_init(int count)
+{
+	PD_PORT_DATA_TAKE(trace_ring, count);
+	PD_PORT_DATA_TAKE(trace_head, count);
+}
+#endif
+
+/* Fits internal_ctx.trace_id */
+BUILD_ASSERT(USB_SM_COUNT < 8);
+
+void usb_sm_trace_register(struct sm_ctx *ctx, enum usb_sm_id id,
+			   usb_state_ptr table, int count)
+{
+	struct internal_ctx *const internal = (void *)ctx->internal;
+
+	trace_tables[id].base = table;
+	trace_tables[id].count = count;
+	internal->trace_id = id + 1;
+}
+
+static void trace_transition(const int port, const struct sm_ctx *ctx)
+{
+	const struct internal_ctx *const internal = (void *)ctx->internal;
+	const unsigned int head =
+		atomic_load_explicit(&trace_head[port], memory_order_relaxed);
+	struct usb_sm_trace_rec *rec =
+		&trace_ring[port][head % CONFIG_USB_SM_TRACE_DEPTH];
+	const int sm = internal->trace_id - 1;
+
+	if (sm < 0)
+		return;
+
+	rec->ts = get_time().le.lo;
+	rec->port = port;
+	rec->sm = sm;
+	rec->from = ctx->previous ? ctx->previous - trace_tables[sm].base :
+				    USB_SM_TRACE_NO_STATE;
+	rec->to = ctx->current ? ctx->current - trace_tables[sm].base :
+				 USB_SM_TRACE_NO_STATE;
+
+	atomic_store_explicit(&trace_head[port], head + 1,
+			      memory_order_release);
+}
+
+int usb_sm_trace_read(int port, struct usb_sm_trace_rec *buf, int max)
 {
-	const usb_state_ptr orig_b = b;
+	const unsigned int head =
+		atomic_load_explicit(&trace_head[port], memory_order_acquire);
+	unsigned int count = MIN(head, CONFIG_USB_SM_TRACE_DEPTH);
+	unsigned int first, valid;
+
+	if (count > max)
+		count = max;
+	first = head - count;
+
+	for (unsigned int i = 0; i < count; i++)
+		buf[i] = trace_ring[port][(first + i) % CONFIG_USB_SM_TRACE_DEPTH];
+
+	/*
+	 * Writer may have wrapped around while copying. Record N shares slot
+	 * with N + DEPTH, so drop records that could be overwritten.
+	 */
+	valid = atomic_load_explicit(&trace_head[port], memory_order_acquire);
+	if (valid - first >= CONFIG_USB_SM_TRACE_DEPTH) {
+		unsigned int lost = valid - first - CONFIG_USB_SM_TRACE_DEPTH + 1;
+
+		if (lost >= count)
+			return 0;
+		memmove(buf, buf + lost, (count - lost) * sizeof(*buf));
+		count -= lost;
+	}
+
+	return count;
+}
+#endif /* CONFIG_USB_SM_TRACE */
 
+/*
+ * Gets the first shared parent state between a and b (inclusive). States
+ * are lifted to the same depth first, then both go up in lockstep until
+ * they meet.
+ */
+static usb_state_ptr shared_parent_state(usb_state_ptr a, usb_state_ptr b)
+{
 	/* There are no common ancestors */
-	if (b == NULL)
+	if (a == NULL || b == NULL)
 		return NULL;
 
-	/* This assumes that both A and B are NULL terminated without cycles */
-	while (a != NULL) {
-		/* We found a match return */
-		if (a == b)
-			return a;
+	while (a->depth > b->depth)
+		a = a->parent;
+	while (b->depth > a->depth)
+		b = b->parent;
 
-		/*
-		 * Otherwise, increment b down the list for comparison until we
-		 * run out, then increment a and start over on b for comparison
-		 */
-		if (b->parent == NULL) {
-			a = a->parent;
-			b = orig_b;
-		} else {
-			b = b->parent;
-		}
+	while (a != b) {
+		a = a->parent;
+		b = b->parent;
 	}
 
-	return NULL;
+	return a;
 }
 
 /*
@@ -71,24 +167,35 @@ static usb_state_ptr shared_parent_state(usb_state_ptr a, usb_state_ptr b)
 static void call_entry_functions(const int port,
 				 struct internal_ctx *const internal,
 				 const usb_state_ptr stop,
-				 const usb_state_ptr current)
+				 usb_state_ptr current)
 {
-	if (current == stop)
-		return;
+	usb_state_ptr path[USB_SM_MAX_DEPTH];
+	int count = 0;
 
-	call_entry_functions(port, internal, stop, current->parent);
+	/* Collect states to enter, from child up to (excluding) stop */
+	while (current != stop && count < USB_SM_MAX_DEPTH) {
+		path[count++] = current;
+		current = current->parent;
+	}
+	/* Path is truncated only if depth in state table is wrong */
+	assert(current == stop);
 
-	/*
-	 * If the previous entry function called set_state, then don't enter
-	 * remaining states.
-	 */
-	if (!internal->enter)
-		return;
+	while (count--) {
+		/*
+		 * If the previous entry function called set_state, then don't
+		 * enter remaining states.
+		 */
+		if (!internal->enter)
+			return;
 
-	/* Track the latest state that was entered, so we can exit properly. */
-	internal->last_entered = current;
-	if (current->entry)
-		current->entry(port);
+		/*
+		 * Track the latest state that was entered, so we can exit
+		 * properly.
+		 */
+		internal->last_entered = path[count];
+		if (path[count]->entry)
+			path[count]->entry(port);
+	}
 }
 
 /*
@@ -96,15 +203,21 @@ static void call_entry_functions(const int port,
  * during an exit function.
  */
 static void call_exit_functions(const int port, const usb_state_ptr stop,
-				const usb_state_ptr current)
+				usb_state_ptr current)
 {
-	if (current == stop)
-		return;
-
-	if (current->exit)
-		current->exit(port);
+	for (; current != stop; current = current->parent) {
+		if (current->exit)
+			current->exit(port);
+	}
+}
 
-	call_exit_functions(port, stop, current->parent);
+void usb_sm_check_table(usb_state_ptr table, int count)
+{
+	for (int i = 0; i < count; i++) {
+		assert(table[i].depth < USB_SM_MAX_DEPTH);
+		assert(table[i].depth ==
+		       (table[i].parent ? table[i].parent->depth + 1 : 0));
+	}
 }
 
 void set_state(const int port, struct sm_ctx *const ctx,
@@ -145,6 +258,11 @@ void set_state(const int port, struct sm_ctx *const ctx,
 	ctx->previous = ctx->current;
 	ctx->current = new_state;
 
+#ifdef CONFIG_USB_SM_TRACE
+	trace_transition(port, ctx);
+#endif
+	pd_bench_transition(port);
+
 	/*
 	 * Enter all new non-common states. last_entered will contain the last
 	 * state that successfully entered before another set_state was called.
@@ -168,32 +286,27 @@ void set_state(const int port, struct sm_ctx *const ctx,
 	/*
 	 * Since we are changing states, we want to ensure that we process the
 	 * next state's run method as soon as we can to ensure that we don't
-	 * delay important processing until the next task interval.
+	 * delay important processing until the next task interval. Tickless
+	 * loop has no next interval at all, polling states would stall.
 	 */
-	if (IS_ENABLED(HAS_TASK_PD_C0))
+	if (IS_ENABLED(HAS_TASK_PD_C0) || IS_ENABLED(CONFIG_PD_LOOP_TICKLESS))
 		pd_loop_wake(port);
 }
 
 /*
  * Call all run functions of children before parents. If set_state is called
- * during one of the entry functions, then do not call any remaining entry
+ * during one of the run functions, then do not call any remaining run
  * functions.
  */
 static void call_run_functions(const int port,
 			       const struct internal_ctx *const internal,
-			       const usb_state_ptr current)
+			       usb_state_ptr current)
 {
-	if (!current)
-		return;
-
 	/* If set_state is called during run, don't call remain functions. */
-	if (!internal->running)
-		return;
-
-	if (current->run)
-		current->run(port);
-
-	call_run_functions(port, internal, current->parent);
+	for (; current && internal->running; current = current->parent) {
+		if (current->run)
+			current->run(port);
+	}
 }
 
 void run_state(const int port, struct sm_ctx *const ctx)
@@ -0,0 +1,368 @@
+/*
+ * Host bench: sink stack against the scripted source (vsrc.c), through a
+ * virtual TCPC and with a virtual clock. Runs each scenario from attach to
+ * the expected number of contracts, and prints pd_bench records. Numbers
+ * don't depend on host speed, so can be compared between builds.
+ *
+ * Needs CONFIG_PD_BENCH and CONFIG_PD_LOOP_TICKLESS. Type-C layer is not
+ * part of this repo, it is replaced by stubs below: port is attached as
+ * sink while a scenario runs, and detached between scenarios. EC helpers
+ * come from test/host, see Makefile.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "src/pd_config.h"
+#include "src/portage/pd_loop.h"
+#include "pd_bench.h"
+#include "pd_snk_policy.h"
+#include "tcpm.h"
+#include "usb_pd.h"
+#include "usb_pd_tcpm.h"
+#include "usb_tc_sm.h"
+#include "util.h"
+#include "vsrc.h"
+
+#if !defined(CONFIG_PD_BENCH) || !defined(CONFIG_PD_LOOP_TICKLESS)
+#error "pd_bench harness needs CONFIG_PD_BENCH and CONFIG_PD_LOOP_TICKLESS"
+#endif
+
+#define PORT 0
+
+/* TX to GoodCRC, us */
+#define T_TX 1000
+/* Give up scenario after this time, us */
+#define T_LIMIT 5000000
+/* Detached time between scenarios, us */
+#define T_DETACH 1000000
+
+/* Virtual clock, us */
+static uint64_t now;
+/* Loop timer deadline, UINT64_MAX if not armed */
+static uint64_t wake_at = UINT64_MAX;
+/* TX completion time, UINT64_MAX if nothing is sent */
+static uint64_t tx_done_at = UINT64_MAX;
+static int tx_status;
+static bool attached;
+static enum vsrc_scenario scenario;
+/* Message being passed from source to TCPC RX queue */
+static struct vsrc_msg rx;
+
+/*
+ * Platform hooks
+ */
+
+timestamp_t get_time(void)
+{
+	timestamp_t t = { .val = now };
+
+	return t;
+}
+
+#ifdef CONFIG_PD_TIMER_TICKS
+uint32_t get_ticks(void)
+{
+	return now / CONFIG_PD_TIMER_TICK_US;
+}
+#endif
+
+void pd_loop_timer_arm(int32_t delay_us)
+{
+	wake_at = delay_us < 0 ? UINT64_MAX : now + delay_us;
+}
+
+#ifdef CONFIG_PD_SNK_CACHE_PERSIST
+void pd_snk_cache_save(const void *data, int len)
+{
+}
+#endif
+
+/*
+ * Virtual TCPC
+ */
+
+static int vtcpc_init(int port)
+{
+	return EC_SUCCESS;
+}
+
+static int vtcpc_get_cc(int port, enum tcpc_cc_voltage_status *cc1,
+			enum tcpc_cc_voltage_status *cc2)
+{
+	*cc1 = attached ? TYPEC_CC_VOLT_RP_3_0 : TYPEC_CC_VOLT_OPEN;
+	*cc2 = TYPEC_CC_VOLT_OPEN;
+
+	return EC_SUCCESS;
+}
+
+static bool vtcpc_check_vbus_level(int port, enum vbus_level level)
+{
+	return level == VBUS_PRESENT ? attached : !attached;
+}
+
+static int vtcpc_set_cc(int port, int pull)
+{
+	return EC_SUCCESS;
+}
+
+static int vtcpc_set_polarity(int port, enum tcpc_cc_polarity polarity)
+{
+	return EC_SUCCESS;
+}
+
+static int vtcpc_set_vconn(int port, int enable)
+{
+	return EC_SUCCESS;
+}
+
+static int vtcpc_set_msg_header(int port, int power_role, int data_role)
+{
+	return EC_SUCCESS;
+}
+
+static int vtcpc_set_rx_enable(int port, int enable)
+{
+	return EC_SUCCESS;
+}
+
+static int vtcpc_get_message_raw(int port, uint32_t *payload, int *head)
+{
+	*head = rx.header;
+	memcpy(payload, rx.data, sizeof(rx.data));
+
+	return EC_SUCCESS;
+}
+
+static int vtcpc_transmit(int port, enum tcpci_msg_type type,
+			  uint16_t header, const uint32_t *data)
+{
+	struct vsrc_msg msg = { .header = header };
+
+	switch (type) {
+	case TCPCI_MSG_SOP:
+		memcpy(msg.data, data,
+		       PD_HEADER_CNT(header) * sizeof(uint32_t));
+		vsrc_receive(now + T_TX, &msg);
+		tx_status = TCPC_TX_COMPLETE_SUCCESS;
+		break;
+	case TCPCI_MSG_TX_HARD_RESET:
+		vsrc_hard_reset(now + T_TX);
+		tx_status = TCPC_TX_COMPLETE_SUCCESS;
+		break;
+	default:
+		/* No cable plug to answer SOP' / SOP'' */
+		tx_status = TCPC_TX_COMPLETE_FAILED;
+		break;
+	}
+
+	tx_done_at = now + T_TX;
+
+	return EC_SUCCESS;
+}
+
+static const struct tcpm_drv vtcpc_drv = {
+	.init = &vtcpc_init,
+	.get_cc = &vtcpc_get_cc,
+	.check_vbus_level = &vtcpc_check_vbus_level,
+	.set_cc = &vtcpc_set_cc,
+	.set_polarity = &vtcpc_set_polarity,
+	.set_vconn = &vtcpc_set_vconn,
+	.set_msg_header = &vtcpc_set_msg_header,
+	.set_rx_enable = &vtcpc_set_rx_enable,
+	.get_message_raw = &vtcpc_get_message_raw,
+	.transmit = &vtcpc_transmit,
+};
+
+const struct tcpc_config_t tcpc_config[CONFIG_USB_PD_PORT_MAX_COUNT] = {
+	[PORT] = { .drv = &vtcpc_drv },
+};
+
+/*
+ * Type-C layer stubs, sink only
+ */
+
+uint8_t tc_get_pd_enabled(int port)
+{
+	return attached;
+}
+
+int tc_is_attached_snk(int port)
+{
+	return attached;
+}
+
+int tc_is_attached_src(int port)
+{
+	return 0;
+}
+
+enum pd_cable_plug tc_get_cable_plug(int port)
+{
+	return PD_PLUG_FROM_DFP_UFP;
+}
+
+int tc_is_vconn_src(int port)
+{
+	return 0;
+}
+
+void tc_hard_reset_request(int port)
+{
+}
+
+void tc_start_error_recovery(int port)
+{
+	/* Same as replug */
+	vsrc_attach(scenario, now);
+}
+
+void tc_pd_connection(int port, int en)
+{
+}
+
+void tc_snk_power_off(int port)
+{
+}
+
+void tc_src_power_off(int port)
+{
+}
+
+void tc_request_power_swap(int port)
+{
+}
+
+void tc_pr_swap_complete(int port, bool success)
+{
+}
+
+void tc_prs_src_snk_assert_rd(int port)
+{
+}
+
+void tc_prs_snk_src_assert_rp(int port)
+{
+}
+
+enum pd_power_role pd_get_power_role(int port)
+{
+	return PD_ROLE_SINK;
+}
+
+enum pd_data_role pd_get_data_role(int port)
+{
+	return PD_ROLE_UFP;
+}
+
+enum pd_dual_role_states pd_get_dual_role(int port)
+{
+	return PD_DRP_FORCE_SINK;
+}
+
+int pd_is_connected(int port)
+{
+	return attached;
+}
+
+void pd_set_error_recovery(int port)
+{
+	tc_start_error_recovery(port);
+}
+
+bool pd_check_vbus_level(int port, enum vbus_level level)
+{
+	return tcpm_check_vbus_level(port, level);
+}
+
+bool pd_get_vconn_state(int port)
+{
+	return false;
+}
+
+void pd_request_data_swap(int port)
+{
+}
+
+int typec_update_cc(int port)
+{
+	return EC_SUCCESS;
+}
+
+void typec_select_src_current_limit_rp(int port, enum tcpc_rp_value rp)
+{
+}
+
+void typec_select_src_collision_rp(int port, enum tcpc_rp_value rp)
+{
+}
+
+/*
+ * Bench
+ */
+
+static int contracts(enum vsrc_scenario sc)
+{
+	/* EPR needs SPR contract first */
+	return sc == VSRC_EPR ? 2 : 1;
+}
+
+static void run(enum vsrc_scenario sc)
+{
+	const struct pd_snk_policy max_power = {
+		.mode = PD_SNK_POLICY_MAX_POWER,
+		.max_mv = PD_MAX_VOLTAGE_MV,
+	};
+	const struct pd_snk_policy pps = {
+		.mode = PD_SNK_POLICY_PREFER_VOLTAGE,
+		.max_mv = PD_MAX_VOLTAGE_MV,
+		.pref_mv = 7400,
+		.allow_apdo = true,
+	};
+	const uint64_t end = now + T_LIMIT;
+	uint64_t next;
+
+	pd_snk_set_policy(PORT, sc == VSRC_PPS ? &pps : &max_power);
+
+	scenario = sc;
+	vsrc_attach(sc, now);
+	attached = true;
+	pd_loop_wake(PORT);
+
+	while (vsrc_contracts() < contracts(sc) && now < end) {
+		next = MIN(MIN(vsrc_next_due(), tx_done_at), wake_at);
+		if (next == UINT64_MAX)
+			break;
+		if (next > now)
+			now = next;
+
+		if (tx_done_at <= now) {
+			tx_done_at = UINT64_MAX;
+			pd_transmit_complete(PORT, tx_status);
+			pd_loop_set_event(PORT, PD_EVENT_TX);
+		} else if (vsrc_pop(now, &rx)) {
+			tcpm_enqueue_message(PORT);
+		} else if (wake_at <= now) {
+			wake_at = UINT64_MAX;
+			pd_loop_handle_timer_interrupt();
+		}
+	}
+
+	printf("%s: %d/%d contracts\n", vsrc_name(sc), vsrc_contracts(),
+	       contracts(sc));
+	pd_bench_dump(PORT, printf);
+
+	/* Detach, stack goes idle */
+	attached = false;
+	pd_loop_set_event(PORT, PD_EVENT_CC);
+	tx_done_at = UINT64_MAX;
+	now += T_DETACH;
+}
+
+int main(void)
+{
+	for (int sc = 0; sc < VSRC_SCENARIO_COUNT; sc++)
+		run(sc);
+
+	return 0;
+}
@@ -0,0 +1,4 @@
+/* Build options of host bench, on top of src/portage/pd_portage_defines.h */
+
+#define CONFIG_PD_BENCH
+#define CONFIG_PD_LOOP_TICKLESS
@@ -0,0 +1,435 @@
+/*
+ * Scripted USB PD source partner, see vsrc.h.
+ */
+
+#include <string.h>
+
+#include "vsrc.h"
+
+/* Control messages */
+#define CTRL_ACCEPT 0x03
+#define CTRL_REJECT 0x04
+#define CTRL_PS_RDY 0x06
+#define CTRL_GET_SOURCE_CAP 0x07
+#define CTRL_SOFT_RESET 0x0D
+#define CTRL_NOT_SUPPORTED 0x10
+#define CTRL_GET_PPS_STATUS 0x14
+
+/* Data messages */
+#define DATA_SOURCE_CAP 0x01
+#define DATA_REQUEST 0x02
+#define DATA_EPR_REQUEST 0x09
+#define DATA_EPR_MODE 0x0A
+#define DATA_VENDOR_DEFINED 0x0F
+
+/* Extended messages */
+#define EXT_PPS_STATUS 0x0C
+#define EXT_CONTROL 0x10
+#define EXT_EPR_SOURCE_CAP 0x11
+
+/* Extended_Control types */
+#define EXTCTRL_EPR_GET_SOURCE_CAP 1
+#define EXTCTRL_EPR_KEEPALIVE 3
+#define EXTCTRL_EPR_KEEPALIVE_ACK 4
+
+/* EPR_Mode actions, bits 31-24 */
+#define EPR_ENTER 1
+#define EPR_ENTER_ACK 2
+#define EPR_ENTER_SUCCEEDED 3
+#define EPR_ENTER_FAILED 4
+#define EPR_EXIT 5
+#define EPR_MODE(action, data) (((uint32_t)(action) << 24) | ((data) << 16))
+
+/* PDOs */
+#define FIXED(mv, ma) ((((mv) / 50) << 10) | ((ma) / 10))
+#define FIXED_EPR_CAPABLE (1U << 23)
+#define PPS(min_mv, max_mv, ma)                                     \
+	(0xC0000000U | (((max_mv) / 100) << 17) | (((min_mv) / 100) << 8) | \
+	 ((ma) / 50))
+#define AVS(min_mv, max_mv, pdp)                                    \
+	(0xD0000000U | (((max_mv) / 100) << 17) | (((min_mv) / 100) << 8) | \
+	 (pdp))
+
+/* RDO object position, bits 31-28 */
+#define RDO_POS(rdo) (((rdo) >> 28) & 0xF)
+/* PPS RDO output voltage, 20mV units */
+#define RDO_PPS_MV(rdo) ((((rdo) >> 9) & 0xFFF) * 20)
+
+/* Source side timings, us */
+#define T_FIRST_SOURCE_CAP 150000
+#define T_RESPONSE 2000
+#define T_SRC_TRANSITION 30000
+#define T_EPR_ENTER 20000
+#define T_SRC_RECOVER 700000
+
+/* SPR PDOs are padded to 7 positions in EPR capabilities */
+#define EPR_SPR_SLOTS 7
+#define MAX_PDOS 11
+
+#define QUEUE_LEN 8
+
+struct pending {
+	uint64_t due;
+	struct vsrc_msg msg;
+};
+
+static struct {
+	enum vsrc_scenario sc;
+	/* Header spec revision, 1 = 2.0, 2 = 3.x */
+	int rev;
+	int msg_id;
+	bool epr;
+	int contracts;
+	/* Requested PPS voltage, for PPS_Status */
+	int pps_mv;
+	/* Outgoing messages, ordered by due time */
+	struct pending q[QUEUE_LEN];
+	int q_head;
+	int q_cnt;
+	/* Extended message being sent by chunks */
+	int ext_type;
+	int ext_size;
+	uint8_t ext[4 * MAX_PDOS];
+} src;
+
+static const char *const names[VSRC_SCENARIO_COUNT] = {
+	[VSRC_PD20] = "PD2.0",
+	[VSRC_PD30] = "PD3.0",
+	[VSRC_PPS] = "PPS",
+	[VSRC_EPR] = "EPR",
+};
+
+const char *vsrc_name(enum vsrc_scenario sc)
+{
+	return names[sc];
+}
+
+static int spr_pdos(uint32_t *pdo)
+{
+	switch (src.sc) {
+	case VSRC_PD20:
+		pdo[0] = FIXED(5000, 3000);
+		pdo[1] = FIXED(9000, 3000);
+		return 2;
+	case VSRC_PD30:
+		pdo[0] = FIXED(5000, 3000);
+		pdo[1] = FIXED(9000, 3000);
+		pdo[2] = FIXED(15000, 3000);
+		pdo[3] = FIXED(20000, 3000);
+		return 4;
+	case VSRC_PPS:
+		pdo[0] = FIXED(5000, 3000);
+		pdo[1] = FIXED(9000, 3000);
+		pdo[2] = PPS(3300, 11000, 3000);
+		return 3;
+	case VSRC_EPR:
+	default:
+		pdo[0] = FIXED(5000, 3000) | FIXED_EPR_CAPABLE;
+		pdo[1] = FIXED(9000, 3000);
+		pdo[2] = FIXED(15000, 3000);
+		pdo[3] = FIXED(20000, 5000);
+		return 4;
+	}
+}
+
+static int epr_pdos(uint32_t *pdo)
+{
+	int n = spr_pdos(pdo);
+
+	while (n < EPR_SPR_SLOTS)
+		pdo[n++] = 0;
+	pdo[n++] = FIXED(28000, 5000);
+	pdo[n++] = AVS(15000, 28000, 140);
+
+	return n;
+}
+
+static void push(uint64_t due, int type, int cnt, const uint32_t *data,
+		 bool ext)
+{
+	struct pending *p;
+
+	if (src.q_cnt >= QUEUE_LEN)
+		return;
+
+	/* Keep order, source sends one message at a time */
+	if (src.q_cnt) {
+		int last = (src.q_head + src.q_cnt - 1) % QUEUE_LEN;
+
+		if (due < src.q[last].due)
+			due = src.q[last].due;
+	}
+
+	p = &src.q[(src.q_head + src.q_cnt++) % QUEUE_LEN];
+	p->due = due;
+	memset(&p->msg, 0, sizeof(p->msg));
+	/* Source, DFP */
+	p->msg.header = type | (1 << 5) | (src.rev << 6) | (1 << 8) |
+			(src.msg_id << 9) | (cnt << 12) | ((ext ? 1 : 0) << 15);
+	if (cnt)
+		memcpy(p->msg.data, data, cnt * sizeof(uint32_t));
+
+	src.msg_id = (src.msg_id + 1) & 7;
+}
+
+static void push_ctrl(uint64_t due, int type)
+{
+	push(due, type, 0, NULL, false);
+}
+
+static void push_ext_chunk(uint64_t due, int chunk)
+{
+	uint8_t b[2 + VSRC_CHUNK_BYTES] = { 0 };
+	uint32_t data[7] = { 0 };
+	int off = chunk * VSRC_CHUNK_BYTES;
+	int len = src.ext_size - off;
+	uint16_t hdr;
+	int i;
+
+	if (len <= 0)
+		return;
+	if (len > VSRC_CHUNK_BYTES)
+		len = VSRC_CHUNK_BYTES;
+
+	hdr = src.ext_size | (chunk << 11) | (1 << 15);
+	b[0] = hdr & 0xFF;
+	b[1] = hdr >> 8;
+	memcpy(b + 2, src.ext + off, len);
+
+	for (i = 0; i < 2 + len; i++)
+		data[i / 4] |= (uint32_t)b[i] << (8 * (i % 4));
+
+	push(due, src.ext_type, (2 + len + 3) / 4, data, true);
+}
+
+static void push_ext(uint64_t due, int type, const uint8_t *bytes, int size)
+{
+	src.ext_type = type;
+	src.ext_size = size;
+	memcpy(src.ext, bytes, size);
+	push_ext_chunk(due, 0);
+}
+
+static void push_caps(uint64_t due)
+{
+	uint32_t pdo[MAX_PDOS];
+	int n = spr_pdos(pdo);
+
+	push(due, DATA_SOURCE_CAP, n, pdo, false);
+}
+
+static void push_epr_caps(uint64_t due)
+{
+	uint32_t pdo[MAX_PDOS];
+	uint8_t b[4 * MAX_PDOS];
+	int n = epr_pdos(pdo);
+	int i;
+
+	for (i = 0; i < 4 * n; i++)
+		b[i] = pdo[i / 4] >> (8 * (i % 4));
+
+	push_ext(due, EXT_EPR_SOURCE_CAP, b, 4 * n);
+}
+
+static void push_unsupported(uint64_t due)
+{
+	push_ctrl(due, src.rev >= 2 ? CTRL_NOT_SUPPORTED : CTRL_REJECT);
+}
+
+static void reset(uint64_t first_caps)
+{
+	src.msg_id = 0;
+	src.epr = false;
+	src.q_head = 0;
+	src.q_cnt = 0;
+	push_caps(first_caps);
+}
+
+void vsrc_attach(enum vsrc_scenario sc, uint64_t now)
+{
+	memset(&src, 0, sizeof(src));
+	src.sc = sc;
+	src.rev = sc == VSRC_PD20 ? 1 : 2;
+	reset(now + T_FIRST_SOURCE_CAP);
+}
+
+void vsrc_hard_reset(uint64_t now)
+{
+	reset(now + T_SRC_RECOVER + T_FIRST_SOURCE_CAP);
+}
+
+static void request(uint64_t now, const struct vsrc_msg *msg, bool epr_req)
+{
+	uint32_t pdo[MAX_PDOS];
+	uint32_t rdo = msg->data[0];
+	int pos = RDO_POS(rdo);
+	int n = epr_req ? epr_pdos(pdo) : spr_pdos(pdo);
+
+	if (!pos || pos > n || !pdo[pos - 1] || (epr_req && !src.epr)) {
+		push_ctrl(now + T_RESPONSE, CTRL_REJECT);
+		return;
+	}
+
+	if ((pdo[pos - 1] & 0xF0000000U) == 0xC0000000U)
+		src.pps_mv = RDO_PPS_MV(rdo);
+
+	push_ctrl(now + T_RESPONSE, CTRL_ACCEPT);
+	push_ctrl(now + T_RESPONSE + T_SRC_TRANSITION, CTRL_PS_RDY);
+}
+
+static void epr_mode(uint64_t now, const struct vsrc_msg *msg)
+{
+	uint32_t data;
+
+	switch (msg->data[0] >> 24) {
+	case EPR_ENTER:
+		if (src.sc != VSRC_EPR) {
+			/* EPR Capable bit not set in PDO */
+			data = EPR_MODE(EPR_ENTER_FAILED, 5);
+			push(now + T_RESPONSE, DATA_EPR_MODE, 1, &data, false);
+			break;
+		}
+		data = EPR_MODE(EPR_ENTER_ACK, 0);
+		push(now + T_RESPONSE, DATA_EPR_MODE, 1, &data, false);
+		data = EPR_MODE(EPR_ENTER_SUCCEEDED, 0);
+		push(now + T_RESPONSE + T_EPR_ENTER, DATA_EPR_MODE, 1, &data,
+		     false);
+		src.epr = true;
+		push_epr_caps(now + 2 * T_RESPONSE + T_EPR_ENTER);
+		break;
+	case EPR_EXIT:
+		src.epr = false;
+		push_caps(now + T_RESPONSE);
+		break;
+	default:
+		push_unsupported(now + T_RESPONSE);
+		break;
+	}
+}
+
+static void extended(uint64_t now, const struct vsrc_msg *msg)
+{
+	uint16_t ext = msg->data[0] & 0xFFFF;
+	int type = VSRC_HDR_TYPE(msg->header);
+	uint8_t ack[2] = { EXTCTRL_EPR_KEEPALIVE_ACK, 0 };
+
+	if (VSRC_EXT_REQUEST(ext)) {
+		/* Sink asks for next chunk of our message */
+		if (type == src.ext_type)
+			push_ext_chunk(now + T_RESPONSE, VSRC_EXT_CHUNK(ext));
+		return;
+	}
+
+	if (type != EXT_CONTROL || VSRC_EXT_SIZE(ext) != 2) {
+		push_unsupported(now + T_RESPONSE);
+		return;
+	}
+
+	switch ((msg->data[0] >> 16) & 0xFF) {
+	case EXTCTRL_EPR_GET_SOURCE_CAP:
+		push_epr_caps(now + T_RESPONSE);
+		break;
+	case EXTCTRL_EPR_KEEPALIVE:
+		push_ext(now + T_RESPONSE, EXT_CONTROL, ack, sizeof(ack));
+		break;
+	default:
+		push_unsupported(now + T_RESPONSE);
+		break;
+	}
+}
+
+static void pps_status(uint64_t now)
+{
+	uint16_t mv = src.pps_mv ? src.pps_mv / 20 : 0xFFFF;
+	/* Voltage, current not measured, no flags */
+	uint8_t st[4] = { mv & 0xFF, mv >> 8, 0xFF, 0 };
+
+	push_ext(now + T_RESPONSE, EXT_PPS_STATUS, st, sizeof(st));
+}
+
+void vsrc_receive(uint64_t now, const struct vsrc_msg *msg)
+{
+	int type = VSRC_HDR_TYPE(msg->header);
+
+	if (VSRC_HDR_EXT(msg->header)) {
+		if (src.rev >= 2)
+			extended(now, msg);
+		return;
+	}
+
+	if (!VSRC_HDR_CNT(msg->header)) {
+		switch (type) {
+		case CTRL_SOFT_RESET:
+			src.q_cnt = 0;
+			src.msg_id = 0;
+			src.epr = false;
+			push_ctrl(now + T_RESPONSE, CTRL_ACCEPT);
+			push_caps(now + 2 * T_RESPONSE);
+			break;
+		case CTRL_GET_SOURCE_CAP:
+			push_caps(now + T_RESPONSE);
+			break;
+		case CTRL_GET_PPS_STATUS:
+			if (src.sc == VSRC_PPS)
+				pps_status(now);
+			else
+				push_unsupported(now + T_RESPONSE);
+			break;
+		default:
+			push_unsupported(now + T_RESPONSE);
+			break;
+		}
+		return;
+	}
+
+	switch (type) {
+	case DATA_REQUEST:
+		request(now, msg, false);
+		break;
+	case DATA_EPR_REQUEST:
+		request(now, msg, true);
+		break;
+	case DATA_EPR_MODE:
+		epr_mode(now, msg);
+		break;
+	case DATA_VENDOR_DEFINED:
+		/* PD2.0 ignores unsupported VDMs */
+		if (src.rev >= 2)
+			push_unsupported(now + T_RESPONSE);
+		break;
+	default:
+		push_unsupported(now + T_RESPONSE);
+		break;
+	}
+}
+
+uint64_t vsrc_next_due(void)
+{
+	return src.q_cnt ? src.q[src.q_head].due : UINT64_MAX;
+}
+
+bool vsrc_pop(uint64_t now, struct vsrc_msg *msg)
+{
+	if (!src.q_cnt || src.q[src.q_head].due > now)
+		return false;
+
+	*msg = src.q[src.q_head].msg;
+	src.q_head = (src.q_head + 1) % QUEUE_LEN;
+	src.q_cnt--;
+
+	if (!VSRC_HDR_CNT(msg->header) &&
+	    VSRC_HDR_TYPE(msg->header) == CTRL_PS_RDY)
+		src.contracts++;
+
+	return true;
+}
+
+int vsrc_contracts(void)
+{
+	return src.contracts;
+}
+
+bool vsrc_in_epr(void)
+{
+	return src.epr;
+}
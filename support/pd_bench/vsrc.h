@@ -0,0 +1,114 @@
+/*
+ * Scripted USB PD source partner, for host runs of the sink stack.
+ *
+ * Speaks raw PD messages (16-bit header and up to 7 data objects), as
+ * they pass through a TCPC. GoodCRC and retries are not modelled, every
+ * message is delivered. Time is virtual, in microseconds, and supplied by
+ * caller. Only SOP is used.
+ *
+ * Self-contained, builds without the stack and EC headers.
+ */
+
+#ifndef __VSRC_H
+#define __VSRC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum vsrc_scenario {
+	/* PD 2.0, fixed 5V / 9V */
+	VSRC_PD20,
+	/* PD 3.0, fixed 5V..20V */
+	VSRC_PD30,
+	/* PD 3.0, fixed 5V / 9V and PPS 3.3-11V */
+	VSRC_PPS,
+	/* PD 3.1, SPR 5V..20V, EPR 28V and AVS 15-28V */
+	VSRC_EPR,
+	VSRC_SCENARIO_COUNT
+};
+
+struct vsrc_msg {
+	uint16_t header;
+	uint32_t data[7];
+};
+
+/* Message header fields, USB PD r3.1 6.2.1.1 */
+#define VSRC_HDR_TYPE(h) ((h) & 0x1F)
+#define VSRC_HDR_REV(h) (((h) >> 6) & 3)
+#define VSRC_HDR_ID(h) (((h) >> 9) & 7)
+#define VSRC_HDR_CNT(h) (((h) >> 12) & 7)
+#define VSRC_HDR_EXT(h) (((h) >> 15) & 1)
+
+/* Extended message header, first 16 bits of payload */
+#define VSRC_EXT_SIZE(e) ((e) & 0x1FF)
+#define VSRC_EXT_REQUEST(e) (((e) >> 10) & 1)
+#define VSRC_EXT_CHUNK(e) (((e) >> 11) & 0xF)
+#define VSRC_EXT_CHUNKED(e) (((e) >> 15) & 1)
+
+/* Max data bytes in one chunk */
+#define VSRC_CHUNK_BYTES 26
+
+/**
+ * Get scenario name.
+ *
+ * @param sc Scenario
+ * @return Name
+ */
+const char *vsrc_name(enum vsrc_scenario sc);
+
+/**
+ * Attach source. First Source_Capabilities is scheduled after
+ * tFirstSourceCap.
+ *
+ * @param sc  Scenario
+ * @param now Current time, us
+ */
+void vsrc_attach(enum vsrc_scenario sc, uint64_t now);
+
+/**
+ * Hard Reset, sent by sink. Source restarts from the first
+ * Source_Capabilities, in SPR mode.
+ *
+ * @param now Current time, us
+ */
+void vsrc_hard_reset(uint64_t now);
+
+/**
+ * Pass message sent by sink. Replies are scheduled with source side delays.
+ *
+ * @param now Time when message was sent, us
+ * @param msg Message
+ */
+void vsrc_receive(uint64_t now, const struct vsrc_msg *msg);
+
+/**
+ * Get time when next message for sink is due.
+ *
+ * @return Time, us. UINT64_MAX if nothing is scheduled.
+ */
+uint64_t vsrc_next_due(void);
+
+/**
+ * Take next message for sink, if it is due.
+ *
+ * @param now Current time, us
+ * @param msg Destination
+ * @return true if message was taken
+ */
+bool vsrc_pop(uint64_t now, struct vsrc_msg *msg);
+
+/**
+ * Get number of PS_RDY sent since attach.
+ *
+ * @return Number of contracts
+ */
+int vsrc_contracts(void);
+
+/**
+ * Check if source is in EPR mode.
+ *
+ * @return true in EPR mode
+ */
+bool vsrc_in_epr(void);
+
+#endif /* __VSRC_H */
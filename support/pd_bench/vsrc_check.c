@@ -0,0 +1,207 @@
+/*
+ * Self-check of the scripted source, with a minimal reference sink. Runs
+ * each scenario to the expected number of contracts, and prints virtual
+ * time of each PS_RDY. Does not use the stack, see harness.c for that.
+ *
+ *   cc -o vsrc_check vsrc.c vsrc_check.c && ./vsrc_check
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vsrc.h"
+
+/* Sink reply delay, us */
+#define T_SINK 1000
+/* Give up after 5s of virtual time */
+#define T_LIMIT 5000000
+
+static struct {
+	enum vsrc_scenario sc;
+	int rev;
+	int msg_id;
+	bool epr;
+	bool pps_status;
+	bool keepalive_ack;
+	/* Extended message reassembly */
+	uint8_t ext[64];
+	int ext_got;
+} snk;
+
+static void send(uint64_t now, int type, int cnt, const uint32_t *data,
+		 bool ext)
+{
+	struct vsrc_msg msg = { 0 };
+
+	/* Sink, UFP */
+	msg.header = type | (snk.rev << 6) | (snk.msg_id << 9) | (cnt << 12) |
+		     ((ext ? 1 : 0) << 15);
+	if (cnt)
+		memcpy(msg.data, data, cnt * sizeof(uint32_t));
+	snk.msg_id = (snk.msg_id + 1) & 7;
+
+	vsrc_receive(now + T_SINK, &msg);
+}
+
+static uint32_t rdo_fixed(int pos, uint32_t pdo)
+{
+	uint32_t ma = pdo & 0x3FF;
+
+	/* Position, EPR mode capable, operating and max current */
+	return ((uint32_t)pos << 28) | (1U << 22) | (ma << 10) | ma;
+}
+
+static void source_cap(uint64_t now, const struct vsrc_msg *msg)
+{
+	int cnt = VSRC_HDR_CNT(msg->header);
+	const uint32_t *pdo = msg->data;
+	uint32_t rdo;
+	int pos = cnt;
+
+	snk.rev = VSRC_HDR_REV(msg->header) < 2 ? 1 : 2;
+
+	if (snk.sc == VSRC_PPS) {
+		/* PPS APDO at 9V, 2A */
+		for (pos = cnt; pos > 1; pos--)
+			if ((pdo[pos - 1] >> 28) == 0xC)
+				break;
+		rdo = ((uint32_t)pos << 28) | ((9000 / 20) << 9) | (2000 / 50);
+	} else {
+		/* Highest fixed voltage, SPR PDOs are sorted */
+		rdo = rdo_fixed(pos, pdo[pos - 1]);
+	}
+
+	send(now, 0x02, 1, &rdo, false);
+}
+
+static void epr_source_cap(uint64_t now)
+{
+	uint32_t data[2];
+	/* First EPR PDO, 28V */
+	int pos = 8;
+	int i;
+
+	data[1] = 0;
+	for (i = 0; i < 4; i++)
+		data[1] |= (uint32_t)snk.ext[4 * (pos - 1) + i] << (8 * i);
+	data[0] = rdo_fixed(pos, data[1]);
+
+	send(now, 0x09, 2, data, false);
+}
+
+static void extended(uint64_t now, const struct vsrc_msg *msg)
+{
+	uint8_t b[28];
+	uint16_t ext;
+	int size, chunk, len, i;
+	uint32_t req;
+
+	for (i = 0; i < 28; i++)
+		b[i] = msg->data[i / 4] >> (8 * (i % 4));
+
+	ext = b[0] | (b[1] << 8);
+	size = VSRC_EXT_SIZE(ext);
+	chunk = VSRC_EXT_CHUNK(ext);
+	len = size - chunk * VSRC_CHUNK_BYTES;
+	if (len > VSRC_CHUNK_BYTES)
+		len = VSRC_CHUNK_BYTES;
+
+	if (!chunk)
+		snk.ext_got = 0;
+	memcpy(snk.ext + snk.ext_got, b + 2, len);
+	snk.ext_got += len;
+
+	if (snk.ext_got < size) {
+		/* Request next chunk */
+		req = (1 << 15) | ((chunk + 1) << 11) | (1 << 10);
+		send(now, VSRC_HDR_TYPE(msg->header), 1, &req, true);
+		return;
+	}
+
+	switch (VSRC_HDR_TYPE(msg->header)) {
+	case 0x11:
+		epr_source_cap(now);
+		break;
+	case 0x0C:
+		snk.pps_status = true;
+		break;
+	case 0x10:
+		if (snk.ext[0] == 4)
+			snk.keepalive_ack = true;
+		break;
+	}
+}
+
+static void receive(uint64_t now, const struct vsrc_msg *msg)
+{
+	int type = VSRC_HDR_TYPE(msg->header);
+	/* EPR_Mode Enter, sink PDP 140W */
+	uint32_t enter = (1U << 24) | (140 << 16);
+	/* Extended_Control EPR_KeepAlive */
+	uint32_t keepalive = (1 << 15) | 2 | (3 << 16);
+
+	if (VSRC_HDR_EXT(msg->header)) {
+		extended(now, msg);
+		return;
+	}
+
+	if (VSRC_HDR_CNT(msg->header)) {
+		if (type == 0x01)
+			source_cap(now, msg);
+		else if (type == 0x0A && (msg->data[0] >> 24) == 3)
+			snk.epr = true;
+		return;
+	}
+
+	/* PS_RDY */
+	if (type != 0x06)
+		return;
+
+	printf("  %-6s contract %d at %8llu us\n", vsrc_name(snk.sc),
+	       vsrc_contracts(), (unsigned long long)now);
+
+	if (snk.sc == VSRC_PPS)
+		send(now, 0x14, 0, NULL, false);
+	if (snk.sc == VSRC_EPR && !snk.epr)
+		send(now, 0x0A, 1, &enter, false);
+	if (snk.sc == VSRC_EPR && snk.epr)
+		send(now, 0x10, 1, &keepalive, true);
+}
+
+static int run(enum vsrc_scenario sc, int contracts)
+{
+	struct vsrc_msg msg;
+	uint64_t now = 0;
+	bool done;
+
+	memset(&snk, 0, sizeof(snk));
+	snk.sc = sc;
+	vsrc_attach(sc, now);
+
+	while ((now = vsrc_next_due()) < T_LIMIT) {
+		while (vsrc_pop(now, &msg))
+			receive(now, &msg);
+	}
+
+	done = vsrc_contracts() == contracts;
+	if (sc == VSRC_PPS)
+		done = done && snk.pps_status;
+	if (sc == VSRC_EPR)
+		done = done && snk.epr && vsrc_in_epr() && snk.keepalive_ack;
+
+	printf("%-6s %s\n", vsrc_name(sc), done ? "ok" : "FAILED");
+
+	return done ? 0 : 1;
+}
+
+int main(void)
+{
+	int err = 0;
+
+	err |= run(VSRC_PD20, 1);
+	err |= run(VSRC_PD30, 1);
+	err |= run(VSRC_PPS, 1);
+	err |= run(VSRC_EPR, 2);
+
+	return err;
+}
@@ -0,0 +1,114 @@
+--
+-- Wireshark dissector for PD packet capture, exported with
+-- `pd_capture_write_pcap()` (CONFIG_PD_CAPTURE). Link type is USER0 (147),
+-- format is described in include/pd_capture.h.
+--
+-- Usage: wireshark -X lua_script:support/pd_capture.lua capture.pcap
+--
+
+local p = Proto('pdcap', 'USB PD capture')
+
+local SOP = {
+    [0] = "SOP", [1] = "SOP'", [2] = "SOP''", [3] = "SOP'_Debug",
+    [4] = "SOP''_Debug", [5] = 'Hard Reset', [6] = 'Cable Reset',
+    [7] = 'BIST Mode 2',
+}
+local STATUS = { [0] = 'pending', [1] = 'ok', [2] = 'discarded', [3] = 'failed' }
+
+local CTRL = {
+    [1] = 'GoodCRC', [2] = 'GotoMin', [3] = 'Accept', [4] = 'Reject',
+    [5] = 'Ping', [6] = 'PS_RDY', [7] = 'Get_Source_Cap',
+    [8] = 'Get_Sink_Cap', [9] = 'DR_Swap', [10] = 'PR_Swap',
+    [11] = 'VCONN_Swap', [12] = 'Wait', [13] = 'Soft_Reset',
+    [14] = 'Data_Reset', [15] = 'Data_Reset_Complete',
+    [16] = 'Not_Supported', [17] = 'Get_Source_Cap_Extended',
+    [18] = 'Get_Status', [19] = 'FR_Swap', [20] = 'Get_PPS_Status',
+    [21] = 'Get_Country_Codes', [22] = 'Get_Sink_Cap_Extended',
+    [23] = 'Get_Source_Info', [24] = 'Get_Revision',
+}
+local DATA = {
+    [1] = 'Source_Capabilities', [2] = 'Request', [3] = 'BIST',
+    [4] = 'Sink_Capabilities', [5] = 'Battery_Status', [6] = 'Alert',
+    [7] = 'Get_Country_Info', [8] = 'Enter_USB', [9] = 'EPR_Request',
+    [10] = 'EPR_Mode', [11] = 'Source_Info', [12] = 'Revision',
+    [15] = 'Vendor_Defined',
+}
+local EXT = {
+    [1] = 'Source_Capabilities_Extended', [2] = 'Status',
+    [3] = 'Get_Battery_Cap', [4] = 'Get_Battery_Status',
+    [5] = 'Battery_Capabilities', [6] = 'Get_Manufacturer_Info',
+    [7] = 'Manufacturer_Info', [8] = 'Security_Request',
+    [9] = 'Security_Response', [10] = 'Firmware_Update_Request',
+    [11] = 'Firmware_Update_Response', [12] = 'PPS_Status',
+    [13] = 'Country_Info', [14] = 'Country_Codes',
+    [15] = 'Sink_Capabilities_Extended', [16] = 'Extended_Control',
+    [17] = 'EPR_Source_Capabilities', [18] = 'EPR_Sink_Capabilities',
+    [30] = 'Vendor_Defined_Extended',
+}
+
+local f = {
+    sop = ProtoField.uint8('pdcap.sop', 'SOP*', base.DEC, SOP),
+    dir = ProtoField.string('pdcap.dir', 'Direction'),
+    status = ProtoField.string('pdcap.tx_status', 'TX status'),
+    port = ProtoField.uint8('pdcap.port', 'Port'),
+    header = ProtoField.uint16('pdcap.header', 'Header', base.HEX),
+    type = ProtoField.string('pdcap.type', 'Message type'),
+    id = ProtoField.uint16('pdcap.id', 'MessageID', base.DEC, nil, 0x0e00),
+    cnt = ProtoField.uint16('pdcap.cnt', 'Data objects', base.DEC, nil,
+                            0x7000),
+    rev = ProtoField.uint16('pdcap.rev', 'Spec revision', base.DEC, nil,
+                            0x00c0),
+    ext = ProtoField.uint16('pdcap.ext', 'Extended', base.DEC, nil, 0x8000),
+    obj = ProtoField.uint32('pdcap.obj', 'Data object', base.HEX),
+}
+p.fields = { f.sop, f.dir, f.status, f.port, f.header, f.type, f.id, f.cnt,
+             f.rev, f.ext, f.obj }
+
+function p.dissector(buf, pinfo, tree)
+    local sop = buf(0, 1):uint()
+    local flags = buf(1, 1):uint()
+    local tx = bit.band(flags, 1) == 1
+    local t = tree:add(p, buf())
+    local info
+
+    pinfo.cols.protocol = 'USB PD'
+    t:add(f.sop, buf(0, 1))
+    t:add(f.dir, buf(1, 1), tx and 'TX' or 'RX')
+    if tx then
+        t:add(f.status, buf(1, 1),
+              STATUS[bit.rshift(bit.band(flags, 0x0e), 1)] or '?')
+    end
+    t:add(f.port, buf(2, 1))
+
+    if buf:len() < 6 then
+        info = SOP[sop] or 'Unknown'
+    else
+        local hdr = buf(4, 2):le_uint()
+        local mt = bit.band(hdr, 0x1f)
+        local cnt = bit.band(bit.rshift(hdr, 12), 7)
+        local names = (bit.band(hdr, 0x8000) ~= 0) and EXT or
+                      (cnt > 0 and DATA or CTRL)
+
+        info = (names[mt] or ('Type ' .. mt))
+        t:add_le(f.header, buf(4, 2))
+        t:add(f.type, buf(4, 2), info)
+        t:add_le(f.id, buf(4, 2))
+        t:add_le(f.cnt, buf(4, 2))
+        t:add_le(f.rev, buf(4, 2))
+        t:add_le(f.ext, buf(4, 2))
+        for i = 0, cnt - 1 do
+            if 6 + i * 4 + 4 <= buf:len() then
+                t:add_le(f.obj, buf(6 + i * 4, 4))
+            end
+        end
+        info = (SOP[sop] or '?') .. ' ' .. info ..
+               ' id=' .. bit.band(bit.rshift(hdr, 9), 7)
+    end
+
+    pinfo.cols.src = tx and 'local' or 'partner'
+    pinfo.cols.dst = tx and 'partner' or 'local'
+    pinfo.cols.info = 'C' .. buf(2, 1):uint() .. ' ' ..
+                      (tx and 'TX ' or 'RX ') .. info
+end
+
+DissectorTable.get('wtap_encap'):add(wtap.USER0, p)
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+
+#
+# Per-module footprint of PD stack objects, to compare build profiles (for
+# example default vs CONFIG_PD_SINK_ONLY). Runs binutils `size` on object
+# files, tool can be overridden with SIZE env var.
+#
+# Usage: size_report.py [--save out.json] [--diff base.json] <obj|dir>...
+#
+# Directories are scanned recursively for *.o / *.obj files.
+#
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+SIZE = os.environ.get('SIZE', 'arm-none-eabi-size')
+
+
+def find_objects(paths):
+    objs = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, files in os.walk(path):
+                objs += [os.path.join(root, f) for f in files
+                         if f.endswith(('.o', '.obj'))]
+        else:
+            objs.append(path)
+    return sorted(objs)
+
+
+def module_name(obj):
+    name = os.path.basename(obj)
+    # CMake names objects like `usb_pe_drp_sm.c.o`
+    for ext in ('.o', '.obj', '.c', '.cpp'):
+        if name.endswith(ext):
+            name = name[:-len(ext)]
+    return name
+
+
+def measure(objs):
+    # Berkeley format: text data bss dec hex filename
+    out = subprocess.run([SIZE, '-B'] + objs, check=True,
+                         capture_output=True, text=True).stdout
+    sizes = {}
+    for line in out.splitlines()[1:]:
+        fields = line.split(None, 5)
+        if len(fields) < 6:
+            continue
+        text, data, bss = (int(x) for x in fields[:3])
+        mod = module_name(fields[5])
+        prev = sizes.get(mod, (0, 0, 0))
+        sizes[mod] = (prev[0] + text, prev[1] + data, prev[2] + bss)
+    return sizes
+
+
+def print_report(sizes, base):
+    def row(name, vals, ref):
+        cols = ''.join(f'{v:9d}' for v in vals)
+        if ref is not None:
+            cols += ''.join(f'{v - r:+9d}' for v, r in zip(vals, ref))
+        print(f'{name:28}{cols}')
+
+    hdr = f'{"module":28}{"text":>9}{"data":>9}{"bss":>9}'
+    if base is not None:
+        hdr += f'{"+/-text":>9}{"+/-data":>9}{"+/-bss":>9}'
+    print(hdr)
+
+    for mod in sorted(set(sizes) | set(base or {})):
+        vals = sizes.get(mod, (0, 0, 0))
+        row(mod, vals, None if base is None else base.get(mod, (0, 0, 0)))
+
+    total = tuple(sum(v[i] for v in sizes.values()) for i in range(3))
+    ref = None
+    if base is not None:
+        ref = tuple(sum(v[i] for v in base.values()) for i in range(3))
+    row('TOTAL', total, ref)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Per-module text/data/bss of PD stack objects')
+    parser.add_argument('paths', nargs='+', help='object files or dirs')
+    parser.add_argument('--save', help='store sizes as JSON baseline')
+    parser.add_argument('--diff', help='compare with JSON baseline')
+    args = parser.parse_args()
+
+    objs = find_objects(args.paths)
+    if not objs:
+        print('No object files found')
+        sys.exit(1)
+
+    sizes = measure(objs)
+
+    base = None
+    if args.diff:
+        with open(args.diff, encoding='utf-8') as f:
+            base = {k: tuple(v) for k, v in json.load(f).items()}
+
+    print_report(sizes, base)
+
+    if args.save:
+        with open(args.save, 'w', encoding='utf-8') as f:
+            json.dump(sizes, f, indent=2, sort_keys=True)
+
+
+if __name__ == '__main__':
+    main()
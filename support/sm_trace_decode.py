@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+
+#
+# Decodes binary state transition trace, collected with CONFIG_USB_SM_TRACE
+# (see `usb_sm_trace_read()`). State indexes are mapped back to names, parsed
+# from the sources, so the same tree must be used as for the firmware.
+#
+# Usage: sm_trace_decode.py <trace.bin> [src_dir]
+#
+# Input is a raw dump of `struct usb_sm_trace_rec` records (little endian).
+#
+
+import os
+import re
+import struct
+import sys
+
+# Order must match `enum usb_sm_id` in include/usb_sm.h
+STATE_MACHINES = [
+    ('DPM', 'usb_pd_dpm.c', 'usb_dpm_state', 'dpm_state_names'),
+    ('PE', 'usb_pe_drp_sm.c', 'usb_pe_state', 'pe_state_names'),
+    ('PRL_TX', 'usb_prl_sm.c', 'usb_prl_tx_state', 'prl_tx_state_names'),
+    ('PRL_HR', 'usb_prl_sm.c', 'usb_prl_hr_state', 'prl_hr_state_names'),
+    ('RCH', 'usb_prl_sm.c', 'usb_rch_state', 'rch_state_names'),
+    ('TCH', 'usb_prl_sm.c', 'usb_tch_state', 'tch_state_names'),
+]
+
+RECORD = struct.Struct('<IBBBB')
+NO_STATE = 0xFF
+
+
+def strip_comments(text):
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+    return re.sub(r'//[^\n]*', '', text)
+
+
+def parse_states(src, enum_name, names_name):
+    # Enum members, in declaration order
+    m = re.search(r'enum\s+' + enum_name + r'\s*\{(.*?)\};', src, re.S)
+    if not m:
+        return []
+    members = [x.split('=')[0].strip() for x in m.group(1).split(',')]
+    members = [x for x in members if x]
+
+    # Optional human readable names
+    labels = {}
+    m = re.search(names_name + r'\[\]\s*=\s*\{(.*?)\};', src, re.S)
+    if m:
+        for key, label in re.findall(r'\[(\w+)\]\s*=\s*"([^"]*)"', m.group(1)):
+            labels[key] = label
+
+    return [labels.get(x, x) for x in members]
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(f'Usage: {sys.argv[0]} <trace.bin> [src_dir]')
+        sys.exit(1)
+
+    src_dir = sys.argv[2] if len(sys.argv) > 2 else os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), '..', 'src')
+
+    tables = []
+    for sm, file, enum_name, names_name in STATE_MACHINES:
+        with open(os.path.join(src_dir, file), encoding='utf-8') as f:
+            src = strip_comments(f.read())
+        tables.append((sm, parse_states(src, enum_name, names_name)))
+
+    with open(sys.argv[1], 'rb') as f:
+        data = f.read()
+
+    prev_ts = None
+    for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+        ts, port, sm_id, src_idx, dst_idx = RECORD.unpack_from(data, offset)
+
+        if sm_id >= len(tables):
+            print(f'{ts:10d} C{port}: unknown state machine {sm_id}')
+            continue
+
+        sm, names = tables[sm_id]
+
+        def name(idx):
+            if idx == NO_STATE:
+                return '-'
+            return names[idx] if idx < len(names) else f'#{idx}'
+
+        delta = '' if prev_ts is None else f'(+{(ts - prev_ts) & 0xFFFFFFFF}us)'
+        prev_ts = ts
+        print(f'{ts:10d} {delta:>12} C{port}: {sm:6} '
+              f'{name(src_idx)} -> {name(dst_idx)}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,63 @@
+#ifndef __PD_HOST_ATOMIC_H
+#define __PD_HOST_ATOMIC_H
+
+#include "common.h"
+
+/* EC atomic_t API on top of GCC builtins */
+typedef uint32_t atomic_t;
+typedef atomic_t atomic_val_t;
+
+#define ATOMIC_BITS 32
+#define ATOMIC_ELEM(addr, bit) ((addr) + ((bit) / ATOMIC_BITS))
+#define ATOMIC_MASK(bit) (1U << ((bit) % ATOMIC_BITS))
+#define ATOMIC_DEFINE(name, num_bits) \
+	atomic_t name[DIV_ROUND_UP(num_bits, ATOMIC_BITS)]
+
+static inline atomic_val_t atomic_or(atomic_t *addr, atomic_val_t bits)
+{
+	return __atomic_fetch_or(addr, bits, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_clear_bits(atomic_t *addr, atomic_val_t bits)
+{
+	return __atomic_fetch_and(addr, ~bits, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_clear(atomic_t *addr)
+{
+	return __atomic_exchange_n(addr, 0, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_get(const atomic_t *addr)
+{
+	return __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+}
+
+static inline bool atomic_test_bit(const atomic_t *addr, int bit)
+{
+	return atomic_get(ATOMIC_ELEM(addr, bit)) & ATOMIC_MASK(bit);
+}
+
+static inline void atomic_set_bit(atomic_t *addr, int bit)
+{
+	atomic_or(ATOMIC_ELEM(addr, bit), ATOMIC_MASK(bit));
+}
+
+static inline void atomic_clear_bit(atomic_t *addr, int bit)
+{
+	atomic_clear_bits(ATOMIC_ELEM(addr, bit), ATOMIC_MASK(bit));
+}
+
+static inline bool atomic_test_and_clear_bit(atomic_t *addr, int bit)
+{
+	return atomic_clear_bits(ATOMIC_ELEM(addr, bit), ATOMIC_MASK(bit)) &
+	       ATOMIC_MASK(bit);
+}
+
+static inline bool atomic_test_and_set_bit(atomic_t *addr, int bit)
+{
+	return atomic_or(ATOMIC_ELEM(addr, bit), ATOMIC_MASK(bit)) &
+	       ATOMIC_MASK(bit);
+}
+
+#endif /* __PD_HOST_ATOMIC_H */
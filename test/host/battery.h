@@ -0,0 +1,15 @@
+#ifndef __PD_HOST_BATTERY_H
+#define __PD_HOST_BATTERY_H
+
+#include "common.h"
+
+enum battery_present {
+	BP_NOT_INIT = -1,
+	BP_NO = 0,
+	BP_YES = 1,
+	BP_NOT_SURE,
+};
+
+enum battery_present battery_is_present(void);
+
+#endif /* __PD_HOST_BATTERY_H */
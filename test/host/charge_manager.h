@@ -0,0 +1,32 @@
+#ifndef __PD_HOST_CHARGE_MANAGER_H
+#define __PD_HOST_CHARGE_MANAGER_H
+
+#include "common.h"
+
+#define CHARGE_PORT_NONE -1
+
+enum charge_supplier {
+	CHARGE_SUPPLIER_NONE = -1,
+	CHARGE_SUPPLIER_PD,
+	CHARGE_SUPPLIER_TYPEC,
+};
+
+enum ceil_requestor {
+	CEIL_REQUESTOR_PD,
+	CEIL_REQUESTOR_HOST,
+};
+
+enum dualrole_capabilities {
+	CAP_UNKNOWN,
+	CAP_DUALROLE,
+	CAP_DEDICATED,
+};
+
+void charge_manager_update_dualrole(int port, enum dualrole_capabilities cap);
+void charge_manager_set_ceil(int port, enum ceil_requestor requestor, int ceil);
+void charge_manager_force_ceil(int port, int ceil);
+int charge_manager_get_active_charge_port(void);
+int charge_manager_get_supplier(void);
+int charge_manager_get_charger_voltage(void);
+
+#endif /* __PD_HOST_CHARGE_MANAGER_H */
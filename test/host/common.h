@@ -0,0 +1,95 @@
+/*
+ * Host build shim for EC headers, used by tests and support/pd_bench.
+ * Only what the stack actually touches is provided.
+ */
+
+#ifndef __PD_HOST_COMMON_H
+#define __PD_HOST_COMMON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pd_config.h"
+
+#define BIT(n) (1U << (n))
+#define BIT_ULL(n) (1ULL << (n))
+#define GENMASK(h, l) (((~0U) << (l)) & (~0U >> (31 - (h))))
+
+#define __packed __attribute__((packed))
+#define __aligned(x) __attribute__((aligned(x)))
+#define __fallthrough __attribute__((fallthrough))
+#define __overridable __attribute__((weak))
+#define __override
+#define __override_proto
+#define __unused __attribute__((unused))
+#define test_export_static static
+#define STATIC_IF(opt) static
+#define STATIC_IF_NOT(opt) static
+
+#define test_mockable
+#define test_mockable_static static
+#define test_mockable_static_inline static inline
+
+#define BUILD_ASSERT(cond, ...) _Static_assert(cond, #cond)
+#define member_size(type, member) sizeof(((type *)0)->member)
+
+#define __ARG_PLACEHOLDER_ _,
+#define IS_ENABLED(option) __is_enabled(option)
+#define __is_enabled(value) ___is_enabled(__ARG_PLACEHOLDER_##value)
+#define ___is_enabled(arg1) ____is_enabled(arg1 1, 0)
+#define ____is_enabled(ignored, val, ...) val
+
+#define ASSERT(cond) ((void)(cond))
+#define assert(cond) ((void)(cond))
+
+#define ccprintf(...) ((void)0)
+#define cprints(...) ((void)0)
+#define cprintf(...) ((void)0)
+
+enum ec_error_list {
+	EC_SUCCESS = 0,
+	EC_ERROR_UNKNOWN = 1,
+	EC_ERROR_UNIMPLEMENTED = 2,
+	EC_ERROR_OVERFLOW = 3,
+	EC_ERROR_TIMEOUT = 4,
+	EC_ERROR_INVAL = 5,
+	EC_ERROR_BUSY = 6,
+	EC_ERROR_ACCESS_DENIED = 7,
+	EC_ERROR_NOT_POWERED = 8,
+	EC_ERROR_NOT_CALIBRATED = 9,
+	EC_ERROR_CRC = 10,
+	EC_ERROR_PARAM1 = 11,
+	EC_ERROR_PARAM2 = 12,
+	EC_ERROR_NOT_HANDLED = 13,
+	EC_ERROR_UNCHANGED = 14,
+};
+
+/*
+ * On EC, these come with the board config and other headers. The stripped
+ * stack headers expect them to be visible already.
+ */
+#include "ec_commands.h"
+#include "util.h"
+#include "atomic.h"
+#include "task.h"
+#include "timer.h"
+#include "usb_pd_tcpm.h"
+#include "hooks.h"
+#include "system.h"
+#include "usb_common.h"
+#include "vpd_api.h"
+
+/*
+ * Application side of the port: the stack expects its own API and the TCPM
+ * wrappers to be declared too.
+ */
+#include <tcpm.h>
+#include "src/portage/pd_loop.h"
+#include "usb_pd_dpm_sm.h"
+#include "usb_pe_sm.h"
+#include "usb_prl_sm.h"
+#include "usb_tc_sm.h"
+
+#endif /* __PD_HOST_COMMON_H */
@@ -0,0 +1,6 @@
+#ifndef __PD_HOST_CONSOLE_H
+#define __PD_HOST_CONSOLE_H
+
+#include "common.h"
+
+#endif /* __PD_HOST_CONSOLE_H */
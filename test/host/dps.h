@@ -0,0 +1,8 @@
+#ifndef __PD_HOST_DPS_H
+#define __PD_HOST_DPS_H
+
+#include "common.h"
+
+void dps_update_stabilized_time(int port);
+
+#endif /* __PD_HOST_DPS_H */
@@ -0,0 +1 @@
+#include <tcpm.h>
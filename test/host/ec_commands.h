@@ -0,0 +1,194 @@
+/*
+ * Host shim: protocol types EC keeps in ec_commands.h, usb_pd_vdo.h and
+ * board config, which the stripped headers expect to be visible.
+ */
+
+#ifndef __PD_HOST_EC_COMMANDS_H
+#define __PD_HOST_EC_COMMANDS_H
+
+#include <stdint.h>
+
+#define CONFIG_USB_PD_3A_PORTS 0
+
+enum ec_status {
+	EC_RES_SUCCESS = 0,
+	EC_RES_INVALID_COMMAND = 1,
+	EC_RES_ERROR = 2,
+	EC_RES_INVALID_PARAM = 3,
+	EC_RES_ACCESS_DENIED = 4,
+	EC_RES_UNAVAILABLE = 9,
+	EC_RES_BUSY = 16,
+};
+
+enum ec_bus_type {
+	EC_BUS_TYPE_I2C,
+	EC_BUS_TYPE_EMBEDDED,
+};
+
+enum pd_power_role {
+	PD_ROLE_SINK = 0,
+	PD_ROLE_SOURCE = 1,
+};
+
+enum pd_data_role {
+	PD_ROLE_UFP = 0,
+	PD_ROLE_DFP = 1,
+	PD_ROLE_DISCONNECTED = 2,
+};
+
+/* PD_ROLE_VCONN_OFF is a define in usb_pd.h */
+enum pd_vconn_role {
+	PD_ROLE_VCONN_SRC = 1,
+};
+
+enum tcpc_cc_polarity {
+	POLARITY_CC1 = 0,
+	POLARITY_CC2 = 1,
+	POLARITY_CC1_DTS = 2,
+	POLARITY_CC2_DTS = 3,
+	POLARITY_COUNT,
+};
+
+enum typec_mode {
+	TYPEC_MODE_DP = 0,
+	TYPEC_MODE_TBT = 1,
+	TYPEC_MODE_USB4 = 2,
+};
+
+enum mask_update_action {
+	MASK_SET = 0,
+	MASK_CLR = 1,
+};
+
+enum gpio_signal {
+	GPIO_COUNT,
+};
+
+#define PD_STATUS_EVENT_SOP_DISC_DONE BIT(0)
+#define PD_STATUS_EVENT_SOP_PRIME_DISC_DONE BIT(1)
+#define PD_STATUS_EVENT_HARD_RESET BIT(2)
+#define PD_STATUS_EVENT_DISCONNECTED BIT(3)
+#define PD_STATUS_EVENT_MUX_0_SET_DONE BIT(4)
+#define PD_STATUS_EVENT_MUX_1_SET_DONE BIT(5)
+#define PD_STATUS_EVENT_VDM_REQ_REPLY BIT(6)
+#define PD_STATUS_EVENT_VDM_REQ_FAILED BIT(7)
+#define PD_STATUS_EVENT_VDM_ATTENTION BIT(8)
+
+#define CONFIG_USB_PD_PULLUP TYPEC_RP_1A5
+#define PD_POWER_SUPPLY_TURN_ON_DELAY (30 * MSEC)
+#define PD_POWER_SUPPLY_TURN_OFF_DELAY (15 * MSEC)
+
+/* Host events, see pd_send_host_event() */
+#define PD_EVENT_POWER_CHANGE BIT(1)
+#define PD_EVENT_TYPEC BIT(3)
+
+enum ec_image {
+	EC_IMAGE_UNKNOWN = 0,
+	EC_IMAGE_RO,
+	EC_IMAGE_RW,
+};
+
+#define EC_RESET_FLAG_SYSJUMP BIT(5)
+#define EC_RESET_FLAG_AP_OFF BIT(14)
+#define EC_RESET_FLAG_STAY_IN_RO BIT(19)
+
+struct ec_response_pd_chip_info_v1 {
+	uint16_t vendor_id;
+	uint16_t product_id;
+	uint16_t device_id;
+	union {
+		uint8_t fw_version_string[8];
+		uint64_t fw_version_number;
+	};
+	union {
+		uint8_t min_req_fw_version_string[8];
+		uint64_t min_req_fw_version_number;
+	};
+} __packed;
+
+enum typec_tbt_ufp_reply {
+	UFP_NAK,
+	UFP_ACK,
+};
+
+/* VDM payload, one header and up to six objects */
+#define VDO_MAX_SIZE 7
+#define VDO_MAX_OBJECTS (VDO_MAX_SIZE - 1)
+
+#define VDM_VERS_MINOR 0
+
+enum idh_ptype {
+	IDH_PTYPE_UNDEF = 0,
+	IDH_PTYPE_HUB = 1,
+	IDH_PTYPE_PERIPH = 2,
+	IDH_PTYPE_PSD = 3,
+	IDH_PTYPE_AMA = 5,
+	IDH_PTYPE_VPD = 6,
+};
+
+#define VDO_UFP1_CAPABILITY_USB4 BIT(3)
+
+union ufp_vdo_rev30 {
+	struct {
+		uint32_t alternate_modes : 3;
+		uint32_t usb_highest_speed : 3;
+		uint32_t reserved0 : 16;
+		uint32_t device_capability : 4;
+		uint32_t reserved1 : 6;
+	};
+	uint32_t raw_value;
+};
+
+union vpd_vdo {
+	uint32_t raw_value;
+};
+
+struct id_header_vdo_rev20 {
+	uint32_t raw_value;
+};
+
+union id_header_vdo {
+	uint32_t raw_value;
+};
+
+struct cert_stat_vdo {
+	uint32_t raw_value;
+};
+
+struct product_vdo {
+	uint32_t raw_value;
+};
+
+union product_type_vdo1 {
+	uint32_t raw_value;
+	union vpd_vdo vpd;
+};
+
+union product_type_vdo2 {
+	uint32_t raw_value;
+};
+
+union tbt_mode_resp_device {
+	uint32_t raw_value;
+};
+
+union tbt_mode_resp_cable {
+	uint32_t raw_value;
+};
+
+#define PDO_TYPE_FIXED (0U << 30)
+#define PDO_TYPE_BATTERY (1U << 30)
+#define PDO_TYPE_VARIABLE (2U << 30)
+#define PDO_TYPE_AUGMENTED (3U << 30)
+#define PDO_TYPE_MASK (3U << 30)
+
+#define PDO_FIXED_VOLTAGE(p) ((((p) >> 10) & 0x3FF) * 50)
+#define PDO_FIXED_CURRENT(p) (((p) & 0x3FF) * 10)
+
+#define PDO_FIXED_DUAL_ROLE BIT(29)
+#define PDO_FIXED_UNCONSTRAINED BIT(27)
+#define PDO_FIXED_COMM_CAP BIT(26)
+#define PDO_FIXED_DATA_SWAP BIT(25)
+#define PDO_FIXED_FRS_CURR_MASK (3 << 23)
+
+#endif /* __PD_HOST_EC_COMMANDS_H */
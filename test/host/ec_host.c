@@ -0,0 +1,247 @@
+/*
+ * Host build shim: EC services and board hooks the stack calls, which are
+ * not part of this port. Defaults match a sink-only board without alternate
+ * modes. Type-C layer is not here, each host program stubs it itself.
+ */
+
+#include "charge_manager.h"
+#include "common.h"
+#include "usb_pd.h"
+#include "usb_pd_pdo.h"
+
+/*
+ * Board
+ */
+
+const uint32_t pd_src_pdo[] = {
+	PDO_FIXED(5000, 1500, PDO_FIXED_UNCONSTRAINED),
+};
+const int pd_src_pdo_cnt = ARRAY_SIZE(pd_src_pdo);
+const uint32_t pd_src_pdo_max[] = {
+	PDO_FIXED(5000, 3000, PDO_FIXED_UNCONSTRAINED),
+};
+const int pd_src_pdo_max_cnt = ARRAY_SIZE(pd_src_pdo_max);
+
+const uint32_t pd_snk_pdo[] = {
+	PDO_FIXED(5000, 500, PDO_FIXED_COMM_CAP),
+	PDO_FIXED(9000, 3000, 0),
+	PDO_FIXED(20000, 5000, 0),
+};
+const int pd_snk_pdo_cnt = ARRAY_SIZE(pd_snk_pdo);
+
+uint8_t board_get_usb_pd_port_count(void)
+{
+	return CONFIG_USB_PD_PORT_MAX_COUNT;
+}
+
+void pd_set_input_current_limit(int port, uint32_t max_ma,
+				uint32_t supply_voltage)
+{
+}
+
+int pd_check_data_swap(int port, enum pd_data_role data_role)
+{
+	return 0;
+}
+
+int pd_check_power_swap(int port)
+{
+	return 0;
+}
+
+bool port_discovery_dr_swap_policy(int port, enum pd_data_role dr,
+				   bool dr_swap_flag)
+{
+	return false;
+}
+
+bool port_discovery_vconn_swap_policy(int port, bool vconn_swap_flag)
+{
+	return false;
+}
+
+bool port_frs_disable_until_source_on(int port)
+{
+	return false;
+}
+
+int typec_get_default_current_limit_rp(int port)
+{
+	return TYPEC_RP_USB;
+}
+
+/*
+ * Discovery, not done by sink-only port
+ */
+
+void pd_disable_discovery(int port)
+{
+}
+
+enum pd_discovery_state pd_get_identity_discovery(int port,
+						  enum tcpci_msg_type type)
+{
+	return PD_DISC_FAIL;
+}
+
+void pd_set_identity_discovery(int port, enum tcpci_msg_type type,
+			       enum pd_discovery_state disc)
+{
+}
+
+enum pd_discovery_state pd_get_svids_discovery(int port,
+					       enum tcpci_msg_type type)
+{
+	return PD_DISC_FAIL;
+}
+
+enum pd_discovery_state pd_get_modes_discovery(int port,
+					       enum tcpci_msg_type type)
+{
+	return PD_DISC_FAIL;
+}
+
+bool pd_is_mode_discovered_for_svid(int port, enum tcpci_msg_type type,
+				    uint16_t svid)
+{
+	return false;
+}
+
+bool pd_alt_mode_capable(int port)
+{
+	return false;
+}
+
+enum idh_ptype get_usb_pd_cable_type(int port)
+{
+	return IDH_PTYPE_UNDEF;
+}
+
+bool is_vpd_ct_supported(int port)
+{
+	return false;
+}
+
+uint8_t pd_get_product_type(int port)
+{
+	return IDH_PTYPE_UNDEF;
+}
+
+/*
+ * Alternate modes and AP VDM control, compiled in but never entered
+ */
+
+void dp_init(int port)
+{
+}
+
+bool dp_is_active(int port)
+{
+	return false;
+}
+
+bool dp_is_idle(int port)
+{
+	return true;
+}
+
+bool dp_entry_is_done(int port)
+{
+	return false;
+}
+
+bool dp_mode_entry_allowed(int port)
+{
+	return false;
+}
+
+void dp_vdm_acked(int port, enum tcpci_msg_type type, int vdo_count,
+		  const uint32_t *vdm)
+{
+}
+
+void dp_vdm_naked(int port, enum tcpci_msg_type type, uint8_t vdm_cmd)
+{
+}
+
+int dp_setup_next_vdm(int port, int *vdo_count, uint32_t *vdm)
+{
+	return -1;
+}
+
+void ap_vdm_init(int port)
+{
+}
+
+void ap_vdm_acked(int port, enum tcpci_msg_type type, int vdo_count,
+		  uint32_t *vdm)
+{
+}
+
+void ap_vdm_naked(int port, enum tcpci_msg_type type, uint16_t svid,
+		  uint8_t vdm_cmd, uint32_t vdm_header)
+{
+}
+
+void ap_vdm_attention_enqueue(int port, int length, uint32_t *buf)
+{
+}
+
+/*
+ * Charge manager, not used by the port
+ */
+
+void charge_manager_update_dualrole(int port, enum dualrole_capabilities cap)
+{
+}
+
+void charge_manager_set_ceil(int port, enum ceil_requestor requestor, int ceil)
+{
+}
+
+void charge_manager_force_ceil(int port, int ceil)
+{
+}
+
+int charge_manager_get_active_charge_port(void)
+{
+	return CHARGE_PORT_NONE;
+}
+
+int charge_manager_get_supplier(void)
+{
+	return CHARGE_SUPPLIER_NONE;
+}
+
+int charge_manager_get_charger_voltage(void)
+{
+	return 0;
+}
+
+/*
+ * OS
+ */
+
+int hook_call_deferred(const struct deferred_data *data, int us)
+{
+	return EC_SUCCESS;
+}
+
+bool in_deferred_context(void)
+{
+	return false;
+}
+
+uint32_t time_since32(timestamp_t start)
+{
+	return get_time().le.lo - start.le.lo;
+}
+
+void task_set_event(task_id_t tskid, uint32_t event)
+{
+}
+
+uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
+{
+	return event_mask;
+}
@@ -0,0 +1,20 @@
+#ifndef __PD_HOST_HOOKS_H
+#define __PD_HOST_HOOKS_H
+
+#include "common.h"
+
+/* Hooks are not used by the port, handlers are left unreferenced */
+#define DECLARE_HOOK(hooktype, routine, priority) \
+	void (*const routine##_hook)(void) __unused = routine
+
+struct deferred_data {
+	void (*routine)(void);
+};
+
+#define DECLARE_DEFERRED(routine) \
+	static const struct deferred_data routine##_data = { routine }
+
+int hook_call_deferred(const struct deferred_data *data, int us);
+bool in_deferred_context(void);
+
+#endif /* __PD_HOST_HOOKS_H */
@@ -0,0 +1,31 @@
+#ifndef __PD_HOST_I2C_H
+#define __PD_HOST_I2C_H
+
+#include "common.h"
+
+struct i2c_info_t {
+	uint16_t port;
+	uint16_t addr_flags;
+};
+
+int i2c_read8(int port, uint16_t addr_flags, int offset, int *data);
+int i2c_write8(int port, uint16_t addr_flags, int offset, int data);
+int i2c_read16(int port, uint16_t addr_flags, int offset, int *data);
+int i2c_write16(int port, uint16_t addr_flags, int offset, int data);
+int i2c_update8(int port, uint16_t addr_flags, int offset, uint8_t mask,
+		enum mask_update_action action);
+int i2c_update16(int port, uint16_t addr_flags, int offset, uint16_t mask,
+		 enum mask_update_action action);
+int i2c_read_block(int port, uint16_t addr_flags, int offset, uint8_t *data,
+		   int len);
+int i2c_write_block(int port, uint16_t addr_flags, int offset,
+		    const uint8_t *data, int len);
+int i2c_xfer(int port, uint16_t addr_flags, const uint8_t *out, int out_size,
+	     uint8_t *in, int in_size);
+int i2c_xfer_unlocked(int port, uint16_t addr_flags, const uint8_t *out,
+		      int out_size, uint8_t *in, int in_size, int flags);
+void i2c_lock(int port, int lock);
+
+#define I2C_XFER_SINGLE 3
+
+#endif /* __PD_HOST_I2C_H */
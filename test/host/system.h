@@ -0,0 +1,12 @@
+#ifndef __PD_HOST_SYSTEM_H
+#define __PD_HOST_SYSTEM_H
+
+#include "common.h"
+
+uint32_t system_get_reset_flags(void);
+enum ec_image system_get_image_copy(void);
+int system_is_locked(void);
+uint32_t chip_read_reset_flags(void);
+void chip_save_reset_flags(uint32_t flags);
+
+#endif /* __PD_HOST_SYSTEM_H */
@@ -0,0 +1,34 @@
+#ifndef __PD_HOST_TASK_H
+#define __PD_HOST_TASK_H
+
+#include "common.h"
+
+typedef int mutex_t;
+typedef uint8_t task_id_t;
+
+#define TASK_ID_INVALID 0xff
+#define TASK_ID_TO_PD_PORT(id) ((int)(id))
+#define K_MUTEX_DEFINE(name) mutex_t name
+
+#define TASK_EVENT_CUSTOM_BIT(x) BIT(x)
+#define TASK_EVENT_SYSJUMP_READY BIT(16)
+
+static inline void mutex_lock(mutex_t *mtx)
+{
+	(void)mtx;
+}
+
+static inline void mutex_unlock(mutex_t *mtx)
+{
+	(void)mtx;
+}
+
+static inline task_id_t task_get_current(void)
+{
+	return 0;
+}
+
+void task_set_event(task_id_t tskid, uint32_t event);
+uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us);
+
+#endif /* __PD_HOST_TASK_H */
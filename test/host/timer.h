@@ -0,0 +1,11 @@
+#ifndef __PD_HOST_TIMER_H
+#define __PD_HOST_TIMER_H
+
+#include "common.h"
+
+#define MSEC 1000
+#define SECOND 1000000
+
+uint32_t time_since32(timestamp_t start);
+
+#endif /* __PD_HOST_TIMER_H */
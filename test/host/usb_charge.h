@@ -0,0 +1,6 @@
+#ifndef __PD_HOST_USB_CHARGE_H
+#define __PD_HOST_USB_CHARGE_H
+
+#include "common.h"
+
+#endif /* __PD_HOST_USB_CHARGE_H */
@@ -0,0 +1,47 @@
+#ifndef __PD_HOST_USB_COMMON_H
+#define __PD_HOST_USB_COMMON_H
+
+#include "common.h"
+
+/*
+ * Alternate modes, USB4 and AP VDM control. Not built by the port, only
+ * declared for branches that are compiled out by IS_ENABLED().
+ */
+void dp_init(int port);
+bool dp_is_active(int port);
+bool dp_is_idle(int port);
+bool dp_entry_is_done(int port);
+bool dp_mode_entry_allowed(int port);
+void dp_vdm_acked(int port, enum tcpci_msg_type type, int vdo_count,
+		  const uint32_t *vdm);
+void dp_vdm_naked(int port, enum tcpci_msg_type type, uint8_t vdm_cmd);
+int dp_setup_next_vdm(int port, int *vdo_count, uint32_t *vdm);
+
+void tbt_init(int port);
+bool tbt_is_active(int port);
+bool tbt_entry_is_done(int port);
+void tbt_exit_mode_request(int port);
+bool tbt_cable_entry_required_for_usb4(int port);
+int tbt_setup_next_vdm(int port, int *vdo_count, uint32_t *vdm,
+		       enum tcpci_msg_type *tx_type);
+
+void enter_usb_init(int port);
+bool enter_usb_entry_is_done(int port);
+bool enter_usb_port_partner_is_capable(int port);
+bool enter_usb_cable_is_capable(int port);
+void enter_usb_accepted(int port, enum tcpci_msg_type type);
+void enter_usb_rejected(int port, enum tcpci_msg_type type);
+void enter_usb_failed(int port);
+uint32_t enter_usb_setup_next_msg(int port, enum tcpci_msg_type *type);
+void usb4_exit_mode_request(int port);
+
+void ap_vdm_init(int port);
+void ap_vdm_acked(int port, enum tcpci_msg_type type, int vdo_count,
+		  uint32_t *vdm);
+void ap_vdm_naked(int port, enum tcpci_msg_type type, uint16_t svid,
+		  uint8_t vdm_cmd, uint32_t vdm_header);
+void ap_vdm_attention_enqueue(int port, int length, uint32_t *buf);
+
+bool usb_mux_set_completed(int port);
+
+#endif /* __PD_HOST_USB_COMMON_H */
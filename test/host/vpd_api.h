@@ -0,0 +1,8 @@
+#ifndef __PD_HOST_VPD_API_H
+#define __PD_HOST_VPD_API_H
+
+#include "common.h"
+
+void vpd_rx_enable(int en);
+
+#endif /* __PD_HOST_VPD_API_H */
@@ -0,0 +1,132 @@
+/*
+ * Packet capture export: rings of all ports go to one pcap file, merged by
+ * timestamp, and overwritten records are skipped.
+ */
+
+#include "test_util.h"
+
+#include "../src/portage/pd_capture.c"
+
+static uint64_t now;
+
+timestamp_t get_time(void)
+{
+	timestamp_t t = { .val = now };
+
+	return t;
+}
+
+static uint8_t out[4096];
+static int out_len;
+
+static int write_buf(void *ctx, const void *data, int len)
+{
+	if (out_len + len > sizeof(out))
+		return 1;
+	memcpy(out + out_len, data, len);
+	out_len += len;
+	return 0;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* Parsed pcap records: time, port, SOP* */
+static struct {
+	uint64_t ts;
+	int port;
+	int sop;
+} pkt[64];
+static int pkt_cnt;
+
+static int export(void)
+{
+	const uint8_t *p = out + 24;
+
+	out_len = 0;
+	TEST_EQ(pd_capture_write_pcap(write_buf, NULL), 0, "%lld");
+	TEST_EQ(get_le32(out), 0xA1B2C3D4, "0x%llx");
+	TEST_EQ(get_le32(out + 20), PD_CAPTURE_LINKTYPE, "%lld");
+
+	for (pkt_cnt = 0; p < out + out_len; pkt_cnt++) {
+		const uint32_t len = get_le32(p + 8);
+
+		TEST_ASSERT(pkt_cnt < ARRAY_SIZE(pkt));
+		pkt[pkt_cnt].ts = get_le32(p) * 1000000ULL + get_le32(p + 4);
+		pkt[pkt_cnt].sop = p[16];
+		pkt[pkt_cnt].port = p[18];
+		p += 16 + len;
+	}
+	TEST_ASSERT(p == out + out_len);
+
+	return EC_SUCCESS;
+}
+
+static void tx_at(int port, uint64_t ts, int sop)
+{
+	const uint32_t payload[1] = { 0x12345678 };
+
+	now = ts;
+	pd_capture_tx(port, sop, PD_HEADER(PD_DATA_REQUEST, 0, 0, 0, 1, 0, 0),
+		      payload);
+}
+
+static int test_merge_by_time(void)
+{
+	const uint32_t payload[1] = { 0 };
+
+	tx_at(0, 1000000, TCPCI_MSG_SOP);
+	tx_at(1, 1000100, TCPCI_MSG_SOP);
+	/* RX recorded late, but stamped with reception time */
+	now = 1000400;
+	pd_capture_rx(1, 1000200,
+		      PD_HEADER(PD_CTRL_ACCEPT, 0, 0, 0, 0, 0, 0) |
+			      PD_HEADER_SOP(TCPCI_MSG_SOP_PRIME),
+		      payload);
+	tx_at(0, 1000300, TCPCI_MSG_SOP);
+	tx_at(1, 2500000, TCPCI_MSG_SOP);
+
+	TEST_EQ(export(), EC_SUCCESS, "%lld");
+	TEST_EQ(pkt_cnt, 5, "%lld");
+	for (int i = 1; i < pkt_cnt; i++)
+		TEST_ASSERT(pkt[i].ts >= pkt[i - 1].ts);
+	TEST_EQ(pkt[0].port, 0, "%lld");
+	TEST_EQ(pkt[1].port, 1, "%lld");
+	TEST_EQ(pkt[2].port, 1, "%lld");
+	TEST_EQ(pkt[2].sop, TCPCI_MSG_SOP_PRIME, "%lld");
+	TEST_EQ(pkt[2].ts, 1000200, "%lld");
+	TEST_EQ(pkt[3].port, 0, "%lld");
+	TEST_EQ(pkt[4].ts, 2500000, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_overwritten_skipped(void)
+{
+	/* One port wraps its ring, the other keeps its few records */
+	for (int i = 0; i < 3 * CAPTURE_DEPTH; i++)
+		tx_at(0, 3000000 + i * 10, TCPCI_MSG_SOP);
+	tx_at(1, 3000005, TCPCI_MSG_SOP);
+
+	TEST_EQ(export(), EC_SUCCESS, "%lld");
+	/* Port 1: 3 old + 1 new, port 0: the newest DEPTH - 1 */
+	TEST_EQ(pkt_cnt, 4 + CAPTURE_DEPTH - 1, "%lld");
+	for (int i = 1; i < pkt_cnt; i++)
+		TEST_ASSERT(pkt[i].ts >= pkt[i - 1].ts);
+	TEST_EQ(pkt[pkt_cnt - 1].ts, 3000000 + (3 * CAPTURE_DEPTH - 1) * 10,
+		"%lld");
+
+	return EC_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	test_init(argc, argv);
+
+	RUN_TEST(test_merge_by_time);
+	RUN_TEST(test_overwritten_skipped);
+
+	return test_print_result();
+}
@@ -0,0 +1,241 @@
+/*
+ * Tickless event loop against virtual clock: wakeups are programmed for the
+ * nearest deadline of all ports, and nothing else wakes the loop.
+ */
+
+#include "test_util.h"
+
+#include "../src/usb_pd_timer.c"
+#include "../src/portage/pd_loop.c"
+
+#define ARM_NONE (-2)
+
+static uint64_t now;
+/* Last pd_loop_timer_arm() request, ARM_NONE if not called */
+static int32_t armed = ARM_NONE;
+
+/* Timer to start from the next pe_run() pass of each port */
+static struct {
+	enum pd_task_timer timer;
+	uint32_t us;
+	bool pending;
+} start[MAX_PD_PORTS];
+
+static int expired[MAX_PD_PORTS];
+
+/* Called from inside pd_loop_timer_arm(), to emulate preemption */
+static void (*arm_hook)(void);
+
+timestamp_t get_time(void)
+{
+	timestamp_t t = { .val = now };
+
+	return t;
+}
+
+uint32_t get_ticks(void)
+{
+	return now;
+}
+
+void pd_loop_timer_arm(int32_t delay_us)
+{
+	void (*hook)(void) = arm_hook;
+
+	/* Preempted before this request reached the hardware */
+	arm_hook = NULL;
+	if (hook)
+		hook();
+
+	armed = delay_us;
+}
+
+uint8_t tc_get_pd_enabled(int port)
+{
+	return 1;
+}
+
+void dpm_run(int port, int evt, int en)
+{
+}
+
+void pe_run(int port, int evt, int en)
+{
+	if (start[port].pending) {
+		start[port].pending = false;
+		pd_timer_enable(port, start[port].timer, start[port].us);
+	}
+
+	if (pd_timer_is_expired(port, PE_TIMER_SENDER_RESPONSE) &&
+	    !pd_timer_is_disabled(port, PE_TIMER_SENDER_RESPONSE)) {
+		pd_timer_disable(port, PE_TIMER_SENDER_RESPONSE);
+		expired[port]++;
+	}
+}
+
+void prl_run(int port, int evt, int en)
+{
+}
+
+static void reset(void)
+{
+	now = 1000000;
+	armed = ARM_NONE;
+	arm_hook = NULL;
+
+	for (int port = 0; port < MAX_PD_PORTS; port++) {
+		pd_timer_init(port);
+		start[port].pending = false;
+		expired[port] = 0;
+		/* Rebuild wakeup_at[] from idle timers */
+		pd_loop_wake(port);
+	}
+}
+
+static void start_timer(int port, enum pd_task_timer timer, uint32_t us)
+{
+	start[port].timer = timer;
+	start[port].us = us;
+	start[port].pending = true;
+	pd_loop_wake(port);
+}
+
+/* Advance virtual time to the armed wakeup, and fire it */
+static void fire(void)
+{
+	now += armed;
+	armed = ARM_NONE;
+	pd_loop_handle_timer_interrupt();
+}
+
+static int test_single_wakeup(void)
+{
+	reset();
+
+	start_timer(0, PE_TIMER_SENDER_RESPONSE, 27000);
+	TEST_EQ(armed, 27000, "%lld");
+
+	fire();
+	TEST_EQ(expired[0], 1, "%lld");
+	/* Nothing left, wakeup is cancelled */
+	TEST_EQ(armed, -1, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_nearest_of_ports(void)
+{
+	reset();
+
+	start_timer(0, PE_TIMER_SENDER_RESPONSE, 30000);
+	start_timer(1, PE_TIMER_SENDER_RESPONSE, 10000);
+	TEST_EQ(armed, 10000, "%lld");
+
+	fire();
+	TEST_EQ(expired[1], 1, "%lld");
+	TEST_EQ(expired[0], 0, "%lld");
+	/* Port 0 deadline is still remembered */
+	TEST_EQ(armed, 20000, "%lld");
+
+	fire();
+	TEST_EQ(expired[0], 1, "%lld");
+	TEST_EQ(armed, -1, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_far_deadline(void)
+{
+	const uint32_t far = 3000000000U;
+	int wakeups = 0;
+
+	reset();
+
+	/* Beyond int32_t range, must be armed in steps, not dropped */
+	start_timer(0, PE_TIMER_SENDER_RESPONSE, far);
+	TEST_EQ(armed, MAX_EXPIRE, "%lld");
+
+	while (!expired[0] && wakeups < 4) {
+		TEST_ASSERT(armed > 0);
+		fire();
+		wakeups++;
+	}
+	TEST_EQ(expired[0], 1, "%lld");
+	TEST_EQ(wakeups, 2, "%lld");
+	TEST_EQ(now, 1000000 + far, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_expired_in_pass(void)
+{
+	reset();
+
+	/* Zero timeout expires at once, loop re-runs instead of arming 0 */
+	start_timer(0, PE_TIMER_SENDER_RESPONSE, 0);
+	TEST_EQ(expired[0], 1, "%lld");
+	TEST_EQ(armed, -1, "%lld");
+
+	return EC_SUCCESS;
+}
+
+/* Port 1 loop preempts port 0 while it arms the timer */
+static void preempt_port1(void)
+{
+	start_timer(1, PE_TIMER_SENDER_RESPONSE, 5000);
+}
+
+static int test_preempted_arm(void)
+{
+	reset();
+
+	arm_hook = preempt_port1;
+	start_timer(0, PE_TIMER_SENDER_RESPONSE, 40000);
+
+	/*
+	 * Port 1 armed 5ms, then overwritten by port 0 stale request. Port 0
+	 * must notice the update and re-arm from a fresh scan.
+	 */
+	TEST_EQ(armed, 5000, "%lld");
+
+	fire();
+	TEST_EQ(expired[1], 1, "%lld");
+	TEST_EQ(armed, 35000, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_no_periodic_wakeups(void)
+{
+	int wakeups = 0;
+
+	reset();
+
+	start_timer(0, PE_TIMER_SENDER_RESPONSE, 100000);
+	start_timer(1, PE_TIMER_SENDER_RESPONSE, 250000);
+
+	while (armed >= 0) {
+		fire();
+		wakeups++;
+	}
+
+	/* One wakeup per deadline, 250ms of virtual time */
+	TEST_EQ(wakeups, 2, "%lld");
+	TEST_EQ(expired[0] + expired[1], 2, "%lld");
+
+	return EC_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	test_init(argc, argv);
+
+	RUN_TEST(test_single_wakeup);
+	RUN_TEST(test_nearest_of_ports);
+	RUN_TEST(test_far_deadline);
+	RUN_TEST(test_expired_in_pass);
+	RUN_TEST(test_preempted_arm);
+	RUN_TEST(test_no_periodic_wakeups);
+
+	return test_print_result();
+}
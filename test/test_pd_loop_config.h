@@ -0,0 +1,4 @@
+#undef CONFIG_USB_PD_PORT_MAX_COUNT
+#define CONFIG_USB_PD_PORT_MAX_COUNT 2
+
+#define CONFIG_PD_LOOP_TICKLESS
@@ -0,0 +1,376 @@
+/*
+ * Sink power policy, table driven: source capabilities and policy in, the
+ * requested PDO and operating point out.
+ */
+
+#include "test_util.h"
+
+#include "../src/portage/pd_snk_policy.c"
+
+#define PORT 0
+
+/* 65W SPR charger */
+#define CAPS_65W                                                     \
+	PDO_FIXED(5000, 3000, 0), PDO_FIXED(9000, 3000, 0),          \
+		PDO_FIXED(15000, 3000, 0), PDO_FIXED(20000, 3250, 0), \
+		PDO_AUG(3300, 21000, 3000)
+
+static const struct pd_snk_eff_point eff_steep[] = {
+	{ .mv = 5000, .pct = 95 },
+	{ .mv = 20000, .pct = 40 },
+};
+
+struct policy_case {
+	const char *name;
+	uint32_t pdo[PDO_MAX_OBJECTS];
+	int cnt;
+	struct pd_snk_policy p;
+	/* Expected RDO, without Cap Mismatch and EPR Mode Capable */
+	uint32_t rdo;
+	uint32_t mv;
+	uint32_t ma;
+	bool mismatch;
+};
+
+static const struct policy_case cases[] = {
+	{
+		.name = "max power",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .min_mv = 5000, .max_mv = 20000 },
+		.rdo = RDO_FIXED(4, 3250, 3250, 0),
+		.mv = 20000,
+		.ma = 3250,
+	},
+	{
+		.name = "max power, voltage window",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .min_mv = 5000, .max_mv = 12000 },
+		.rdo = RDO_FIXED(2, 3000, 3000, 0),
+		.mv = 9000,
+		.ma = 3000,
+	},
+	{
+		.name = "max power, power limit tie takes lower voltage",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .min_mv = 5000, .max_mv = 20000, .max_mw = 30000 },
+		.rdo = RDO_FIXED(3, 2000, 2000, 0),
+		.mv = 15000,
+		.ma = 2000,
+	},
+	{
+		.name = "max power, current limit",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .min_mv = 5000, .max_mv = 20000, .max_ma = 1500 },
+		.rdo = RDO_FIXED(4, 1500, 1500, 0),
+		.mv = 20000,
+		.ma = 1500,
+	},
+	{
+		.name = "prefer voltage",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .mode = PD_SNK_POLICY_PREFER_VOLTAGE,
+		       .min_mv = 5000, .max_mv = 20000,
+		       .pref_mv = 9000, .op_mw = 20000 },
+		.rdo = RDO_FIXED(2, 3000, 3000, 0),
+		.mv = 9000,
+		.ma = 3000,
+	},
+	{
+		.name = "prefer voltage, preferred one too weak",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .mode = PD_SNK_POLICY_PREFER_VOLTAGE,
+		       .min_mv = 5000, .max_mv = 20000,
+		       .pref_mv = 5000, .op_mw = 20000 },
+		.rdo = RDO_FIXED(2, 3000, 3000, 0),
+		.mv = 9000,
+		.ma = 3000,
+	},
+	{
+		.name = "prefer voltage, none strong enough",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .mode = PD_SNK_POLICY_PREFER_VOLTAGE,
+		       .min_mv = 5000, .max_mv = 20000,
+		       .pref_mv = 5000, .op_mw = 100000 },
+		.rdo = RDO_FIXED(4, 3250, 3250, 0),
+		.mv = 20000,
+		.ma = 3250,
+		.mismatch = true,
+	},
+	{
+		.name = "prefer voltage, PPS",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .mode = PD_SNK_POLICY_PREFER_VOLTAGE,
+		       .min_mv = 5000, .max_mv = 20000,
+		       .pref_mv = 11010, .allow_apdo = true },
+		/* Rounded down to 20mV step */
+		.rdo = RDO_PPS(5, 11000, 3000, 0),
+		.mv = 11000,
+		.ma = 3000,
+	},
+	{
+		.name = "efficiency",
+		.pdo = { CAPS_65W },
+		.cnt = 5,
+		.p = { .mode = PD_SNK_POLICY_EFFICIENCY,
+		       .min_mv = 5000, .max_mv = 20000,
+		       .eff = eff_steep, .eff_cnt = ARRAY_SIZE(eff_steep) },
+		/* 45W * 59% beats 65W * 40% */
+		.rdo = RDO_FIXED(3, 3000, 3000, 0),
+		.mv = 15000,
+		.ma = 3000,
+	},
+	{
+		.name = "variable and battery",
+		.pdo = { PDO_FIXED(5000, 3000, 0), PDO_VAR(9000, 12000, 2000),
+			 PDO_BATT(9000, 15000, 30000) },
+		.cnt = 3,
+		.p = { .min_mv = 5000, .max_mv = 20000 },
+		/* 30W at 9V is 3333mA */
+		.rdo = RDO_BATT(3, 29997, 29997, 0),
+		.mv = 9000,
+		.ma = 3333,
+	},
+	{
+		.name = "battery out of window",
+		.pdo = { PDO_FIXED(5000, 3000, 0), PDO_VAR(9000, 12000, 2000),
+			 PDO_BATT(9000, 15000, 30000) },
+		.cnt = 3,
+		.p = { .min_mv = 5000, .max_mv = 12000 },
+		.rdo = RDO_FIXED(2, 2000, 2000, 0),
+		.mv = 9000,
+		.ma = 2000,
+	},
+	{
+		.name = "AVS current capped at 5A",
+		.pdo = { PDO_FIXED(5000, 3000, 0),
+			 PDO_AUG_EPR(15000, 48000, 240, 0) },
+		.cnt = 2,
+		.p = { .min_mv = 5000, .max_mv = 48000, .pref_mv = 20000,
+		       .allow_apdo = true },
+		/* 240W at 20V would be 12A */
+		.rdo = RDO_AVS(2, 20000, 5000, 0),
+		.mv = 20000,
+		.ma = 5000,
+	},
+	{
+		.name = "AVS current by PDP",
+		.pdo = { PDO_FIXED(5000, 3000, 0),
+			 PDO_AUG_EPR(15000, 48000, 140, 0) },
+		.cnt = 2,
+		.p = { .min_mv = 5000, .max_mv = 48000, .pref_mv = 36000,
+		       .allow_apdo = true },
+		/* 140W / 36V = 3888mA, in 50mA steps */
+		.rdo = RDO_AVS(2, 36000, 3850, 0),
+		.mv = 36000,
+		.ma = 3850,
+	},
+	{
+		.name = "APDO not allowed",
+		.pdo = { PDO_FIXED(5000, 3000, 0),
+			 PDO_AUG_EPR(15000, 48000, 240, 0) },
+		.cnt = 2,
+		.p = { .min_mv = 5000, .max_mv = 48000, .pref_mv = 20000 },
+		.rdo = RDO_FIXED(1, 3000, 3000, 0),
+		.mv = 5000,
+		.ma = 3000,
+	},
+	{
+		.name = "malformed PDOs skipped",
+		.pdo = { PDO_FIXED(5000, 3000, 0), PDO_FIXED(0, 5000, 0),
+			 PDO_VAR(12000, 9000, 3000),
+			 PDO_AUG(0, 21000, 3000) },
+		.cnt = 4,
+		.p = { .min_mv = 0, .max_mv = 20000, .allow_apdo = true },
+		.rdo = RDO_FIXED(1, 3000, 3000, 0),
+		.mv = 5000,
+		.ma = 3000,
+	},
+	{
+		.name = "nothing in window, vSafe5V",
+		.pdo = { PDO_FIXED(5000, 3000, 0) },
+		.cnt = 1,
+		.p = { .min_mv = 9000, .max_mv = 12000 },
+		.rdo = RDO_FIXED(1, 3000, 3000, 0),
+		.mv = 5000,
+		.ma = 3000,
+		.mismatch = true,
+	},
+};
+
+static int run_case(const struct policy_case *c)
+{
+	uint32_t pdo[PDO_MAX_OBJECTS];
+	uint32_t rdo, ma, mv;
+	const struct pd_snk_selection *sel = pd_snk_get_selection(PORT);
+
+	memcpy(pdo, c->pdo, sizeof(pdo));
+	pd_snk_set_policy(PORT, &c->p);
+	pd_process_source_cap(PORT, c->cnt, pdo);
+	pd_build_request(0, &rdo, &ma, &mv, PORT);
+
+	TEST_EQ(rdo & ~(RDO_CAP_MISMATCH | RDO_EPR_MODE_CAPABLE), c->rdo,
+		"0x%llx");
+	TEST_EQ(!!(rdo & RDO_CAP_MISMATCH), c->mismatch, "%lld");
+	TEST_EQ(mv, c->mv, "%lld");
+	TEST_EQ(ma, c->ma, "%lld");
+	TEST_EQ(sel->pos, RDO_POS(c->rdo), "%lld");
+	TEST_EQ(sel->pdo, c->pdo[RDO_POS(c->rdo) - 1], "0x%llx");
+	TEST_EQ(sel->mismatch, c->mismatch, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_policy_table(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(cases); i++) {
+		if (run_case(&cases[i]) != EC_SUCCESS) {
+			printf("case: %s\n", cases[i].name);
+			return EC_ERROR_UNKNOWN;
+		}
+	}
+	return EC_SUCCESS;
+}
+
+static const struct {
+	uint32_t pdo;
+	uint8_t type;
+	uint16_t min_mv;
+	uint16_t max_mv;
+	uint16_t lim;
+} decode_cases[] = {
+	{ PDO_FIXED(9000, 3000, 0), CAP_FIXED, 9000, 9000, 3000 },
+	{ PDO_VAR(5000, 12000, 2000), CAP_VARIABLE, 5000, 12000, 2000 },
+	/* Battery limit is kept in 250mW units */
+	{ PDO_BATT(5000, 20000, 45000), CAP_BATTERY, 5000, 20000, 180 },
+	{ PDO_AUG(3300, 21000, 5000), CAP_PPS, 3300, 21000, 5000 },
+	{ PDO_AUG_EPR(15000, 48000, 240, 0), CAP_AVS, 15000, 48000, 960 },
+	/* Malformed */
+	{ 0, CAP_NONE, 0, 0, 0 },
+	{ PDO_FIXED(0, 3000, 0), CAP_NONE, 0, 0, 0 },
+	{ PDO_VAR(12000, 9000, 3000), CAP_NONE, 0, 0, 0 },
+	{ PDO_BATT(0, 20000, 45000), CAP_NONE, 0, 0, 0 },
+	{ PDO_AUG(5000, 3300, 3000), CAP_NONE, 0, 0, 0 },
+	/* Reserved APDO type */
+	{ PDO_TYPE_AUGMENTED | PDO_AUG_PPS(3) | PDO_AUG_MAX_VOLT(9000),
+	  CAP_NONE, 0, 0, 0 },
+};
+
+static int test_decode_pdo(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(decode_cases); i++) {
+		uint8_t type;
+		uint16_t lo, hi, lim;
+
+		decode_pdo(decode_cases[i].pdo, &type, &lo, &hi, &lim);
+		TEST_EQ(type, decode_cases[i].type, "%lld");
+		TEST_EQ(lo, decode_cases[i].min_mv, "%lld");
+		TEST_EQ(hi, decode_cases[i].max_mv, "%lld");
+		TEST_EQ(lim, decode_cases[i].lim, "%lld");
+	}
+	return EC_SUCCESS;
+}
+
+static int test_empty_caps(void)
+{
+	uint32_t rdo, ma, mv;
+	const struct pd_snk_policy p = { .min_mv = 5000, .max_mv = 20000 };
+
+	pd_snk_set_policy(PORT, &p);
+	pd_process_source_cap(PORT, 0, NULL);
+	pd_build_request(0, &rdo, &ma, &mv, PORT);
+
+	TEST_EQ(mv, 5000, "%lld");
+	TEST_EQ(ma, 0, "%lld");
+	TEST_ASSERT(rdo & RDO_CAP_MISMATCH);
+
+	return EC_SUCCESS;
+}
+
+static int test_max_request_voltage(void)
+{
+	uint32_t pdo[] = { CAPS_65W };
+	const struct pd_snk_policy p = { .min_mv = 5000, .max_mv = 20000 };
+	uint32_t rdo, ma, mv;
+
+	pd_snk_set_policy(PORT, &p);
+	pd_process_source_cap(PORT, ARRAY_SIZE(pdo), pdo);
+
+	/* Global limit applies on top of policy, without re-decode */
+	pd_set_max_voltage(15000);
+	pd_build_request(0, &rdo, &ma, &mv, PORT);
+	pd_set_max_voltage(PD_MAX_VOLTAGE_MV);
+	TEST_EQ(RDO_POS(rdo), 3, "%lld");
+	TEST_EQ(mv, 15000, "%lld");
+
+	return EC_SUCCESS;
+}
+
+/* Source caps to request, as done by PE on each Source_Capabilities */
+static void bench_policy(const char *name, const uint32_t *caps, int cnt,
+			 const struct pd_snk_policy *p)
+{
+	const int rounds = 1000000;
+	uint32_t pdo[PDO_MAX_OBJECTS];
+	uint32_t rdo, ma, mv;
+	double t0;
+
+	memcpy(pdo, caps, cnt * sizeof(*caps));
+	pd_snk_set_policy(PORT, p);
+
+	t0 = test_host_ns();
+	for (int i = 0; i < rounds; i++) {
+		pd_process_source_cap(PORT, cnt, pdo);
+		pd_build_request(0, &rdo, &ma, &mv, PORT);
+	}
+	printf("%-28s %.1fns per caps + request\n", name,
+	       (test_host_ns() - t0) / rounds);
+}
+
+static void bench(void)
+{
+	static const uint32_t spr[] = { CAPS_65W };
+	static const uint32_t epr[] = {
+		PDO_FIXED(5000, 3000, 0),	   PDO_FIXED(9000, 3000, 0),
+		PDO_FIXED(15000, 3000, 0),	   PDO_FIXED(20000, 5000, 0),
+		PDO_AUG(3300, 21000, 5000),	   PDO_FIXED(28000, 5000, 0),
+		PDO_FIXED(36000, 5000, 0),	   PDO_FIXED(48000, 5000, 0),
+		PDO_AUG_EPR(15000, 48000, 240, 0),
+	};
+	const struct pd_snk_policy max = { .min_mv = 5000, .max_mv = 48000 };
+	const struct pd_snk_policy eff = {
+		.mode = PD_SNK_POLICY_EFFICIENCY,
+		.min_mv = 5000,
+		.max_mv = 48000,
+		.allow_apdo = true,
+		.eff = eff_steep,
+		.eff_cnt = ARRAY_SIZE(eff_steep),
+	};
+
+	bench_policy("SPR 5 PDOs, max power", spr, ARRAY_SIZE(spr), &max);
+	bench_policy("EPR 9 PDOs, max power", epr, ARRAY_SIZE(epr), &max);
+	bench_policy("EPR 9 PDOs, efficiency+APDO", epr, ARRAY_SIZE(epr),
+		     &eff);
+}
+
+int main(int argc, char **argv)
+{
+	test_init(argc, argv);
+
+	RUN_TEST(test_decode_pdo);
+	RUN_TEST(test_policy_table);
+	RUN_TEST(test_empty_caps);
+	RUN_TEST(test_max_request_voltage);
+
+	if (test_bench_enabled())
+		bench();
+
+	return test_print_result();
+}
@@ -0,0 +1,285 @@
+/*
+ * PD timers against brute-force reference model: random enable / disable /
+ * expiration sequences must give the same results, and the heap must stay
+ * consistent with the active timer set after each step.
+ */
+
+#include "test_util.h"
+
+#include "../src/usb_pd_timer.c"
+
+#define PORT 0
+#define STEPS 200000
+
+static uint64_t now;
+
+timestamp_t get_time(void)
+{
+	timestamp_t t = { .val = now };
+
+	return t;
+}
+
+uint32_t get_ticks(void)
+{
+	return now;
+}
+
+/* Reference model: one record per timer, no heap, no bitmasks */
+static struct {
+	bool active;
+	bool disabled;
+	uint64_t expires;
+} ref[PD_TIMER_COUNT];
+
+static uint32_t rnd_state = 12345;
+
+static uint32_t rnd(uint32_t n)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state % n;
+}
+
+static void ref_init(void)
+{
+	for (int t = 0; t < PD_TIMER_COUNT; t++) {
+		ref[t].active = false;
+		ref[t].disabled = true;
+	}
+}
+
+static void ref_expire(int t)
+{
+	if (ref[t].active && now >= ref[t].expires) {
+		ref[t].active = false;
+		ref[t].disabled = false;
+	}
+}
+
+static bool ref_is_expired(int t)
+{
+	if (ref[t].active) {
+		ref_expire(t);
+		return !ref[t].active;
+	}
+	return !ref[t].disabled;
+}
+
+static int ref_next_expiration(void)
+{
+	uint64_t nearest = UINT64_MAX;
+
+	for (int t = 0; t < PD_TIMER_COUNT; t++) {
+		if (ref[t].active && ref[t].expires < nearest)
+			nearest = ref[t].expires;
+	}
+
+	if (nearest == UINT64_MAX)
+		return NO_TIMEOUT;
+	if (nearest <= now)
+		return EXPIRE_NOW;
+	return MIN(nearest - now, MAX_EXPIRE);
+}
+
+/* Heap order, back references and size must match the active set */
+static int check_heap(void)
+{
+	const int size = timer_heap_size[PORT];
+
+	TEST_EQ(size, __builtin_popcountll(timer_active[PORT]), "%lld");
+
+	for (int i = 0; i < size; i++) {
+		const int t = timer_heap[PORT][i];
+
+		TEST_ASSERT(PD_CHK_ACTIVE(PORT, t));
+		TEST_EQ(timer_heap_pos[PORT][t], i + 1, "%lld");
+		if (i)
+			TEST_ASSERT(!PD_TIME_BEFORE(
+				heap_expires(PORT, i),
+				heap_expires(PORT, (i - 1) / 2)));
+	}
+
+	for (int t = 0; t < PD_TIMER_COUNT; t++) {
+		TEST_EQ(PD_CHK_ACTIVE(PORT, t), ref[t].active, "%lld");
+		TEST_EQ(pd_timer_is_disabled(PORT, t), ref[t].disabled,
+			"%lld");
+		if (!ref[t].active)
+			TEST_EQ(timer_heap_pos[PORT][t], 0, "%lld");
+	}
+
+	return EC_SUCCESS;
+}
+
+static void step(void)
+{
+	const int t = rnd(PD_TIMER_COUNT);
+
+	switch (rnd(6)) {
+	case 0:
+	case 1: {
+		/* Mostly short timeouts, sometimes zero or huge */
+		const uint32_t us = rnd(8) ? rnd(100000) :
+				    rnd(2) ? 0 : 3000000000U + rnd(1000);
+
+		pd_timer_enable(PORT, t, us);
+		ref[t].active = true;
+		ref[t].disabled = false;
+		ref[t].expires = now + us;
+		break;
+	}
+	case 2:
+		pd_timer_disable(PORT, t);
+		ref[t].active = false;
+		ref[t].disabled = true;
+		break;
+	case 3:
+		now += rnd(20000);
+		pd_timer_manage_expired(PORT);
+		for (int i = 0; i < PD_TIMER_COUNT; i++)
+			ref_expire(i);
+		break;
+	case 4: {
+		const enum pd_timer_range range = rnd(TC_TIMER_RANGE + 1);
+
+		/* Rare, would leave too few timers running otherwise */
+		if (rnd(8))
+			break;
+		pd_timer_disable_range(PORT, range);
+		for (int i = 0; i < PD_TIMER_COUNT; i++) {
+			if (pd_timer_range_mask[range] & PD_TIMER_BIT(i)) {
+				ref[i].active = false;
+				ref[i].disabled = true;
+			}
+		}
+		break;
+	}
+	default:
+		now += rnd(2000);
+		break;
+	}
+}
+
+static int test_against_reference(void)
+{
+	now = 1000000;
+	pd_timer_init(PORT);
+	ref_init();
+
+	for (int i = 0; i < STEPS; i++) {
+		const int t = rnd(PD_TIMER_COUNT);
+
+		step();
+		TEST_EQ(pd_timer_next_expiration(PORT), ref_next_expiration(),
+			"%lld");
+		TEST_EQ(pd_timer_is_expired(PORT, t), ref_is_expired(t),
+			"%lld");
+		if (check_heap() != EC_SUCCESS) {
+			printf("step %d\n", i);
+			return EC_ERROR_UNKNOWN;
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_reenable_moves_deadline(void)
+{
+	now = 1000000;
+	pd_timer_init(PORT);
+
+	pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, 1000);
+	pd_timer_enable(PORT, PE_TIMER_PS_TRANSITION, 5000);
+	TEST_EQ(pd_timer_next_expiration(PORT), 1000, "%lld");
+
+	/* Restart with later deadline, heap must sift the timer down */
+	pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, 9000);
+	TEST_EQ(pd_timer_next_expiration(PORT), 5000, "%lld");
+
+	pd_timer_disable(PORT, PE_TIMER_PS_TRANSITION);
+	TEST_EQ(pd_timer_next_expiration(PORT), 9000, "%lld");
+
+	pd_timer_disable(PORT, PE_TIMER_SENDER_RESPONSE);
+	TEST_EQ(pd_timer_next_expiration(PORT), NO_TIMEOUT, "%lld");
+
+	return EC_SUCCESS;
+}
+
+/* What pd_timer_next_expiration() did before the heap */
+static int next_expiration_scan(int port)
+{
+	uint64_t nearest = UINT64_MAX;
+
+	for (int t = 0; t < PD_TIMER_COUNT; t++) {
+		if (PD_CHK_ACTIVE(port, t) && timer_expires[port][t] < nearest)
+			nearest = timer_expires[port][t];
+	}
+
+	if (nearest == UINT64_MAX)
+		return NO_TIMEOUT;
+	if (nearest <= now)
+		return EXPIRE_NOW;
+	return MIN(nearest - now, MAX_EXPIRE);
+}
+
+static void bench_next_expiration(int active)
+{
+	const int rounds = 2000000;
+	volatile int sink = 0;
+	double t0, heap_ns, scan_ns;
+
+	now = 1000000;
+	pd_timer_init(PORT);
+	for (int t = 0; t < active; t++)
+		pd_timer_enable(PORT, t, 1000 + rnd(100000));
+
+	t0 = test_host_ns();
+	for (int i = 0; i < rounds; i++)
+		sink += pd_timer_next_expiration(PORT);
+	heap_ns = (test_host_ns() - t0) / rounds;
+
+	t0 = test_host_ns();
+	for (int i = 0; i < rounds; i++)
+		sink += next_expiration_scan(PORT);
+	scan_ns = (test_host_ns() - t0) / rounds;
+
+	printf("next_expiration, %2d active: heap %.1fns, scan %.1fns\n",
+	       active, heap_ns, scan_ns);
+	(void)sink;
+}
+
+/* Restart of a running timer, the common PE / PRL pattern */
+static void bench_restart(int active)
+{
+	const int rounds = 2000000;
+	double t0;
+
+	now = 1000000;
+	pd_timer_init(PORT);
+	for (int t = 0; t < active; t++)
+		pd_timer_enable(PORT, t, 1000 + rnd(100000));
+
+	t0 = test_host_ns();
+	for (int i = 0; i < rounds; i++)
+		pd_timer_enable(PORT, i % active, 1000 + (i & 0xFFFF));
+	printf("enable (restart), %2d active: %.1fns\n", active,
+	       (test_host_ns() - t0) / rounds);
+}
+
+int main(int argc, char **argv)
+{
+	test_init(argc, argv);
+
+	RUN_TEST(test_against_reference);
+	RUN_TEST(test_reenable_moves_deadline);
+
+	if (test_bench_enabled()) {
+		bench_next_expiration(4);
+		bench_next_expiration(PD_TIMER_COUNT);
+		bench_restart(4);
+		bench_restart(PD_TIMER_COUNT);
+	}
+
+	return test_print_result();
+}
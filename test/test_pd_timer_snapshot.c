@@ -0,0 +1,120 @@
+/*
+ * Per-pass time snapshot: all timer operations inside
+ * pd_timer_snapshot_begin() / pd_timer_snapshot_end() see the same "now",
+ * and get_time() is read once.
+ */
+
+#include "test_util.h"
+
+#include "../src/usb_pd_timer.c"
+
+#define PORT 0
+
+static uint64_t now;
+static int time_reads;
+
+timestamp_t get_time(void)
+{
+	timestamp_t t = { .val = now };
+
+	time_reads++;
+	return t;
+}
+
+uint32_t get_ticks(void)
+{
+	return now;
+}
+
+static void reset(void)
+{
+	now = 1000000;
+	time_reads = 0;
+	pd_timer_init(PORT);
+}
+
+static int test_frozen_within_pass(void)
+{
+	reset();
+	pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, 1000);
+
+	pd_timer_snapshot_begin(PORT);
+	time_reads = 0;
+	/* Deadline passes in the middle of the pass */
+	now += 5000;
+	TEST_ASSERT(!pd_timer_is_expired(PORT, PE_TIMER_SENDER_RESPONSE));
+	pd_timer_manage_expired(PORT);
+	TEST_ASSERT(!pd_timer_is_expired(PORT, PE_TIMER_SENDER_RESPONSE));
+	TEST_EQ(pd_timer_next_expiration(PORT), 1000, "%lld");
+	TEST_EQ(time_reads, 0, "%lld");
+	pd_timer_snapshot_end(PORT);
+
+	/* Seen on the next pass */
+	pd_timer_snapshot_begin(PORT);
+	TEST_ASSERT(pd_timer_is_expired(PORT, PE_TIMER_SENDER_RESPONSE));
+	pd_timer_snapshot_end(PORT);
+	TEST_EQ(time_reads, 1, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_enable_from_pass_start(void)
+{
+	reset();
+
+	pd_timer_snapshot_begin(PORT);
+	now += 300;
+	pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, 1000);
+	pd_timer_snapshot_end(PORT);
+
+	/* Counted from the snapshot, not from the actual enable time */
+	TEST_EQ(timer_expires[PORT][PE_TIMER_SENDER_RESPONSE], 1001000,
+		"%lld");
+	TEST_EQ(pd_timer_next_expiration(PORT), 700, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_live_after_end(void)
+{
+	reset();
+	pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, 1000);
+
+	pd_timer_snapshot_begin(PORT);
+	pd_timer_snapshot_end(PORT);
+
+	now += 1000;
+	time_reads = 0;
+	TEST_ASSERT(pd_timer_is_expired(PORT, PE_TIMER_SENDER_RESPONSE));
+	TEST_EQ(time_reads, 1, "%lld");
+
+	return EC_SUCCESS;
+}
+
+static int test_next_expiration_from_snapshot(void)
+{
+	reset();
+	pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, 10000);
+
+	pd_timer_snapshot_begin(PORT);
+	now += 4000;
+	/* Pass start is used, the loop arms its wakeup a bit early at worst */
+	TEST_EQ(pd_timer_next_expiration(PORT), 10000, "%lld");
+	pd_timer_snapshot_end(PORT);
+
+	TEST_EQ(pd_timer_next_expiration(PORT), 6000, "%lld");
+
+	return EC_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	test_init(argc, argv);
+
+	RUN_TEST(test_frozen_within_pass);
+	RUN_TEST(test_enable_from_pass_start);
+	RUN_TEST(test_live_after_end);
+	RUN_TEST(test_next_expiration_from_snapshot);
+
+	return test_print_result();
+}
@@ -0,0 +1 @@
+#define CONFIG_PD_TIMER_TIME_SNAPSHOT
@@ -0,0 +1,117 @@
+/*
+ * 32-bit tick timebase (CONFIG_PD_TIMER_TICKS): conversion never expires
+ * early, and deadlines stay ordered when the tick counter wraps around.
+ */
+
+#include "test_util.h"
+
+#include "../src/usb_pd_timer.c"
+
+#define PORT 0
+
+static uint32_t ticks;
+
+timestamp_t get_time(void)
+{
+	timestamp_t t = { .val = (uint64_t)ticks * CONFIG_PD_TIMER_TICK_US };
+
+	return t;
+}
+
+uint32_t get_ticks(void)
+{
+	return ticks;
+}
+
+static int test_time_before_wrap(void)
+{
+	TEST_ASSERT(PD_TIME_BEFORE(0xFFFFFFF0U, 0x10U));
+	TEST_ASSERT(!PD_TIME_BEFORE(0x10U, 0xFFFFFFF0U));
+	TEST_ASSERT(PD_TIME_BEFORE(0xFFFFFFFFU, 0U));
+	TEST_ASSERT(!PD_TIME_BEFORE(0U, 0xFFFFFFFFU));
+	TEST_ASSERT(!PD_TIME_BEFORE(0x80000000U, 0x80000000U));
+	/* Largest distance still ordered correctly */
+	TEST_ASSERT(PD_TIME_BEFORE(0xFFFFFFFFU, 0x7FFFFFFEU));
+	TEST_ASSERT(!PD_TIME_BEFORE(0x7FFFFFFEU, 0xFFFFFFFFU));
+
+	return EC_SUCCESS;
+}
+
+static int test_from_us(void)
+{
+	TEST_EQ(PD_TIME_FROM_US(0), 0, "%lld");
+	TEST_EQ(PD_TIME_FROM_US(1), 2, "%lld");
+	TEST_EQ(PD_TIME_FROM_US(1000), 2, "%lld");
+	TEST_EQ(PD_TIME_FROM_US(1001), 3, "%lld");
+	TEST_EQ(PD_TIME_FROM_US(UINT32_MAX), 4294969, "%lld");
+
+	return EC_SUCCESS;
+}
+
+/*
+ * "now" is read as tick N anywhere within [N, N + 1) ticks of real time.
+ * Worst case is enable right before the tick advances.
+ */
+static int test_never_early(void)
+{
+	for (uint32_t us = 1; us <= 5000; us += 250) {
+		/* Real time of enable, in us: just before next tick */
+		const uint64_t start = (uint64_t)ticks * 1000 + 999;
+		uint64_t fired;
+
+		pd_timer_init(PORT);
+		pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, us);
+		while (!pd_timer_is_expired(PORT, PE_TIMER_SENDER_RESPONSE))
+			ticks++;
+
+		/* Tick N is reached at N * 1000us of real time */
+		fired = (uint64_t)ticks * 1000;
+		TEST_ASSERT(fired >= start + us);
+		TEST_ASSERT(fired < start - 999 + us + 2000);
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_heap_across_wrap(void)
+{
+	ticks = 0xFFFFFFF8U;
+	pd_timer_init(PORT);
+
+	/* Deadline wraps to small value, but is still the farther one */
+	pd_timer_enable(PORT, PE_TIMER_PS_TRANSITION, 20000);
+	pd_timer_enable(PORT, PE_TIMER_SENDER_RESPONSE, 3000);
+	TEST_EQ(pd_timer_next_expiration(PORT), 4000, "%lld");
+
+	ticks += 4;
+	pd_timer_manage_expired(PORT);
+	TEST_ASSERT(pd_timer_is_expired(PORT, PE_TIMER_SENDER_RESPONSE));
+	TEST_EQ(pd_timer_next_expiration(PORT), 17000, "%lld");
+
+	/* Counter wraps to zero */
+	ticks += 10;
+	TEST_EQ(ticks, 6, "%lld");
+	pd_timer_manage_expired(PORT);
+	TEST_ASSERT(!pd_timer_is_expired(PORT, PE_TIMER_PS_TRANSITION));
+	TEST_EQ(pd_timer_next_expiration(PORT), 7000, "%lld");
+
+	ticks += 7;
+	pd_timer_manage_expired(PORT);
+	TEST_ASSERT(pd_timer_is_expired(PORT, PE_TIMER_PS_TRANSITION));
+	TEST_EQ(pd_timer_next_expiration(PORT), NO_TIMEOUT, "%lld");
+
+	return EC_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	test_init(argc, argv);
+
+	RUN_TEST(test_time_before_wrap);
+	RUN_TEST(test_from_us);
+	ticks = 0xFFFFFF00U;
+	RUN_TEST(test_never_early);
+	RUN_TEST(test_heap_across_wrap);
+
+	return test_print_result();
+}
@@ -0,0 +1,2 @@
+#define CONFIG_PD_TIMER_TICKS
+#define CONFIG_PD_TIMER_TICK_US 1000
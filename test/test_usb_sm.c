@@ -0,0 +1,262 @@
+/*
+ * State machine framework: depth-aligned shared parent search and iterative
+ * entry / exit walks must match the original recursive implementation, for
+ * every pair of states of a nested table.
+ */
+
+#include "test_util.h"
+
+#include "../src/usb_sm.c"
+
+#define PORT 0
+
+void pd_loop_set_event(int port, uint32_t event)
+{
+}
+
+/*
+ * Test state tree, up to USB_SM_MAX_DEPTH levels:
+ *
+ *   A0 - A1 - A2 - A3
+ *      |    \ B2
+ *      \ B1 - C2
+ *   D0 - D1
+ *   E0
+ */
+enum test_state {
+	A0, A1, A2, A3, B2, B1, C2, D0, D1, E0, STATE_COUNT
+};
+
+static const struct usb_state states[];
+
+/* Log of entry / exit / run calls, as 'E' / 'X' / 'R' << 8 | state */
+static int log_buf[64];
+static int log_len;
+
+/* Entry of this state redirects to `redirect_to` */
+static int redirect_from = -1;
+static int redirect_to;
+static struct sm_ctx ctx;
+
+static void log_call(int kind, int state)
+{
+	if (log_len < ARRAY_SIZE(log_buf))
+		log_buf[log_len++] = kind << 8 | state;
+}
+
+#define STATE_FUNCS(s)                                               \
+	static void s##_entry(const int port)                        \
+	{                                                            \
+		log_call('E', s);                                    \
+		if (redirect_from == s) {                            \
+			redirect_from = -1;                          \
+			set_state(port, &ctx, &states[redirect_to]); \
+		}                                                    \
+	}                                                            \
+	static void s##_run(const int port)                          \
+	{                                                            \
+		log_call('R', s);                                    \
+	}                                                            \
+	static void s##_exit(const int port)                         \
+	{                                                            \
+		log_call('X', s);                                    \
+	}
+
+STATE_FUNCS(A0)
+STATE_FUNCS(A1)
+STATE_FUNCS(A2)
+STATE_FUNCS(A3)
+STATE_FUNCS(B2)
+STATE_FUNCS(B1)
+STATE_FUNCS(C2)
+STATE_FUNCS(D0)
+STATE_FUNCS(D1)
+STATE_FUNCS(E0)
+
+#define STATE(s, p, d)                                                   \
+	[s] = { .entry = s##_entry, .run = s##_run, .exit = s##_exit,    \
+		.parent = (p) < 0 ? NULL : &states[(p) < 0 ? 0 : (p)],  \
+		.depth = d }
+
+static const struct usb_state states[] = {
+	STATE(A0, -1, 0),
+	STATE(A1, A0, 1),
+	STATE(A2, A1, 2),
+	STATE(A3, A2, 3),
+	STATE(B2, A1, 2),
+	STATE(B1, A0, 1),
+	STATE(C2, B1, 2),
+	STATE(D0, -1, 0),
+	STATE(D1, D0, 1),
+	STATE(E0, -1, 0),
+};
+
+/*
+ * Reference: recursive implementation, as it was before depth was added
+ */
+static usb_state_ptr ref_shared_parent(usb_state_ptr a, usb_state_ptr b)
+{
+	const usb_state_ptr orig_b = b;
+
+	if (a == NULL || b == NULL)
+		return NULL;
+
+	for (; a != NULL; a = a->parent) {
+		for (b = orig_b; b != NULL; b = b->parent) {
+			if (a == b)
+				return a;
+		}
+	}
+	return NULL;
+}
+
+static int ref_log[64];
+static int ref_len;
+
+static void ref_entry(usb_state_ptr stop, usb_state_ptr current)
+{
+	if (current == stop)
+		return;
+	ref_entry(stop, current->parent);
+	ref_log[ref_len++] = 'E' << 8 | (int)(current - states);
+}
+
+static void ref_exit(usb_state_ptr stop, usb_state_ptr current)
+{
+	if (current == stop)
+		return;
+	ref_log[ref_len++] = 'X' << 8 | (int)(current - states);
+	ref_exit(stop, current->parent);
+}
+
+static void ref_transition(usb_state_ptr from, usb_state_ptr to)
+{
+	const usb_state_ptr shared = ref_shared_parent(from, to);
+
+	ref_len = 0;
+	ref_exit(shared, from);
+	ref_entry(shared, to);
+}
+
+static usb_state_ptr state_or_null(int i)
+{
+	return i < STATE_COUNT ? &states[i] : NULL;
+}
+
+static int check_log(void)
+{
+	TEST_EQ(log_len, ref_len, "%lld");
+	for (int i = 0; i < log_len; i++)
+		TEST_EQ(log_buf[i], ref_log[i], "0x%llx");
+	return EC_SUCCESS;
+}
+
+static int test_table_depth(void)
+{
+	/* Asserts on wrong depth */
+	usb_sm_check_table(states, ARRAY_SIZE(states));
+	return EC_SUCCESS;
+}
+
+static int test_shared_parent(void)
+{
+	/* Index STATE_COUNT stands for NULL */
+	for (int a = 0; a <= STATE_COUNT; a++) {
+		for (int b = 0; b <= STATE_COUNT; b++) {
+			usb_state_ptr sa = state_or_null(a);
+			usb_state_ptr sb = state_or_null(b);
+
+			TEST_ASSERT(shared_parent_state(sa, sb) ==
+				    ref_shared_parent(sa, sb));
+		}
+	}
+	return EC_SUCCESS;
+}
+
+static int test_transition_order(void)
+{
+	for (int from = 0; from <= STATE_COUNT; from++) {
+		for (int to = 0; to < STATE_COUNT; to++) {
+			memset(&ctx, 0, sizeof(ctx));
+			if (from < STATE_COUNT)
+				set_state(PORT, &ctx, &states[from]);
+
+			log_len = 0;
+			set_state(PORT, &ctx, &states[to]);
+			ref_transition(state_or_null(from), &states[to]);
+			if (check_log() != EC_SUCCESS) {
+				printf("%d -> %d\n", from, to);
+				return EC_ERROR_UNKNOWN;
+			}
+			TEST_ASSERT(ctx.current == &states[to]);
+		}
+	}
+	return EC_SUCCESS;
+}
+
+static int test_exit_all(void)
+{
+	memset(&ctx, 0, sizeof(ctx));
+	set_state(PORT, &ctx, &states[A3]);
+
+	log_len = 0;
+	set_state(PORT, &ctx, NULL);
+	ref_len = 0;
+	ref_exit(NULL, &states[A3]);
+
+	return check_log();
+}
+
+static int test_run_order(void)
+{
+	memset(&ctx, 0, sizeof(ctx));
+	set_state(PORT, &ctx, &states[A3]);
+
+	log_len = 0;
+	run_state(PORT, &ctx);
+
+	/* Child first, then parents */
+	ref_len = 0;
+	for (usb_state_ptr s = &states[A3]; s; s = s->parent)
+		ref_log[ref_len++] = 'R' << 8 | (int)(s - states);
+
+	return check_log();
+}
+
+/*
+ * Parent entry redirects: children of the first target are not entered,
+ * and only entered states are exited on the way to the new one.
+ */
+static int test_redirect_in_entry(void)
+{
+	memset(&ctx, 0, sizeof(ctx));
+	set_state(PORT, &ctx, &states[E0]);
+
+	log_len = 0;
+	redirect_from = A1;
+	redirect_to = C2;
+	set_state(PORT, &ctx, &states[A3]);
+
+	ref_len = 0;
+	ref_exit(NULL, &states[E0]);
+	ref_entry(NULL, &states[A1]);
+	ref_exit(&states[A0], &states[A1]);
+	ref_entry(&states[A0], &states[C2]);
+
+	TEST_ASSERT(ctx.current == &states[C2]);
+	return check_log();
+}
+
+int main(int argc, char **argv)
+{
+	test_init(argc, argv);
+
+	RUN_TEST(test_table_depth);
+	RUN_TEST(test_shared_parent);
+	RUN_TEST(test_transition_order);
+	RUN_TEST(test_exit_all);
+	RUN_TEST(test_run_order);
+	RUN_TEST(test_redirect_in_entry);
+
+	return test_print_result();
+}
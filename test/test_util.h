@@ -0,0 +1,76 @@
+/*
+ * Minimal host test helpers, in the spirit of EC test_util.h. Each test is
+ * a function returning EC_SUCCESS, checks return early on failure.
+ */
+
+#ifndef __PD_TEST_UTIL_H
+#define __PD_TEST_UTIL_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static int __test_error_count;
+static int __test_bench;
+
+#define TEST_ASSERT(n)                                                   \
+	do {                                                             \
+		if (!(n)) {                                              \
+			printf("%s:%d: ASSERTION failed: %s\n", __FILE__, \
+			       __LINE__, #n);                            \
+			return EC_ERROR_UNKNOWN;                         \
+		}                                                        \
+	} while (0)
+
+#define TEST_EQ(a, b, fmt)                                              \
+	do {                                                            \
+		long long __a = (a), __b = (b);                         \
+		if (__a != __b) {                                       \
+			printf("%s:%d: ASSERTION failed: %s == %s, "     \
+			       fmt " != " fmt "\n",                     \
+			       __FILE__, __LINE__, #a, #b, __a, __b);   \
+			return EC_ERROR_UNKNOWN;                        \
+		}                                                       \
+	} while (0)
+
+#define RUN_TEST(n)                                 \
+	do {                                        \
+		if (n() != EC_SUCCESS) {            \
+			printf("%s: FAIL\n", #n);   \
+			__test_error_count++;       \
+		} else {                            \
+			printf("%s: OK\n", #n);     \
+		}                                   \
+	} while (0)
+
+/* Benchmarks run only with `bench` argument, see `make -C test bench` */
+static inline void test_init(int argc, char **argv)
+{
+	__test_bench = argc > 1 && !strcmp(argv[1], "bench");
+}
+
+static inline int test_bench_enabled(void)
+{
+	return __test_bench;
+}
+
+/* Host monotonic time, for benchmarks only */
+static inline double test_host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline int test_print_result(void)
+{
+	if (__test_error_count) {
+		printf("Fail! (%d tests)\n", __test_error_count);
+		return 1;
+	}
+	printf("Pass!\n");
+	return 0;
+}
+
+#endif /* __PD_TEST_UTIL_H */